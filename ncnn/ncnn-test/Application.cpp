@@ -6,21 +6,56 @@
  */
 
 #include "Application.h"
+#include "ThreadUtils.h"
+#include "PipelineMetrics.h"
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <future>
 #include <thread>
+#include <functional>
+
+namespace {
+double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// The settings the metadata publisher is rebuilt with on reload
+void copyMetadataSettings(const ConfigManager::Config& from, ConfigManager::Config& to) {
+    to.metadata_transport = from.metadata_transport;
+    to.metadata_host = from.metadata_host;
+    to.metadata_port = from.metadata_port;
+    to.metadata_endpoint = from.metadata_endpoint;
+    to.metadata_mqtt_topic = from.metadata_mqtt_topic;
+    to.metadata_mqtt_qos = from.metadata_mqtt_qos;
+    to.metadata_udp_ttl = from.metadata_udp_ttl;
+    to.metadata_format = from.metadata_format;
+    to.metadata_batch_size = from.metadata_batch_size;
+    to.metadata_batch_window_ms = from.metadata_batch_window_ms;
+    to.metadata_queue_size = from.metadata_queue_size;
+}
+}
 
 Application::Application() 
-    : running_(false), frame_count_(0), detection_count_(0) {
+    : reload_requested_(false), running_(false), qos_metadata_rejected_(0),
+      launch_time_(std::chrono::steady_clock::now()), ready_time_(launch_time_), model_load_ms_(0.0), camera_open_ms_(0.0), warmup_ms_(0.0), first_frame_reported_(false) {
     
     config_manager_ = std::make_unique<ConfigManager>();
+    model_registry_ = std::make_unique<ModelRegistry>();
     yolo_detector_ = std::make_unique<YoloDetector>();
+    crop_classifier_ = std::make_unique<CropClassifier>();
     rtsp_streamer_ = std::make_unique<RtspStreamer>();
     metadata_publisher_ = std::make_unique<MetadataPublisher>();
+    inference_pool_ = std::make_unique<InferencePool>(*yolo_detector_, *crop_classifier_);
+    metrics_server_ = std::make_unique<MetricsServer>();
+    qos_controller_ = std::make_unique<QosController>();
 }
 
 Application::~Application() {
     stop();
+    metrics_server_->stop();  // the page reads the channels
+    stopPipeline();
 }
 
 bool Application::initialize(const std::string& config_file) {
@@ -33,6 +68,36 @@ bool Application::initialize(const std::string& config_file) {
     }
     
     config_manager_->printConfig();
+    config_file_ = config_file;
+    
+    const auto& config = config_manager_->getConfig();
+    base_settings_ = RuntimeSettings::fromConfig(config);
+    runtime_settings_.publish(base_settings_);
+    
+    if (config.qos_enabled) {
+        QosSettings qos;
+        qos.target_latency_ms = config.qos_target_latency_ms;
+        qos.interval_ms = config.qos_interval_ms;
+        qos.recover_periods = config.qos_recover_periods;
+        qos.order = config.qos_order;
+        qos_controller_->configure(qos);
+    }
+    
+    // Keep capture, encoder and publisher threads off the inference cores: every thread
+    // spawned from here on inherits the main thread's mask, the workers re-pin themselves
+    inference_cores_ = parseCoreList(config.inference_cores);
+    if (inference_cores_.empty()) {
+        inference_cores_ = getClusterCores(config.inference_cluster);
+    }
+    io_cores_ = parseCoreList(config.io_cores);
+    if (io_cores_.empty()) {
+        io_cores_ = getOtherCores(inference_cores_);
+    }
+    setCurrentThreadAffinity(io_cores_);
+    
+    // The model loads while the RTSP server comes up and the cameras are probed;
+    // an early return below still waits for it in the future's destructor
+    std::future<bool> model_loaded = std::async(std::launch::async, [this] { return loadModel(); });
     
     // Initialize all components
     if (!initializeComponents()) {
@@ -40,43 +105,122 @@ bool Application::initialize(const std::string& config_file) {
         return false;
     }
     
-    // Initialize camera
-    if (!initializeCamera()) {
-        std::cerr << "Failed to initialize camera" << std::endl;
+    // Initialize cameras (each one registers its RTSP mount point)
+    if (!initializeCameras()) {
+        std::cerr << "Failed to initialize cameras" << std::endl;
+        return false;
+    }
+    
+    if (!rtsp_streamer_->start()) {
+        std::cerr << "Failed to start RTSP streamer" << std::endl;
+        return false;
+    }
+    
+    if (!model_loaded.get()) {
         return false;
     }
     
-    std::cout << "=== System Initialized Successfully ===" << std::endl;
+    // Not ready before the first inference has paid for NCNN's lazy allocations
+    const auto warmup_start = std::chrono::steady_clock::now();
+    for (auto& channel : channels_) {
+        channel->warmUp();
+    }
+    warmup_ms_ = millisecondsBetween(warmup_start, std::chrono::steady_clock::now());
+    
+    // Metrics are optional: a busy port is reported but does not stop the cameras
+    if (config.metrics_port > 0) {
+        metrics_server_->start(config.metrics_port, [this](std::string& out) { writeMetrics(out); });
+    }
+    
+    ready_time_ = std::chrono::steady_clock::now();
+    std::cout << "=== System Initialized Successfully in " << (int)millisecondsBetween(launch_time_, ready_time_)
+              << " ms (model " << (int)model_load_ms_ << " ms, cameras " << (int)camera_open_ms_
+              << " ms, warm-up " << (int)warmup_ms_ << " ms) ===" << std::endl;
     return true;
 }
 
-bool Application::initializeComponents() {
+bool Application::loadModel() {
     const auto& config = config_manager_->getConfig();
+    const auto load_start = std::chrono::steady_clock::now();
     
     // Initialize YOLO detector
     std::cout << "Loading YOLO model..." << std::endl;
-    if (yolo_detector_->load(config.model_path, config.use_gpu) != 0) {
+    const ModelPrecision precision = parseModelPrecision(config.model_precision);
+    if (yolo_detector_->load(config.model_path, config.use_gpu, precision, model_registry_.get()) != 0) {
         std::cerr << "Failed to load YOLO model: " << config.model_path << std::endl;
         return false;
     }
+    yolo_detector_->setUsePoolAllocator(config.inference_pool_allocator);
+    yolo_detector_->setClassThresholds(config.class_thresholds);
+    yolo_detector_->setMaxDetections(config.max_detections);
+    yolo_detector_->setMinBoxSize(config.min_box_size);
+    yolo_detector_->setClassAgnosticNms(config.nms_class_agnostic);
+    
+    // Optional second stage on crops of the selected classes
+    if (!config.classifier_model.empty()) {
+        CropClassifierSettings classifier;
+        classifier.model_path = config.classifier_model;
+        classifier.labels_path = config.classifier_labels;
+        classifier.classes = config.classifier_classes;
+        classifier.input_size = config.classifier_input_size;
+        classifier.min_size = config.classifier_min_size;
+        classifier.threshold = config.classifier_threshold;
+        classifier.max_crops = config.classifier_max_crops;
+        classifier.use_gpu = config.use_gpu;
+        classifier.precision = precision;
+        if (!crop_classifier_->load(*model_registry_, classifier)) {
+            return false;
+        }
+    }
+    model_load_ms_ = millisecondsBetween(load_start, std::chrono::steady_clock::now());
     std::cout << "YOLO model loaded successfully" << std::endl;
+    return true;
+}
+
+bool Application::initializeComponents() {
+    const auto& config = config_manager_->getConfig();
     
     // Initialize RTSP server
     std::cout << "Initializing RTSP server..." << std::endl;
-    if (!rtsp_streamer_->initialize("rtsp://localhost:8554/stream", config.frame_width, config.frame_height, config.frame_fps, config.rtsp_port)) {
+    VideoEncoderSettings encoder;
+    encoder.encoder = config.rtsp_encoder;
+    encoder.codec = config.rtsp_codec;
+    encoder.bitrate_kbps = config.rtsp_bitrate_kbps;
+    encoder.keyframe_interval = config.rtsp_keyframe_interval;
+    encoder.sei_metadata = config.rtsp_sei_metadata;
+    encoder.queue_frames = config.rtsp_queue_frames;
+    
+    RtspTransportSettings rtsp_transport;
+    rtsp_transport.protocols = config.rtsp_protocols;
+    rtsp_transport.multicast_range = config.rtsp_multicast_range;
+    rtsp_transport.multicast_port_min = config.rtsp_multicast_port_min;
+    rtsp_transport.multicast_port_max = config.rtsp_multicast_port_max;
+    rtsp_transport.multicast_ttl = config.rtsp_multicast_ttl;
+    rtsp_transport.client_send_buffer_kb = config.rtsp_client_send_buffer_kb;
+    rtsp_transport.max_clients = config.rtsp_max_clients;
+    
+    if (!rtsp_streamer_->initialize(config.rtsp_port, encoder, rtsp_transport)) {
         std::cerr << "Failed to initialize RTSP server" << std::endl;
         return false;
     }
     
-    if (!rtsp_streamer_->start()) {
-        std::cerr << "Failed to start RTSP streamer" << std::endl;
-        return false;
-    }
-    
     // Initialize metadata publisher
     std::cout << "Initializing metadata publisher..." << std::endl;
-    if (!metadata_publisher_->initialize(config.metadata_host, config.metadata_port, 
-                                        config.metadata_endpoint, config.metadata_publish_interval_ms)) {
+    return startMetadataPublisher(config);
+}
+
+bool Application::startMetadataPublisher(const ConfigManager::Config& config) {
+    MetadataTransportSettings transport;
+    transport.type = config.metadata_transport;
+    transport.host = config.metadata_host;
+    transport.port = config.metadata_port;
+    transport.endpoint = config.metadata_endpoint;
+    transport.mqtt_topic = config.metadata_mqtt_topic;
+    transport.mqtt_qos = config.metadata_mqtt_qos;
+    transport.udp_ttl = config.metadata_udp_ttl;
+    
+    if (!metadata_publisher_->initialize(transport, config.metadata_batch_size, config.metadata_batch_window_ms,
+                                        config.metadata_queue_size, config.metadata_format)) {
         std::cerr << "Failed to initialize metadata publisher" << std::endl;
         return false;
     }
@@ -89,51 +233,40 @@ bool Application::initializeComponents() {
     return true;
 }
 
-bool Application::initializeCamera() {
+bool Application::initializeCameras() {
     const auto& config = config_manager_->getConfig();
     
-    std::cout << "Initializing camera " << config.camera_id << "..." << std::endl;
-    
-    camera_ = std::make_unique<cv::VideoCapture>(config.camera_id, cv::CAP_V4L2);
-    if (!camera_->isOpened()) {
-        std::cout << "Failed with V4L2, trying default backend..." << std::endl;
-        camera_->open(config.camera_id);
-        if (!camera_->isOpened()) {
-            std::cerr << "Failed to open camera " << config.camera_id << std::endl;
+    channels_.clear();
+    for (size_t i = 0; i < config.cameras.size(); i++) {
+        std::unique_ptr<CameraChannel> channel(new CameraChannel((int)i, config.cameras[i], config, runtime_settings_, *yolo_detector_,
+                                                                 *crop_classifier_, *inference_pool_, *rtsp_streamer_,
+                                                                 *metadata_publisher_));
+        if (!channel->initialize()) {
+            channels_.clear();
             return false;
         }
+        channels_.push_back(std::move(channel));
     }
     
-    // Set camera properties for stability
-    camera_->set(cv::CAP_PROP_BUFFERSIZE, 1); // Minimal buffer to avoid delays
-    camera_->set(cv::CAP_PROP_FRAME_WIDTH, config.frame_width);
-    camera_->set(cv::CAP_PROP_FRAME_HEIGHT, config.frame_height);
-    camera_->set(cv::CAP_PROP_FPS, config.frame_fps);
-    
-    // Additional properties for V4L2 stability
-    camera_->set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'));
-    camera_->set(cv::CAP_PROP_AUTO_EXPOSURE, 0.25); // Manual exposure
-    
-    // Test camera with timeout
-    cv::Mat test_frame;
-    bool camera_ready = false;
-    for (int i = 0; i < 20; i++) { // Increased attempts
-        *camera_ >> test_frame;
-        if (!test_frame.empty()) {
-            std::cout << "Camera initialized successfully" << std::endl;
-            std::cout << "Actual frame size: " << test_frame.cols << "x" << test_frame.rows << std::endl;
-            camera_ready = true;
-            break;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Probing a camera can take seconds, so all of them are opened at once
+    const auto open_start = std::chrono::steady_clock::now();
+    std::vector<std::future<bool>> opened;
+    for (auto& channel : channels_) {
+        CameraChannel* camera = channel.get();
+        opened.push_back(std::async(std::launch::async, [camera] { return camera->openSource(); }));
     }
-    
-    if (!camera_ready) {
-        std::cerr << "Camera test failed - no frames received" << std::endl;
+    bool all_opened = true;
+    for (auto& result : opened) {
+        all_opened = result.get() && all_opened;
+    }
+    camera_open_ms_ = millisecondsBetween(open_start, std::chrono::steady_clock::now());
+    if (!all_opened) {
+        channels_.clear();
         return false;
     }
     
-    return true;
+    std::cout << channels_.size() << " camera(s) initialized" << std::endl;
+    return !channels_.empty();
 }
 
 int Application::run() {
@@ -144,99 +277,220 @@ int Application::run() {
     
     running_ = true;
     start_time_ = std::chrono::steady_clock::now();
-    last_metadata_time_ = start_time_;
     
+    startPipeline();
+    
+    // The cameras run on their own threads; this loop only drives the display
     cv::Mat frame;
     while (running_) {
-        // Capture frame with timeout protection
-        bool frame_captured = false;
-        for (int retry = 0; retry < 3; retry++) {
-            *camera_ >> frame;
-            if (!frame.empty()) {
-                frame_captured = true;
-                break;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        reportFirstFrame();
+        if (reload_requested_.exchange(false)) {
+            reloadConfig();
+        }
+        if (config.qos_enabled) {
+            updateQos();
         }
         
-        if (!frame_captured) {
-            std::cerr << "Failed to capture frame after retries" << std::endl;
+        if (!config.show_display) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
             continue;
         }
         
-        frame_count_++;
-        
-        // Process frame
-        processFrame(frame);
-        
-        // Handle keyboard input
-        if (config.show_display) {
-            try {
-                char key = cv::waitKey(1);
-                if (key != -1) {
-                    handleKeyInput(key);
+        try {
+            for (auto& channel : channels_) {
+                if (channel->getDisplayFrame(frame)) {
+                    cv::imshow("AI Detection System - " + channel->getName(), frame);
                 }
-            } catch (...) {
-                std::cerr << "Display error, switching to headless mode" << std::endl;
-                // Force headless mode if display fails
-                break;
             }
-        } else {
-            // Small delay when not showing display and check for interruption
-            std::this_thread::sleep_for(std::chrono::milliseconds(33)); // ~30fps timing
-        }
-        
-        // Additional check for running_ flag (helps with signal handling)
-        if (!running_) {
+            
+            // Handle keyboard input
+            char key = cv::waitKey(10);
+            if (key != -1) {
+                handleKeyInput(key);
+            }
+        } catch (...) {
+            std::cerr << "Display error, switching to headless mode" << std::endl;
+            // Force headless mode if display fails
             break;
         }
     }
     
+    running_ = false;
+    stopPipeline();
+    
+    // Print final statistics
+    printStatistics();
+    
     std::cout << "Application stopped" << std::endl;
     return 0;
 }
 
-void Application::processFrame(const cv::Mat& frame) {
+void Application::startPipeline() {
     const auto& config = config_manager_->getConfig();
     
-    // Detect objects
-    std::vector<Object> objects;
-    yolo_detector_->detect(frame, objects, config.detection_threshold, config.nms_threshold);
+    if (config.async_detection) {
+        size_t queue_size = config.frame_queue_size > 0 ? config.frame_queue_size : 2;
+        
+        inference_pool_->setResultCallback([this](int camera, const FrameContext& frame, const std::vector<Object>& objects) {
+            channels_[camera]->onDetections(frame, objects);
+        });
+        inference_pool_->setMaxFrameAge(config.max_frame_age_ms);
+        inference_pool_->start((int)channels_.size(), config.inference_workers, inference_cores_,
+                               config.detection_threshold, config.nms_threshold, queue_size,
+                               parseOverflowPolicy(config.frame_queue_policy), config.inference_batch_size,
+                               config.inference_threads);
+    }
     
-    if (!objects.empty()) {
-        detection_count_ += objects.size();
+    for (auto& channel : channels_) {
+        channel->start();
+    }
+}
+
+void Application::reportFirstFrame() {
+    if (first_frame_reported_) return;
+    
+    // Launch-to-first-frame covers everything a restart costs before the streams are live again
+    std::chrono::steady_clock::time_point last_first_frame = launch_time_;
+    for (const auto& channel : channels_) {
+        std::chrono::steady_clock::time_point first_frame;
+        if (!channel->getFirstOutputTime(first_frame)) return;
+        last_first_frame = std::max(last_first_frame, first_frame);
+    }
+    
+    first_frame_reported_ = true;
+    std::cout << "First frame on all cameras " << (int)millisecondsBetween(launch_time_, last_first_frame)
+              << " ms after launch (ready after " << (int)millisecondsBetween(launch_time_, ready_time_) << " ms)" << std::endl;
+}
+
+void Application::reloadConfig() {
+    // loadConfig() would write a default file in place of a missing one
+    if (!std::ifstream(config_file_).good()) {
+        std::cerr << "Config reload skipped, file not found: " << config_file_ << std::endl;
+        return;
     }
     
-    // Send frame to RTSP stream
-    cv::Mat display_frame = frame.clone();
-    if (config.draw_detections && !objects.empty()) {
-        YoloDetector::draw_objects(display_frame, objects);
+    ConfigManager next;
+    if (!next.loadConfig(config_file_)) {
+        std::cerr << "Config reload failed, keeping the current settings" << std::endl;
+        return;
     }
+    ConfigManager::Config& config = config_manager_->getConfig();
+    const ConfigManager::Config& updated = next.getConfig();
     
-    rtsp_streamer_->pushFrame(display_frame);
+    const std::vector<std::string> changed = ConfigManager::changedKeys(config, updated);
+    if (changed.empty()) {
+        std::cout << "Config reloaded, nothing changed" << std::endl;
+        return;
+    }
     
-    // Publish metadata at configured interval
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_metadata_time_);
+    // Each channel picks the new snapshot up with its next frame and rebuilds
+    // its motion gate or tracker only if their own settings changed
+    base_settings_ = RuntimeSettings::fromConfig(updated);
+    inference_pool_->setMaxFrameAge(base_settings_.max_frame_age_ms);
+    if (updated.rtsp_bitrate_kbps != config.rtsp_bitrate_kbps) {
+        rtsp_streamer_->setBitrate(updated.rtsp_bitrate_kbps);
+        config.rtsp_bitrate_kbps = updated.rtsp_bitrate_kbps;
+    }
+    base_settings_.applyTo(config);
+    applySettings();
+    
+    // A new transport or format needs a new publisher; the cameras keep queueing meanwhile
+    // (records are rejected only while it restarts) and queued records are sent by the new one
+    ConfigManager::Config metadata = config;
+    copyMetadataSettings(updated, metadata);
+    if (!ConfigManager::changedKeys(config, metadata).empty()) {
+        metadata_publisher_->stop();
+        if (startMetadataPublisher(updated)) {
+            copyMetadataSettings(updated, config);
+        } else {
+            std::cerr << "Metadata publisher could not be rebuilt, keeping the previous transport" << std::endl;
+            startMetadataPublisher(config);
+        }
+    }
     
-    if (elapsed.count() >= config.metadata_publish_interval_ms) {
-        metadata_publisher_->publishDetections(objects, frame.cols, frame.rows, "camera_" + std::to_string(config.camera_id));
-        last_metadata_time_ = now;
+    // Whatever still differs is built into the model, the cameras or the server
+    const std::vector<std::string> pending = ConfigManager::changedKeys(config, updated);
+    std::cout << "Config reloaded, applied " << (changed.size() - pending.size()) << " change(s)" << std::endl;
+    for (const auto& key : pending) {
+        std::cout << "  " << key << " changed, takes effect after a restart" << std::endl;
     }
+}
+
+void Application::applySettings() {
+    const ConfigManager::Config& config = config_manager_->getConfig();
+    RuntimeSettings settings = base_settings_;
+    float bitrate_scale = 1.f;
+    
+    // The QoS steps scale the configured values, so a reload keeps the current steps
+    if (config.qos_enabled) {
+        const QosAdjustment adjustment = qos_controller_->getAdjustment();
+        settings.detection_interval = std::max(1, base_settings_.detection_interval) * adjustment.detection_interval_factor;
+        settings.detection_input_scale = adjustment.input_scale;
+        settings.output_frame_stride = adjustment.frame_stride;
+        bitrate_scale = adjustment.bitrate_scale;
+    }
+    
+    runtime_settings_.publish(settings);
+    rtsp_streamer_->setBitrateScale(bitrate_scale);
+}
+
+void Application::updateQos() {
+    const auto now = std::chrono::steady_clock::now();
+    if (!qos_controller_->isDue(now)) return;
     
-    // Show display if enabled
-    if (config.show_display) {
-        // Add status overlay
-        std::string status = "Frame: " + std::to_string(frame_count_) + 
-                           " | Detections: " + std::to_string(objects.size()) +
-                           " | Queue: " + std::to_string(metadata_publisher_->getQueueSize());
+    if (qos_controller_->update(measureLoad(), now)) {
+        applySettings();
+    }
+}
+
+QosSample Application::measureLoad() {
+    QosSample sample;
+    qos_totals_.resize(channels_.size());
+    for (size_t i = 0; i < channels_.size(); i++) {
+        const CameraChannel& channel = *channels_[i];
+        LoadTotals totals;
+        totals.output_latency_us = channel.getOutputLatencyTotalUs();
+        totals.frames = channel.getFrameCount();
+        totals.inference_latency_us = channel.getInferenceLatencyTotalUs();
+        totals.inferences = channel.getInferenceCount();
+        totals.captured = channel.getCaptureCount();
+        totals.dropped = channel.getDroppedCount();
         
-        cv::putText(display_frame, status, cv::Point(10, 30), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+        // Averages over this window only; a statistics reset makes the counters go backwards
+        const LoadTotals& last = qos_totals_[i];
+        const int frames = totals.frames - last.frames;
+        const int inferences = totals.inferences - last.inferences;
+        if (frames > 0 && totals.output_latency_us >= last.output_latency_us) {
+            sample.latency_ms = std::max(sample.latency_ms, (totals.output_latency_us - last.output_latency_us) / 1000.0 / frames);
+            sample.valid = true;
+        }
+        if (inferences > 0 && totals.inference_latency_us >= last.inference_latency_us) {
+            sample.latency_ms = std::max(sample.latency_ms,
+                                         (totals.inference_latency_us - last.inference_latency_us) / 1000.0 / inferences);
+            sample.valid = true;
+        }
         
-        cv::imshow("AI Detection System", display_frame);
+        // The queues drop their oldest frame when full, so what they dropped says more than how full they are
+        const int captured = totals.captured - last.captured;
+        const int dropped = totals.dropped - last.dropped;
+        if (captured > 0 && dropped > 0) {
+            sample.drop_fraction = std::max(sample.drop_fraction, std::min(1.0, (double)dropped / captured));
+        }
+        qos_totals_[i] = totals;
     }
+    
+    // A publisher rejecting records is behind no matter how its capacity was configured
+    const int rejected = metadata_publisher_->getDroppedCount();
+    sample.backpressured = rejected > qos_metadata_rejected_ || metadata_publisher_->isBackpressured();
+    qos_metadata_rejected_ = rejected;
+    return sample;
+}
+
+void Application::stopPipeline() {
+    for (auto& channel : channels_) {
+        channel->stop();
+    }
+    inference_pool_->stop();
 }
 
 void Application::handleKeyInput(char key) {
@@ -257,8 +511,9 @@ void Application::handleKeyInput(char key) {
             
         case 'r':
             // Reset statistics
-            frame_count_ = 0;
-            detection_count_ = 0;
+            for (auto& channel : channels_) {
+                channel->resetStatistics();
+            }
             start_time_ = std::chrono::steady_clock::now();
             std::cout << "Statistics reset" << std::endl;
             break;
@@ -272,15 +527,7 @@ void Application::stop() {
     if (!running_) return;
     
     std::cout << "Stopping application..." << std::endl;
-    running_ = false;
-    
-    // Print final statistics
-    printStatistics();
-    
-    // Cleanup
-    if (camera_) {
-        camera_->release();
-    }
+    running_ = false;  // The pipeline stages poll this flag; run() joins them and releases the camera
     
     cv::destroyAllWindows();
     
@@ -293,17 +540,155 @@ void Application::printStatistics() {
     
     std::cout << "=== Statistics ===" << std::endl;
     std::cout << "Runtime: " << elapsed.count() << " seconds" << std::endl;
-    std::cout << "Frames processed: " << frame_count_ << std::endl;
-    std::cout << "Total detections: " << detection_count_ << std::endl;
+    
+    for (const auto& channel : channels_) {
+        std::cout << "[" << channel->getName() << "] " << channel->getStreamUrls() << std::endl;
+        std::cout << "  Frames processed: " << channel->getFrameCount() << std::endl;
+        std::cout << "  Frames inferred: " << channel->getInferenceCount() << std::endl;
+        std::cout << "  Frames dropped: " << channel->getDroppedCount() << std::endl;
+        if (config_manager_->getConfig().motion_gating) {
+            std::cout << "  Detections skipped (no motion): " << channel->getMotionSkippedCount() << std::endl;
+        }
+        if (config_manager_->getConfig().tracking) {
+            std::cout << "  Active tracks: " << channel->getTrackCount() << std::endl;
+        }
+        if (config_manager_->getConfig().clip_recording) {
+            std::cout << "  Clips written: " << channel->getClipCount() << std::endl;
+        }
+        std::cout << "  Total detections: " << channel->getDetectionCount() << std::endl;
+        std::cout << "  Latency from capture: " << channel->getInferenceLatencyMs() << " ms to detection, "
+                  << channel->getOutputLatencyMs() << " ms to RTSP push" << std::endl;
+        
+        if (elapsed.count() > 0) {
+            std::cout << "  Average FPS: " << (channel->getFrameCount() / elapsed.count()) << std::endl;
+            std::cout << "  Inference FPS: " << (channel->getInferenceCount() / elapsed.count()) << std::endl;
+            std::cout << "  Detections per second: " << (channel->getDetectionCount() / elapsed.count()) << std::endl;
+        }
+    }
+    
+    std::cout << "Inference workers: " << inference_pool_->getWorkerCount() << std::endl;
+    if (crop_classifier_->isLoaded()) {
+        std::cout << "Classifier crops: " << crop_classifier_->getClassifiedCount() << std::endl;
+    }
+    if (config_manager_->getConfig().qos_enabled) {
+        std::cout << "QoS: latency " << (int)qos_controller_->getLatencyMs() << " ms (target "
+                  << qos_controller_->getTargetLatencyMs() << " ms), " << qos_controller_->getAdjustmentCount() << " adjustment(s), steps";
+        for (int k = 0; k < (int)QosKnob::Count; k++) {
+            std::cout << " " << QosController::getKnobName((QosKnob)k) << "=" << qos_controller_->getStep((QosKnob)k);
+        }
+        std::cout << std::endl;
+    }
     std::cout << "Metadata queue size: " << metadata_publisher_->getQueueSize() << std::endl;
-    std::cout << "Metadata published: " << metadata_publisher_->getPublishedCount() << std::endl;
+    std::cout << "Metadata enqueued: " << metadata_publisher_->getEnqueuedCount()
+              << ", sent: " << metadata_publisher_->getPublishedCount()
+              << ", dropped: " << metadata_publisher_->getDroppedCount()
+              << ", failed: " << metadata_publisher_->getFailedCount()
+              << (metadata_publisher_->isBackpressured() ? " (queue full, rejecting new records)" : "") << std::endl;
     std::cout << "RTSP streaming: " << (rtsp_streamer_->isRunning() ? "Active" : "Inactive") << std::endl;
+    for (int i = 0; i < rtsp_streamer_->getStreamCount(); i++) {
+        double average_ms = 0.0, max_ms = 0.0;
+        std::cout << "  " << rtsp_streamer_->getStreamUrl(i) << ": " << rtsp_streamer_->getDroppedFrames(i) << " frames dropped";
+        if (rtsp_streamer_->getLatency(i, average_ms, max_ms)) {
+            std::cout << ", capture-to-encoded latency " << average_ms << " ms avg / " << max_ms << " ms max";
+        }
+        std::cout << std::endl;
+    }
     std::cout << "Metadata publisher: " << (metadata_publisher_->isRunning() ? "Active" : "Inactive") << std::endl;
     
-    if (elapsed.count() > 0) {
-        std::cout << "Average FPS: " << (frame_count_ / elapsed.count()) << std::endl;
-        std::cout << "Detections per second: " << (detection_count_ / elapsed.count()) << std::endl;
+    std::cout << "==================" << std::endl;
+}
+
+void Application::writeMetrics(std::string& out) const {
+    PipelineMetrics::instance().writePrometheus(out);
+    
+    struct CameraMetric {
+        const char* name;
+        const char* type;
+        const char* help;
+        std::function<double(int)> value;
+    };
+    const CameraMetric camera_metrics[] = {
+        {"ai_frames_captured_total", "counter", "Frames read from the camera",
+         [this](int i) { return (double)channels_[i]->getCaptureCount(); }},
+        {"ai_frames_output_total", "counter", "Frames pushed to the RTSP streams",
+         [this](int i) { return (double)channels_[i]->getFrameCount(); }},
+        {"ai_frames_inferred_total", "counter", "Detection results received",
+         [this](int i) { return (double)channels_[i]->getInferenceCount(); }},
+        {"ai_frames_dropped_total", "counter", "Frames dropped before output or inference",
+         [this](int i) { return (double)channels_[i]->getDroppedCount(); }},
+        {"ai_inference_skipped_total", "counter", "Detections skipped by the motion gate",
+         [this](int i) { return (double)channels_[i]->getMotionSkippedCount(); }},
+        {"ai_tracks_active", "gauge", "Confirmed object tracks",
+         [this](int i) { return (double)channels_[i]->getTrackCount(); }},
+        {"ai_clips_written_total", "counter", "Event clips written",
+         [this](int i) { return (double)channels_[i]->getClipCount(); }},
+        {"ai_detections_total", "counter", "Detected objects",
+         [this](int i) { return (double)channels_[i]->getDetectionCount(); }},
+        {"ai_output_queue_depth", "gauge", "Captured frames waiting for the output stage",
+         [this](int i) { return (double)channels_[i]->getOutputQueueSize(); }},
+        {"ai_inference_queue_depth", "gauge", "Frames waiting for an inference worker",
+         [this](int i) { return (double)inference_pool_->getQueueDepth(i); }},
+        {"ai_first_frame_seconds", "gauge", "Time from launch to the first frame pushed to RTSP",
+         [this](int i) {
+             std::chrono::steady_clock::time_point first_frame;
+             return channels_[i]->getFirstOutputTime(first_frame)
+                        ? millisecondsBetween(launch_time_, first_frame) / 1000.0 : std::nan("");
+         }},
+    };
+    for (const auto& metric : camera_metrics) {
+        PipelineMetrics::appendHeader(out, metric.name, metric.type, metric.help);
+        for (size_t i = 0; i < channels_.size(); i++) {
+            PipelineMetrics::appendSample(out, metric.name, "camera=\"" + channels_[i]->getName() + "\"",
+                                          metric.value((int)i));
+        }
     }
     
-    std::cout << "==================" << std::endl;
-}
\ No newline at end of file
+    PipelineMetrics::appendHeader(out, "ai_startup_seconds", "gauge", "Duration of the startup phases");
+    PipelineMetrics::appendSample(out, "ai_startup_seconds", "phase=\"model_load\"", model_load_ms_ / 1000.0);
+    PipelineMetrics::appendSample(out, "ai_startup_seconds", "phase=\"camera_open\"", camera_open_ms_ / 1000.0);
+    PipelineMetrics::appendSample(out, "ai_startup_seconds", "phase=\"warm_up\"", warmup_ms_ / 1000.0);
+    PipelineMetrics::appendSample(out, "ai_startup_seconds", "phase=\"ready\"", millisecondsBetween(launch_time_, ready_time_) / 1000.0);
+    
+    PipelineMetrics::appendHeader(out, "ai_metadata_queue_depth", "gauge", "Metadata records waiting to be sent");
+    PipelineMetrics::appendSample(out, "ai_metadata_queue_depth", "", metadata_publisher_->getQueueSize());
+    PipelineMetrics::appendHeader(out, "ai_metadata_records_total", "counter", "Metadata records by outcome");
+    PipelineMetrics::appendSample(out, "ai_metadata_records_total", "result=\"enqueued\"", metadata_publisher_->getEnqueuedCount());
+    PipelineMetrics::appendSample(out, "ai_metadata_records_total", "result=\"sent\"", metadata_publisher_->getPublishedCount());
+    PipelineMetrics::appendSample(out, "ai_metadata_records_total", "result=\"dropped\"", metadata_publisher_->getDroppedCount());
+    PipelineMetrics::appendSample(out, "ai_metadata_records_total", "result=\"failed\"", metadata_publisher_->getFailedCount());
+    
+    if (crop_classifier_->isLoaded()) {
+        PipelineMetrics::appendHeader(out, "ai_classifier_crops_total", "counter", "Detection crops run through the classifier");
+        PipelineMetrics::appendSample(out, "ai_classifier_crops_total", "", crop_classifier_->getClassifiedCount());
+    }
+    
+    if (config_manager_->getConfig().qos_enabled) {
+        PipelineMetrics::appendHeader(out, "ai_qos_step", "gauge", "Steps each load shedding knob is turned down");
+        for (int k = 0; k < (int)QosKnob::Count; k++) {
+            PipelineMetrics::appendSample(out, "ai_qos_step", std::string("knob=\"") + QosController::getKnobName((QosKnob)k) + "\"",
+                                          qos_controller_->getStep((QosKnob)k));
+        }
+        PipelineMetrics::appendHeader(out, "ai_qos_adjustments_total", "counter", "Load shedding steps taken in either direction");
+        PipelineMetrics::appendSample(out, "ai_qos_adjustments_total", "", qos_controller_->getAdjustmentCount());
+        PipelineMetrics::appendHeader(out, "ai_qos_latency_milliseconds", "gauge", "Latency the load shedding measured, and its target");
+        PipelineMetrics::appendSample(out, "ai_qos_latency_milliseconds", "kind=\"measured\"", qos_controller_->getLatencyMs());
+        PipelineMetrics::appendSample(out, "ai_qos_latency_milliseconds", "kind=\"target\"", qos_controller_->getTargetLatencyMs());
+    }
+    
+    PipelineMetrics::appendHeader(out, "ai_rtsp_clients", "gauge", "Connected RTSP clients");
+    PipelineMetrics::appendSample(out, "ai_rtsp_clients", "", rtsp_streamer_->getClientCount());
+    
+    PipelineMetrics::appendHeader(out, "ai_rtsp_frames_dropped_total", "counter", "Frames dropped because the encoder was behind");
+    for (int i = 0; i < rtsp_streamer_->getStreamCount(); i++) {
+        PipelineMetrics::appendSample(out, "ai_rtsp_frames_dropped_total", "stream=\"" + rtsp_streamer_->getStreamUrl(i) + "\"",
+                                      rtsp_streamer_->getDroppedFrames(i));
+    }
+    PipelineMetrics::appendHeader(out, "ai_rtsp_latency_milliseconds", "gauge", "Average capture-to-encoded latency");
+    for (int i = 0; i < rtsp_streamer_->getStreamCount(); i++) {
+        double average_ms = 0.0, max_ms = 0.0;
+        if (rtsp_streamer_->getLatency(i, average_ms, max_ms)) {
+            PipelineMetrics::appendSample(out, "ai_rtsp_latency_milliseconds", "stream=\"" + rtsp_streamer_->getStreamUrl(i) + "\"",
+                                          average_ms);
+        }
+    }
+}
@@ -12,19 +12,29 @@
 #include <memory>
 #include <atomic>
 #include <chrono>
+#include <vector>
 
 #include "ConfigManager.h"
 #include "YoloDetector.h"
+#include "CropClassifier.h"
+#include "ModelRegistry.h"
 #include "RtspStreamer.h"
 #include "MetadataPublisher.h"
+#include "InferencePool.h"
+#include "CameraChannel.h"
+#include "MetricsServer.h"
+#include "QosController.h"
+#include "RuntimeSettings.h"
 
 /**
  * @class Application
  * @brief Main application class that manages the entire AI detection system
  * 
  * This class integrates all components including object detection, RTSP streaming,
- * and metadata publishing. It handles the main processing loop and coordinates
- * between different modules.
+ * and metadata publishing. Every configured camera runs as a CameraChannel with
+ * its own capture and output threads and its own RTSP mount point, while all
+ * cameras share one loaded model through the InferencePool. The caller's thread
+ * only runs the display and keyboard loop.
  */
 class Application {
 public:
@@ -56,31 +66,73 @@ public:
      */
     void stop();
     
+    /**
+     * @brief Ask the main loop to reload the configuration file
+     *
+     * Only sets a flag, so it is safe to call from a signal handler.
+     */
+    void requestReload() { reload_requested_ = true; }
+    
 private:
     // Core components
     std::unique_ptr<ConfigManager> config_manager_;        ///< Configuration manager instance
-    std::unique_ptr<YoloDetector> yolo_detector_;          ///< YOLO object detector instance
+    std::unique_ptr<ModelRegistry> model_registry_;        ///< Networks loaded once, shared by the detector and the classifier
+    std::unique_ptr<YoloDetector> yolo_detector_;          ///< YOLO object detector instance (shared by all cameras)
+    std::unique_ptr<CropClassifier> crop_classifier_;      ///< Second stage on detection crops (idle unless classifier_model is set)
     std::unique_ptr<RtspStreamer> rtsp_streamer_;          ///< RTSP video streamer instance
     std::unique_ptr<MetadataPublisher> metadata_publisher_; ///< Metadata publisher instance
+    std::unique_ptr<InferencePool> inference_pool_;        ///< Detection workers shared by all cameras
+    std::unique_ptr<MetricsServer> metrics_server_;        ///< Prometheus endpoint (idle unless metrics_port is set)
+    std::unique_ptr<QosController> qos_controller_;        ///< Load shedding (idle unless qos_enabled is set)
+    RuntimeSettingsStore runtime_settings_;                ///< Settings applied by reloadConfig(), read by the channels
+    RuntimeSettings base_settings_;                        ///< Configured settings, before the QoS adjustment
+    std::string config_file_;                              ///< File reloadConfig() reads
+    std::atomic<bool> reload_requested_;                   ///< Set by requestReload(), handled by the main loop
     
-    // Camera and processing
-    std::unique_ptr<cv::VideoCapture> camera_;             ///< Camera capture instance
+    // Cameras and processing
+    std::vector<std::unique_ptr<CameraChannel>> channels_; ///< One capture/output pipeline per camera
     std::atomic<bool> running_;                            ///< Application running state flag
+    std::vector<int> inference_cores_;                     ///< Cores reserved for the detection workers (empty = all)
+    std::vector<int> io_cores_;                            ///< Cores for capture, encoding and publishing (empty = all)
     
-    // Timing for metadata publishing
-    std::chrono::steady_clock::time_point last_metadata_time_;
+    /// Channel counters at the start of the current QoS window
+    struct LoadTotals {
+        long long output_latency_us = 0;
+        int frames = 0;
+        long long inference_latency_us = 0;
+        int inferences = 0;
+        int captured = 0;
+        int dropped = 0;
+    };
+    std::vector<LoadTotals> qos_totals_;
+    int qos_metadata_rejected_;                            ///< Metadata rejections at the start of the QoS window
     
     // Private methods
-    bool initializeCamera();
+    bool initializeCameras();
     bool initializeComponents();
-    void processFrame(const cv::Mat& frame);
+    bool startMetadataPublisher(const ConfigManager::Config& config);
+    bool loadModel();
+    void reportFirstFrame();
+    void reloadConfig();
+    void applySettings();
+    void updateQos();
+    QosSample measureLoad();
+    void startPipeline();
+    void stopPipeline();
     void handleKeyInput(char key);
     void printStatistics();
+    void writeMetrics(std::string& out) const;
     
     // Statistics
-    int frame_count_;
-    int detection_count_;
     std::chrono::steady_clock::time_point start_time_;
+    
+    // Startup timing, reported once ready and on /metrics
+    std::chrono::steady_clock::time_point launch_time_;    ///< Construction, i.e. process start
+    std::chrono::steady_clock::time_point ready_time_;     ///< End of initialize()
+    double model_load_ms_;                                 ///< Model load, overlapped with the rest
+    double camera_open_ms_;                                ///< Opening and probing all cameras in parallel
+    double warmup_ms_;                                     ///< Warm-up inference on every camera
+    bool first_frame_reported_;
 };
 
 #endif // APPLICATION_H
\ No newline at end of file
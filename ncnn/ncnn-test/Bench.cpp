@@ -0,0 +1,495 @@
+/**
+ * @file Bench.cpp
+ * @brief Offline benchmark of the detection and streaming pipeline on recorded video
+ * @author AI Detection System
+ * @date 2025-10-14
+ *
+ * Usage: ./bench_pipeline <video_file|image_dir> [options]
+ *   --config FILE      Settings to benchmark (model, precision, tiles, encoder), default config.json
+ *   --fps N            Feed frames at N per second (0 = as fast as possible, the default)
+ *   --frames N         Stop after N frames, looping the source if needed (default: the source once)
+ *   --precision MODE   Override model_precision (fp32, fp16, int8)
+ *   --encoder NAME     Override rtsp_encoder
+ *   --no-rtsp          Leave out the RTSP server and encoder
+ *   --output FILE      Where to write the JSON report, default bench_report.json
+ *
+ * Every frame goes through the same steps as a camera in synchronous mode:
+ * detection (preprocess, forward, postprocess), drawing, metadata
+ * serialization and the RTSP push. An in-process rtspsrc client keeps the
+ * shared encoder pipeline running, so encoding is measured too. No camera
+ * or metadata server is needed.
+ *
+ * The report is one JSON object with per-stage latency percentiles,
+ * throughput, CPU usage and peak RSS, meant to be kept per build and
+ * compared between precision modes and encoder backends.
+ */
+
+#include "ConfigManager.h"
+#include "YoloDetector.h"
+#include "CropClassifier.h"
+#include "DetectionLayout.h"
+#include "RtspStreamer.h"
+#include "MetadataSerializer.h"
+#include "PipelineMetrics.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Per-call durations of one stage measured by the benchmark itself
+ */
+struct StageSamples {
+    const char* name;
+    std::vector<double> ms;
+};
+
+/**
+ * @brief Frames from a video file or from the images of a directory
+ */
+class BenchSource {
+public:
+    bool open(const std::string& path) {
+        // A directory is read as a sorted image sequence, anything else as a video
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) return false;
+        if (!S_ISDIR(info.st_mode)) {
+            return capture_.open(path) && capture_.isOpened();
+        }
+
+        std::vector<std::string> files;
+        cv::glob(path + "/*", files, false);
+        for (const auto& file : files) {
+            const std::string ext = file.substr(file.find_last_of('.') + 1);
+            if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp") {
+                images_.push_back(file);
+            }
+        }
+        std::sort(images_.begin(), images_.end());
+        return !images_.empty();
+    }
+
+    /**
+     * @brief Read the next frame
+     * @param frame Output frame
+     * @param loop Start over at the end of the source
+     * @return false at the end of the source
+     */
+    bool read(cv::Mat& frame, bool loop) {
+        if (!images_.empty()) {
+            if (next_ >= images_.size()) {
+                if (!loop) return false;
+                next_ = 0;
+            }
+            frame = cv::imread(images_[next_++]);
+            return !frame.empty();
+        }
+
+        if (capture_.read(frame) && !frame.empty()) return true;
+        if (!loop) return false;
+        capture_.set(cv::CAP_PROP_POS_FRAMES, 0);
+        return capture_.read(frame) && !frame.empty();
+    }
+
+private:
+    std::vector<std::string> images_;
+    size_t next_ = 0;
+    cv::VideoCapture capture_;
+};
+
+/**
+ * @brief Get a percentile of sorted samples
+ * @param sorted Samples in ascending order
+ * @param percent Percentile (0-100)
+ * @return Sample at the percentile, 0 if there are none
+ */
+static double percentile(const std::vector<double>& sorted, double percent) {
+    if (sorted.empty()) return 0.0;
+    const size_t index = (size_t)(percent / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/**
+ * @brief Bucket counts of a stage histogram at one point in time
+ *
+ * The histograms count from process start; the difference to a snapshot
+ * taken before the timed loop covers exactly the frames of the run.
+ */
+struct HistogramSnapshot {
+    uint64_t cumulative[LatencyHistogram::kBucketCount + 1] = {};  ///< Last entry is +Inf, i.e. the count
+    double sum_ms = 0.0;
+
+    static HistogramSnapshot take(const LatencyHistogram& histogram) {
+        HistogramSnapshot snapshot;
+        for (int b = 0; b <= LatencyHistogram::kBucketCount; b++) {
+            snapshot.cumulative[b] = histogram.getCumulativeCount(b);
+        }
+        snapshot.sum_ms = histogram.getSumMs();
+        return snapshot;
+    }
+
+    HistogramSnapshot since(const HistogramSnapshot& before) const {
+        HistogramSnapshot difference;
+        for (int b = 0; b <= LatencyHistogram::kBucketCount; b++) {
+            difference.cumulative[b] = cumulative[b] - before.cumulative[b];
+        }
+        difference.sum_ms = sum_ms - before.sum_ms;
+        return difference;
+    }
+
+    uint64_t getCount() const { return cumulative[LatencyHistogram::kBucketCount]; }
+};
+
+/**
+ * @brief Estimate a percentile from a stage histogram
+ *
+ * Used for the stages timed inside the detector and on the encoder thread,
+ * which only record into PipelineMetrics. The value is interpolated within
+ * the bucket it falls in, so it is as exact as the bucket bounds.
+ */
+static double histogramPercentile(const HistogramSnapshot& histogram, double percent) {
+    const uint64_t count = histogram.getCount();
+    if (count == 0) return 0.0;
+
+    const double rank = percent / 100.0 * count;
+    double lower = 0.0;
+    uint64_t below = 0;
+    for (int b = 0; b < LatencyHistogram::kBucketCount; b++) {
+        const uint64_t cumulative = histogram.cumulative[b];
+        const double upper = LatencyHistogram::kBucketBounds[b];
+        if (cumulative >= rank && cumulative > below) {
+            return lower + (upper - lower) * (rank - below) / (cumulative - below);
+        }
+        lower = upper;
+        below = cumulative;
+    }
+    return LatencyHistogram::kBucketBounds[LatencyHistogram::kBucketCount - 1];
+}
+
+static void writeStage(std::ostream& out, const char* name, uint64_t count, double mean,
+                       double p50, double p95, double p99, double max, bool last) {
+    out << "    \"" << name << "\": { \"count\": " << count << ", \"mean_ms\": " << mean
+        << ", \"p50_ms\": " << p50 << ", \"p95_ms\": " << p95 << ", \"p99_ms\": " << p99;
+    if (max >= 0.0) out << ", \"max_ms\": " << max;
+    out << " }" << (last ? "" : ",") << "\n";
+}
+
+static double secondsOf(const timeval& time) {
+    return time.tv_sec + time.tv_usec / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argv[1][0] == '-') {
+        std::cerr << "Usage: " << argv[0] << " <video_file|image_dir> [--config FILE] [--fps N] [--frames N]"
+                  << " [--precision MODE] [--encoder NAME] [--no-rtsp] [--output FILE]" << std::endl;
+        return -1;
+    }
+
+    const std::string source_path = argv[1];
+    std::string config_file = "config.json";
+    std::string output_file = "bench_report.json";
+    std::string precision_name;
+    std::string encoder_name;
+    double target_fps = 0.0;
+    long max_frames = 0;
+    bool use_rtsp = true;
+
+    for (int i = 2; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--config" && has_value) config_file = argv[++i];
+        else if (arg == "--fps" && has_value) target_fps = std::atof(argv[++i]);
+        else if (arg == "--frames" && has_value) max_frames = std::atol(argv[++i]);
+        else if (arg == "--precision" && has_value) precision_name = argv[++i];
+        else if (arg == "--encoder" && has_value) encoder_name = argv[++i];
+        else if (arg == "--output" && has_value) output_file = argv[++i];
+        else if (arg == "--no-rtsp") use_rtsp = false;
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    // The benchmark only reads the file; a missing one is not replaced by defaults
+    ConfigManager config_manager;
+    if (!std::ifstream(config_file).good() || !config_manager.loadConfig(config_file)) {
+        std::cerr << "Cannot read config: " << config_file << std::endl;
+        return -1;
+    }
+    ConfigManager::Config& config = config_manager.getConfig();
+    if (!precision_name.empty()) config.model_precision = precision_name;
+    if (!encoder_name.empty()) config.rtsp_encoder = encoder_name;
+
+    BenchSource source;
+    cv::Mat frame;
+    if (!source.open(source_path) || !source.read(frame, false)) {
+        std::cerr << "Cannot read frames from " << source_path << std::endl;
+        return -1;
+    }
+
+    // Detector and classifier set up as Application::loadModel() does
+    ModelRegistry models;
+    YoloDetector detector;
+    const ModelPrecision precision = parseModelPrecision(config.model_precision);
+    if (detector.load(config.model_path, config.use_gpu, precision, &models) != 0) {
+        std::cerr << "Failed to load model: " << config.model_path << std::endl;
+        return -1;
+    }
+    detector.setUsePoolAllocator(config.inference_pool_allocator);
+    detector.setClassThresholds(config.class_thresholds);
+    detector.setMaxDetections(config.max_detections);
+    detector.setMinBoxSize(config.min_box_size);
+    detector.setClassAgnosticNms(config.nms_class_agnostic);
+    if (config.inference_threads > 0) {
+        detector.setNumThreads(config.inference_threads);
+    }
+
+    CropClassifier classifier;
+    if (!config.classifier_model.empty()) {
+        CropClassifierSettings classifier_settings;
+        classifier_settings.model_path = config.classifier_model;
+        classifier_settings.labels_path = config.classifier_labels;
+        classifier_settings.classes = config.classifier_classes;
+        classifier_settings.input_size = config.classifier_input_size;
+        classifier_settings.min_size = config.classifier_min_size;
+        classifier_settings.threshold = config.classifier_threshold;
+        classifier_settings.max_crops = config.classifier_max_crops;
+        classifier_settings.use_gpu = config.use_gpu;
+        classifier_settings.precision = precision;
+        if (!classifier.load(models, classifier_settings)) {
+            return -1;
+        }
+        classifier.setNumThreads(config.inference_threads);
+    }
+
+    // Layout of the first camera, laid out on the recorded frame size
+    const ConfigManager::CameraConfig& camera = config.cameras.front();
+    std::vector<cv::Rect2f> detection_areas;
+    if (!DetectionLayout::parseAreas(camera.detection_roi, detection_areas)) {
+        std::cerr << "Invalid detection ROI, detecting on the whole frame" << std::endl;
+    }
+    const DetectionLayout layout = DetectionLayout::create(frame.size(), detection_areas, camera.tile_cols, camera.tile_rows,
+                                                           config.tile_overlap, config.tile_full_frame, camera.inference_size);
+    const bool use_layout = !layout.regions.empty() || layout.target_size > 0;
+
+    RtspStreamer streamer;
+    GstElement* client = nullptr;
+    int stream_index = -1;
+    if (use_rtsp) {
+        VideoEncoderSettings encoder;
+        encoder.encoder = config.rtsp_encoder;
+        encoder.codec = config.rtsp_codec;
+        encoder.bitrate_kbps = config.rtsp_bitrate_kbps;
+        encoder.keyframe_interval = config.rtsp_keyframe_interval;
+        encoder.sei_metadata = config.rtsp_sei_metadata;
+        encoder.queue_frames = config.rtsp_queue_frames;
+
+        const int stream_fps = target_fps > 0 ? (int)(target_fps + 0.5) : std::max(1, camera.frame_fps);
+        if (!streamer.initialize(config.rtsp_port, encoder) ||
+            (stream_index = streamer.addStream("/bench", frame.cols, frame.rows, stream_fps)) < 0 ||
+            !streamer.start()) {
+            std::cerr << "Failed to start the RTSP server" << std::endl;
+            return -1;
+        }
+
+        // The shared media pipeline, and with it the encoder, only runs while a client is connected
+        const std::string launch = "rtspsrc location=rtsp://127.0.0.1:" + std::to_string(config.rtsp_port) +
+                                   "/bench latency=0 protocols=tcp ! fakesink sync=false";
+        GError* error = nullptr;
+        client = gst_parse_launch(launch.c_str(), &error);
+        if (error) {
+            std::cerr << "RTSP client unavailable (" << error->message << "), encoding is not measured" << std::endl;
+            g_error_free(error);
+        }
+        if (client) {
+            gst_element_set_state(client, GST_STATE_PLAYING);
+            for (int i = 0; i < 100 && streamer.getClientCount() == 0; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+    }
+
+    std::unique_ptr<MetadataSerializer> serializer = MetadataSerializer::create(config.metadata_format);
+    DetectionMetadata record;
+    record.camera_id = "bench";
+    std::string payload;
+
+    // Warm up so pipeline creation and first-touch allocations are not measured
+    std::vector<Object> objects;
+    for (int i = 0; i < 3; i++) {
+        detector.detect(frame, objects, config.detection_threshold, config.nms_threshold, use_layout ? &layout : nullptr);
+        classifier.classify(frame, objects);
+    }
+
+    // Sub-stages of detect and the encoder are only in the histograms; the warm-up is subtracted out
+    PipelineMetrics& metrics = PipelineMetrics::instance();
+    const PipelineStage histogram_stages[] = { PipelineStage::Preprocess, PipelineStage::Forward, PipelineStage::Postprocess,
+                                               PipelineStage::Classify, PipelineStage::Encode };
+    std::vector<HistogramSnapshot> histograms_before;
+    for (PipelineStage stage : histogram_stages) {
+        histograms_before.push_back(HistogramSnapshot::take(metrics.getHistogram(stage)));
+    }
+
+    std::vector<StageSamples> stages = {
+        { "read", {} }, { "detect", {} }, { "draw", {} }, { "serialize", {} }, { "push", {} }, { "total", {} }
+    };
+    enum { Read, Detect, Draw, Serialize, Push, Total };
+
+    auto elapsed_ms = [](std::chrono::steady_clock::time_point from) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - from).count();
+    };
+
+    rusage usage_start;
+    getrusage(RUSAGE_SELF, &usage_start);
+    const auto bench_start = std::chrono::steady_clock::now();
+    auto next_frame_time = bench_start;
+
+    long frame_count = 0;
+    long pushed = 0;
+    long detections = 0;
+    cv::Mat annotated;
+    bool have_frame = true;  // the first frame was read while opening the source
+    while (max_frames <= 0 || frame_count < max_frames) {
+        if (target_fps > 0) {
+            std::this_thread::sleep_until(next_frame_time);
+            next_frame_time += std::chrono::microseconds((long long)(1e6 / target_fps));
+        }
+
+        const auto frame_start = std::chrono::steady_clock::now();
+        if (!have_frame && !source.read(frame, max_frames > 0)) break;
+        have_frame = false;
+        stages[Read].ms.push_back(elapsed_ms(frame_start));
+
+        auto start = std::chrono::steady_clock::now();
+        detector.detect(frame, objects, config.detection_threshold, config.nms_threshold, use_layout ? &layout : nullptr);
+        classifier.classify(frame, objects);
+        stages[Detect].ms.push_back(elapsed_ms(start));
+        detections += (long)objects.size();
+
+        start = std::chrono::steady_clock::now();
+        frame.copyTo(annotated);
+        if (config.draw_detections) {
+            YoloDetector::draw_objects(annotated, objects);
+        }
+        stages[Draw].ms.push_back(elapsed_ms(start));
+
+        start = std::chrono::steady_clock::now();
+        record.timestamp = std::chrono::system_clock::now();
+        record.frame_sequence = (uint64_t)frame_count;
+        record.frame_width = frame.cols;
+        record.frame_height = frame.rows;
+        record.objects = objects;
+        serializer->writeRecord(record, payload);
+        stages[Serialize].ms.push_back(elapsed_ms(start));
+
+        if (stream_index >= 0) {
+            start = std::chrono::steady_clock::now();
+            if (streamer.pushFrame(annotated, stream_index, payload, streamer.toClockTime(frame_start))) {
+                pushed++;
+            }
+            stages[Push].ms.push_back(elapsed_ms(start));
+        }
+
+        stages[Total].ms.push_back(elapsed_ms(frame_start));
+        frame_count++;
+    }
+
+    const double wall_seconds = elapsed_ms(bench_start) / 1000.0;
+    rusage usage_end;
+    getrusage(RUSAGE_SELF, &usage_end);
+    const double cpu_seconds = (secondsOf(usage_end.ru_utime) - secondsOf(usage_start.ru_utime)) +
+                               (secondsOf(usage_end.ru_stime) - secondsOf(usage_start.ru_stime));
+
+    // Let the encoder finish the frames still queued before its numbers are read
+    if (stream_index >= 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+
+    if (frame_count == 0) {
+        std::cerr << "No frames processed" << std::endl;
+        return -1;
+    }
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+    report << "{\n";
+    // Paths are free text, so they are quoted like the strings of the metadata records
+    std::string quoted_source, quoted_model;
+    MetadataSerializer::appendJsonString(quoted_source, source_path.c_str());
+    MetadataSerializer::appendJsonString(quoted_model, config.model_path.c_str());
+    report << "  \"source\": " << quoted_source << ",\n";
+    report << "  \"model\": " << quoted_model << ",\n";
+    report << "  \"precision\": \"" << getPrecisionName(detector.getPrecision()) << "\",\n";
+    report << "  \"use_gpu\": " << (config.use_gpu ? "true" : "false") << ",\n";
+    report << "  \"regions\": " << std::max<size_t>(1, layout.regions.size()) << ",\n";
+    report << "  \"inference_size\": " << layout.target_size << ",\n";
+    report << "  \"encoder\": \"" << (stream_index >= 0 ? streamer.getEncoderName() : "") << "\",\n";
+    report << "  \"metadata_format\": \"" << serializer->getName() << "\",\n";
+    report << "  \"frame_width\": " << frame.cols << ",\n";
+    report << "  \"frame_height\": " << frame.rows << ",\n";
+    report << "  \"target_fps\": " << target_fps << ",\n";
+    report << "  \"frames\": " << frame_count << ",\n";
+    report << "  \"detections\": " << detections << ",\n";
+    report << "  \"pushed_frames\": " << pushed << ",\n";
+    report << "  \"wall_seconds\": " << wall_seconds << ",\n";
+    report << "  \"throughput_fps\": " << frame_count / wall_seconds << ",\n";
+    report << "  \"cpu_percent\": " << 100.0 * cpu_seconds / wall_seconds << ",\n";
+    report << "  \"peak_rss_kb\": " << usage_end.ru_maxrss << ",\n";
+
+    report << "  \"stages\": {\n";
+    for (auto& stage : stages) {
+        if (stage.ms.empty()) continue;
+        double total = 0.0;
+        for (double ms : stage.ms) total += ms;
+        std::sort(stage.ms.begin(), stage.ms.end());
+        writeStage(report, stage.name, stage.ms.size(), total / stage.ms.size(), percentile(stage.ms, 50),
+                   percentile(stage.ms, 95), percentile(stage.ms, 99), stage.ms.back(), false);
+    }
+
+    // Sub-stages of detect and the encoder, estimated from their histograms over the timed frames only
+    const size_t histogram_count = sizeof(histogram_stages) / sizeof(histogram_stages[0]);
+    for (size_t s = 0; s < histogram_count; s++) {
+        const PipelineStage stage = histogram_stages[s];
+        if (stage == PipelineStage::Classify && !classifier.isLoaded()) continue;
+        const HistogramSnapshot histogram =
+            HistogramSnapshot::take(metrics.getHistogram(stage)).since(histograms_before[s]);
+        const uint64_t count = histogram.getCount();
+        writeStage(report, PipelineMetrics::getStageName(stage), count, count > 0 ? histogram.sum_ms / count : 0.0,
+                   histogramPercentile(histogram, 50), histogramPercentile(histogram, 95),
+                   histogramPercentile(histogram, 99), -1.0, s + 1 == histogram_count);
+    }
+    report << "  },\n";
+
+    double latency_avg = 0.0;
+    double latency_max = 0.0;
+    const bool has_latency = stream_index >= 0 && streamer.getLatency(stream_index, latency_avg, latency_max);
+    report << "  \"capture_to_encoded_ms\": { \"mean\": " << (has_latency ? latency_avg : 0.0)
+           << ", \"max\": " << (has_latency ? latency_max : 0.0) << " }\n";
+    report << "}\n";
+
+    if (client) {
+        gst_element_set_state(client, GST_STATE_NULL);
+        gst_object_unref(client);
+    }
+    streamer.stop();
+
+    std::ofstream out(output_file);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write " << output_file << std::endl;
+        return -1;
+    }
+    out << report.str();
+
+    std::cout << std::fixed << std::setprecision(1) << frame_count << " frames in " << wall_seconds << " s ("
+              << frame_count / wall_seconds << " fps, CPU " << 100.0 * cpu_seconds / wall_seconds << "%), report written to "
+              << output_file << std::endl;
+    return 0;
+}
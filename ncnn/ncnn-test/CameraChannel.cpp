@@ -0,0 +1,524 @@
+/**
+ * @file CameraChannel.cpp
+ * @brief Implementation of the per-camera capture and output stages
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "CameraChannel.h"
+#include "ThreadUtils.h"
+#include "PipelineMetrics.h"
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+
+CameraChannel::CameraChannel(int index, const ConfigManager::CameraConfig& camera, const ConfigManager::Config& config,
+                             const RuntimeSettingsStore& runtime, YoloDetector& detector, CropClassifier& classifier,
+                             InferencePool& pool, RtspStreamer& streamer, MetadataPublisher& publisher)
+    : index_(index), camera_config_(camera), config_(config), runtime_(runtime),
+      name_("camera_" + std::to_string(camera.camera_id)),
+      detector_(detector), classifier_(classifier), pool_(pool), streamer_(streamer), publisher_(publisher),
+      scaled_layout_scale_(1.f), running_(false), display_frame_ready_(false), clip_recorder_(nullptr),
+      frame_count_(0), capture_count_(0), inference_count_(0), detection_count_(0),
+      stale_count_(0), inference_latency_us_(0), output_latency_us_(0),
+      first_output_us_(0) {
+}
+
+CameraChannel::~CameraChannel() {
+    stop();
+}
+
+bool CameraChannel::initialize() {
+    std::cout << "Initializing camera " << camera_config_.camera_id << "..." << std::endl;
+
+    if (streamer_.hasSeiMetadata()) {
+        sei_serializer_ = MetadataSerializer::create("compact_json");
+        sei_record_.camera_id = name_;
+    }
+    
+    const std::shared_ptr<const RuntimeSettings> settings = runtime_.load();
+    motion_settings_ = settings->motion;
+    motion_gate_.configure(motion_settings_, camera_config_.motion_roi);
+    tracker_settings_ = settings->tracking;
+    tracker_.configure(tracker_settings_);
+    
+    profile_streams_.clear();
+    for (const auto& profile : config_.rtsp_profiles) {
+        // A single given dimension keeps the camera aspect ratio; 4:2:0 encoders want even sizes
+        int width = profile.width > 0 ? profile.width : camera_config_.frame_width;
+        int height = profile.height > 0 ? profile.height : camera_config_.frame_height;
+        if (profile.width > 0 && profile.height <= 0) {
+            height = (camera_config_.frame_height * width / camera_config_.frame_width + 1) & ~1;
+        } else if (profile.height > 0 && profile.width <= 0) {
+            width = (camera_config_.frame_width * height / camera_config_.frame_height + 1) & ~1;
+        }
+
+        const std::string mount = camera_config_.mount + profile.mount_suffix;
+        int stream_index = streamer_.addStream(mount, width, height, camera_config_.frame_fps, profile.bitrate_kbps);
+        if (stream_index < 0) {
+            std::cerr << "Failed to add RTSP stream " << mount << " (" << profile.name << ")" << std::endl;
+            return false;
+        }
+        profile_streams_.push_back({&profile, stream_index});
+    }
+
+    // Clips come from the first profile, normally the full-resolution stream
+    if (config_.clip_recording && !profile_streams_.empty()) {
+        ClipRecorderSettings clips;
+        clips.pre_seconds = config_.clip_pre_seconds;
+        clips.post_seconds = config_.clip_post_seconds;
+        clips.max_clip_seconds = config_.clip_max_seconds;
+        clips.buffer_mb = config_.clip_buffer_mb;
+        clips.directory = config_.clip_directory;
+        clip_recorder_ = streamer_.enableClipRecording(profile_streams_[0].stream_index, clips, name_);
+
+        std::stringstream list(config_.clip_trigger_classes);
+        std::string name;
+        clip_classes_.clear();
+        while (std::getline(list, name, ',')) {
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t") + 1);
+            if (!name.empty()) clip_classes_.push_back(name);
+        }
+    }
+
+    return true;
+}
+
+bool CameraChannel::openSource() {
+    source_ = FrameSource::create(config_.capture_backend, config_.capture_decoder);
+    if (!source_->open(camera_config_)) {
+        std::cerr << "Failed to open camera " << camera_config_.camera_id << " with " << source_->getName() << std::endl;
+        return false;
+    }
+    std::cout << "Camera " << camera_config_.camera_id << " capture backend: " << source_->getName() << std::endl;
+
+    // Test camera with timeout
+    cv::Mat test_frame;
+    bool camera_ready = false;
+    for (int i = 0; i < 20; i++) { // Increased attempts
+        if (source_->read(test_frame)) {
+            std::cout << "Camera " << camera_config_.camera_id << " initialized successfully" << std::endl;
+            std::cout << "Actual frame size: " << test_frame.cols << "x" << test_frame.rows << std::endl;
+            camera_ready = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    if (!camera_ready) {
+        std::cerr << "Camera " << camera_config_.camera_id << " test failed - no frames received" << std::endl;
+        return false;
+    }
+
+    // Regions are laid out on the delivered frame size, which may differ from the requested one
+    std::vector<cv::Rect2f> detection_areas;
+    if (!DetectionLayout::parseAreas(camera_config_.detection_roi, detection_areas)) {
+        std::cerr << "Invalid detection ROI for " << name_ << ", detecting on the whole frame" << std::endl;
+    }
+    auto layout = std::make_shared<DetectionLayout>(DetectionLayout::create(
+        test_frame.size(), detection_areas, camera_config_.tile_cols, camera_config_.tile_rows,
+        config_.tile_overlap, config_.tile_full_frame, camera_config_.inference_size));
+    detection_layout_.reset();
+    if (!layout->regions.empty() || layout->target_size > 0) {
+        std::cout << "Camera " << camera_config_.camera_id << " detection: " << std::max<size_t>(1, layout->regions.size())
+                  << " region(s) at input size " << (layout->target_size > 0 ? std::to_string(layout->target_size) : "default")
+                  << std::endl;
+        detection_layout_ = layout;
+    }
+
+    // Kept for warmUp(), the only real frame available before the pipeline starts
+    warmup_frame_ = test_frame;
+    return true;
+}
+
+void CameraChannel::warmUp() {
+    if (warmup_frame_.empty()) return;
+
+    // The first inference pays for NCNN's lazy allocations; do it with this camera's layout now
+    std::vector<Object> objects;
+    detector_.detect(warmup_frame_, objects, config_.detection_threshold, config_.nms_threshold, detection_layout_.get());
+    classifier_.classify(warmup_frame_, objects);
+    warmup_frame_.release();
+}
+
+std::string CameraChannel::getStreamUrls() const {
+    std::string urls;
+    for (const auto& stream : profile_streams_) {
+        if (!urls.empty()) urls += ", ";
+        urls += streamer_.getStreamUrl(stream.stream_index);
+    }
+    return urls;
+}
+
+bool CameraChannel::start() {
+    if (running_) return true;
+
+    size_t queue_size = config_.frame_queue_size > 0 ? config_.frame_queue_size : 2;
+    output_queue_ = std::make_unique<FrameQueue<FrameContext>>(queue_size, parseOverflowPolicy(config_.frame_queue_policy));
+
+    last_metadata_time_ = std::chrono::steady_clock::now();
+
+    running_ = true;
+    output_thread_ = std::thread(&CameraChannel::outputLoop, this);
+    capture_thread_ = std::thread(&CameraChannel::captureLoop, this);
+    return true;
+}
+
+void CameraChannel::stop() {
+    running_ = false;
+    if (output_queue_) output_queue_->close();
+
+    if (capture_thread_.joinable()) {
+        capture_thread_.join();
+    }
+    if (output_thread_.joinable()) {
+        output_thread_.join();
+    }
+
+    if (source_) {
+        source_->close();
+    }
+}
+
+void CameraChannel::updateMotionGate(const RuntimeSettings& settings) {
+    // Rebuilt only when its own settings changed: configure() drops the background
+    if (settings.motion != motion_settings_) {
+        motion_settings_ = settings.motion;
+        motion_gate_.configure(motion_settings_, camera_config_.motion_roi);
+    }
+}
+
+const std::shared_ptr<const DetectionLayout>& CameraChannel::getDetectionLayout(const RuntimeSettings& settings) {
+    const float scale = settings.detection_input_scale;
+    if (scale >= 1.f) return detection_layout_;
+
+    // Rebuilt only when the QoS controller changes the scale
+    if (!scaled_layout_ || scale != scaled_layout_scale_) {
+        std::shared_ptr<DetectionLayout> layout =
+            std::make_shared<DetectionLayout>(detection_layout_ ? *detection_layout_ : DetectionLayout());
+        const int size = layout->target_size > 0 ? layout->target_size : detector_.getInputSize();
+        layout->target_size = std::max(160, (int)(size * scale) / 32 * 32);
+        scaled_layout_ = layout;
+        scaled_layout_scale_ = scale;
+    }
+    return scaled_layout_;
+}
+
+bool CameraChannel::isClipTrigger(const Object& object) const {
+    if (clip_classes_.empty()) return true;
+    const std::string name = YoloDetector::getClassName(object.label);
+    return std::find(clip_classes_.begin(), clip_classes_.end(), name) != clip_classes_.end();
+}
+
+void CameraChannel::captureLoop() {
+    setCurrentThreadName("capture-" + std::to_string(index_));
+
+    RuntimeSettingsReader runtime(runtime_);
+    uint64_t sequence = 0;
+    while (running_) {
+        // A fresh Mat per frame: the previous one is still shared with the other stages
+        FrameContext frame;
+        frame.camera = index_;
+
+        // Capture frame with timeout protection
+        bool frame_captured = false;
+        for (int retry = 0; retry < 3; retry++) {
+            const auto read_start = std::chrono::steady_clock::now();
+            if (source_->read(frame.image)) {
+                PipelineMetrics::instance().record(PipelineStage::Capture,
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - read_start).count());
+                frame_captured = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        if (!frame_captured) {
+            std::cerr << "Failed to capture frame from " << name_ << " after retries" << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+        // Backends that timestamp their buffers report the capture itself, not the end of decode
+        const auto read_time = std::chrono::steady_clock::now();
+        frame.wall_time = std::chrono::system_clock::now();
+        if (source_->getCaptureTime(frame.capture_time) && frame.capture_time <= read_time) {
+            frame.wall_time -= std::chrono::duration_cast<std::chrono::system_clock::duration>(read_time - frame.capture_time);
+        } else {
+            frame.capture_time = read_time;
+        }
+        frame.sequence = sequence++;
+        frame.settings = runtime.get();
+        frame.layout = getDetectionLayout(*frame.settings);
+
+        // Both stages only read the frame, so they can share its pixel data
+        if (config_.async_detection) {
+            updateMotionGate(*frame.settings);
+            if (capture_count_ % std::max(1, frame.settings->detection_interval) == 0 && motion_gate_.shouldDetect(frame)) {
+                pool_.submit(index_, frame);
+            }
+        }
+        capture_count_++;
+
+        output_queue_->push(std::move(frame));
+    }
+}
+
+void CameraChannel::outputLoop() {
+    setCurrentThreadName("output-" + std::to_string(index_));
+
+    // Output stage: paced by the capture thread; in async mode never by inference
+    FrameContext frame;
+    std::vector<Object> objects;
+    while (running_) {
+        if (!output_queue_->waitPop(frame, std::chrono::milliseconds(100))) {
+            continue;
+        }
+        const RuntimeSettings& settings = *frame.settings;
+
+        // A frame that waited too long would only add latency to the stream
+        if (settings.max_frame_age_ms > 0 && frame.ageMs() > settings.max_frame_age_ms) {
+            stale_count_++;
+            continue;
+        }
+
+        // Shed by the QoS controller: neither detected (in synchronous mode) nor encoded
+        if (frame.sequence % (uint64_t)std::max(1, settings.output_frame_stride) != 0) {
+            continue;
+        }
+
+        if (config_.async_detection) {
+            if (!settings.tracking.enabled) pool_.getLatest(index_, objects);
+        } else {
+            updateMotionGate(settings);
+            if (frame_count_ % std::max(1, settings.detection_interval) == 0 && motion_gate_.shouldDetect(frame)) {
+                detector_.detect(frame.image, objects, settings.detection_threshold, settings.nms_threshold, frame.layout.get());
+                classifier_.classify(frame.image, objects);
+                onDetections(frame, objects);
+            }
+        }
+
+        // Tracks move on between detector runs instead of the last boxes standing still
+        if (settings.tracking.enabled) {
+            tracker_.predict(frame.capture_time, objects);
+        }
+
+        processFrame(frame, objects);
+
+        output_latency_us_ += (long long)(frame.ageMs() * 1000.0);
+        frame_count_++;
+        if (first_output_us_ == 0) {
+            first_output_us_ = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+}
+
+void CameraChannel::onDetections(const FrameContext& frame, const std::vector<Object>& objects) {
+    inference_latency_us_ += (long long)(frame.ageMs() * 1000.0);
+    inference_count_++;
+    if (!objects.empty()) {
+        detection_count_ += objects.size();
+    }
+
+    std::lock_guard<std::mutex> lock(metadata_mutex_);
+    const RuntimeSettings& settings = *frame.settings;
+
+    // Reconfiguring ends all tracks, so only do it when the tracker settings changed
+    if (settings.tracking != tracker_settings_) {
+        tracker_settings_ = settings.tracking;
+        tracker_.configure(tracker_settings_);
+        track_events_.clear();
+    }
+
+    // Results of one camera arrive in capture order, so the tracker sees them in order too
+    const std::vector<Object>* published = &objects;
+    bool clip_event = false;
+    if (settings.tracking.enabled) {
+        const size_t first_event = track_events_.size();
+        tracker_.update(objects, frame.capture_time, track_events_);
+        tracker_.getTracks(tracked_objects_);
+        published = &tracked_objects_;
+
+        // With tracking a clip starts when a new object is confirmed, not on every detection of it
+        for (size_t i = first_event; i < track_events_.size() && clip_recorder_; i++) {
+            clip_event |= track_events_[i].type == TrackEvent::Enter && isClipTrigger(track_events_[i].object);
+        }
+    } else if (clip_recorder_) {
+        for (const auto& object : objects) {
+            clip_event |= isClipTrigger(object);
+        }
+    }
+    if (clip_event) {
+        clip_recorder_->trigger(streamer_.toClockTime(frame.capture_time));
+    }
+
+    if (settings.tracking.enabled) {
+        // Event mode only sends changes; events wait here until a record carrying them is queued
+        if (settings.metadata_mode == "events") {
+            if (track_events_.empty()) {
+                return;
+            }
+
+            // Only the tracks the events name; exited ones are gone and carry their last box in the event
+            event_objects_.clear();
+            for (const auto& object : tracked_objects_) {
+                for (const auto& event : track_events_) {
+                    if (event.object.track_id == object.track_id) {
+                        event_objects_.push_back(object);
+                        break;
+                    }
+                }
+            }
+            published = &event_objects_;
+        }
+    }
+
+    // Publish metadata at configured interval
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_metadata_time_);
+
+    // A rejected record is retried with the next result rather than waiting a whole interval
+    if (elapsed.count() >= settings.metadata_publish_interval_ms &&
+        publisher_.publishDetections(*published, frame, name_, track_events_)) {
+        last_metadata_time_ = now;
+        track_events_.clear();
+    }
+}
+
+void CameraChannel::processFrame(const FrameContext& context, const std::vector<Object>& objects) {
+    const cv::Mat& frame = context.image;
+    const bool draw = context.settings->draw_detections && !objects.empty();
+
+    // Detections are drawn once at capture resolution and shared by all annotated profiles.
+    // A BGR stream of that size is drawn on in place, otherwise a reused scratch copy is;
+    // every other profile gets its frame scaled/converted straight into its pooled buffer.
+    RtspStreamer::OutputFrame output;
+    int direct_stream = -1;
+    std::vector<int> rejected_streams;  // in-place candidates appsrc turned away, already counted as dropped
+    cv::Mat annotated = frame;          // read-only unless drawn on
+    auto rejected = [&rejected_streams](int stream_index) {
+        return std::find(rejected_streams.begin(), rejected_streams.end(), stream_index) != rejected_streams.end();
+    };
+    if (draw) {
+        for (const auto& stream : profile_streams_) {
+            if (!stream.profile->annotated || !streamer_.isBgrStream(stream.stream_index) ||
+                streamer_.getStreamSize(stream.stream_index) != frame.size()) {
+                continue;
+            }
+            // Don't take a pooled buffer and draw into it only to have it dropped
+            if (!streamer_.admitFrame(stream.stream_index)) {
+                rejected_streams.push_back(stream.stream_index);
+                continue;
+            }
+            if (streamer_.acquireFrame(stream.stream_index, output, frame)) {
+                direct_stream = stream.stream_index;
+                annotated = output.image;
+                break;
+            }
+        }
+        // Without an in-place buffer, draw into the scratch copy only if someone still shows it
+        bool draw_scratch = config_.show_display;
+        for (const auto& stream : profile_streams_) {
+            if (stream.profile->annotated && !rejected(stream.stream_index)) {
+                draw_scratch = true;
+            }
+        }
+        if (direct_stream < 0 && draw_scratch) {
+            frame.copyTo(annotated_frame_);
+            annotated = annotated_frame_;
+        }
+        if (direct_stream >= 0 || draw_scratch) {
+            ScopedStageTimer timer(PipelineStage::Draw);
+            YoloDetector::draw_objects(annotated, objects);
+        }
+    }
+
+    // Pooled buffers go to appsrc and the capture frame is shared, so the display needs its own copy
+    cv::Mat display_frame;
+    if (config_.show_display) {
+        display_frame = annotated.clone();
+    }
+
+    // Every frame gets a record, so clients can tell "nothing detected" from "no metadata"
+    if (sei_serializer_) {
+        sei_record_.timestamp = context.wall_time;
+        sei_record_.frame_sequence = context.sequence;
+        sei_record_.frame_width = frame.cols;
+        sei_record_.frame_height = frame.rows;
+        sei_record_.objects = objects;
+        sei_serializer_->writeRecord(sei_record_, sei_payload_);
+    }
+
+    // Send frame to every RTSP profile; the in-place buffer goes last since the others read from it
+    const GstClockTime capture_time = streamer_.toClockTime(context.capture_time);
+    {
+        ScopedStageTimer timer(PipelineStage::Push);
+        for (const auto& stream : profile_streams_) {
+            if (stream.stream_index != direct_stream && !rejected(stream.stream_index)) {
+                streamer_.pushFrame(stream.profile->annotated ? annotated : frame, stream.stream_index, sei_payload_, capture_time);
+            }
+        }
+        if (output.buffer) {
+            streamer_.pushFrame(output, direct_stream, sei_payload_, capture_time);
+        }
+    }
+
+    // Hand the frame to the display loop if enabled
+    if (config_.show_display) {
+        // Add status overlay
+        std::string status = "Frame: " + std::to_string(frame_count_) +
+                           " | Detections: " + std::to_string(objects.size()) +
+                           " | Queue: " + std::to_string(publisher_.getQueueSize());
+
+        cv::putText(display_frame, status, cv::Point(10, 30),
+                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+
+        std::lock_guard<std::mutex> lock(display_mutex_);
+        display_frame_ = display_frame;
+        display_frame_ready_ = true;
+    }
+}
+
+bool CameraChannel::getDisplayFrame(cv::Mat& frame) {
+    std::lock_guard<std::mutex> lock(display_mutex_);
+    if (!display_frame_ready_) return false;
+
+    frame = display_frame_;
+    display_frame_ready_ = false;
+    return true;
+}
+
+void CameraChannel::resetStatistics() {
+    frame_count_ = 0;
+    capture_count_ = 0;
+    inference_count_ = 0;
+    detection_count_ = 0;
+    stale_count_ = 0;
+    motion_gate_.resetStatistics();
+    inference_latency_us_ = 0;
+    output_latency_us_ = 0;
+}
+
+int CameraChannel::getDroppedCount() const {
+    int dropped = pool_.getDroppedCount(index_) + stale_count_;
+    if (output_queue_) {
+        dropped += (int)output_queue_->getDroppedCount();
+    }
+    return dropped;
+}
+
+double CameraChannel::getInferenceLatencyMs() const {
+    const int count = inference_count_;
+    return count > 0 ? inference_latency_us_ / 1000.0 / count : 0.0;
+}
+
+double CameraChannel::getOutputLatencyMs() const {
+    const int count = frame_count_;
+    return count > 0 ? output_latency_us_ / 1000.0 / count : 0.0;
+}
+
+int CameraChannel::getOutputQueueSize() const {
+    return output_queue_ ? (int)output_queue_->size() : 0;
+}
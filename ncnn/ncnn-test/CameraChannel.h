@@ -0,0 +1,225 @@
+/**
+ * @file CameraChannel.h
+ * @brief Capture and output stages of a single camera
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef CAMERA_CHANNEL_H
+#define CAMERA_CHANNEL_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConfigManager.h"
+#include "YoloDetector.h"
+#include "CropClassifier.h"
+#include "RtspStreamer.h"
+#include "MetadataPublisher.h"
+#include "InferencePool.h"
+#include "FrameQueue.h"
+#include "FrameContext.h"
+#include "FrameSource.h"
+#include "MotionGate.h"
+#include "ObjectTracker.h"
+#include "RuntimeSettings.h"
+
+/**
+ * @class CameraChannel
+ * @brief Owns one camera, its capture thread and its output stage
+ *
+ * The capture thread reads frames at the camera rate, submits every Nth frame
+ * that the motion gate lets through to the shared InferencePool and queues
+ * every frame for the output thread, which draws the camera's latest
+ * detections and pushes the frame to the camera's RTSP mount point.
+ */
+class CameraChannel {
+public:
+    /**
+     * @brief Constructor
+     * @param index Camera index (position in the configured camera list)
+     * @param camera Camera settings
+     * @param config Global application settings (must outlive this object)
+     * @param runtime Settings that may change while running, attached to every captured frame
+     * @param detector Shared detector, used directly in synchronous mode
+     * @param classifier Shared second stage, used directly in synchronous mode
+     * @param pool Shared inference pool, used in asynchronous mode
+     * @param streamer Shared RTSP server
+     * @param publisher Shared metadata publisher
+     */
+    CameraChannel(int index, const ConfigManager::CameraConfig& camera, const ConfigManager::Config& config,
+                  const RuntimeSettingsStore& runtime, YoloDetector& detector, CropClassifier& classifier,
+                  InferencePool& pool, RtspStreamer& streamer, MetadataPublisher& publisher);
+
+    /**
+     * @brief Destructor
+     */
+    ~CameraChannel();
+
+    /**
+     * @brief Configure the per-camera stages and register the RTSP mount points
+     * @return true if initialization successful, false otherwise
+     */
+    bool initialize();
+
+    /**
+     * @brief Open the camera and wait for its first frame
+     * @return true if the camera delivers frames, false otherwise
+     *
+     * Independent of initialize() and of the other cameras, so all cameras can
+     * be probed at the same time.
+     */
+    bool openSource();
+
+    /**
+     * @brief Run one detection on the first captured frame so the first real one is not slower
+     */
+    void warmUp();
+
+    /**
+     * @brief Start the capture and output threads
+     * @return true if started successfully, false otherwise
+     */
+    bool start();
+
+    /**
+     * @brief Stop the threads and release the camera
+     */
+    void stop();
+
+    /**
+     * @brief Handle a detection result for this camera
+     * @param frame Frame the detections belong to
+     * @param objects Detected objects
+     */
+    void onDetections(const FrameContext& frame, const std::vector<Object>& objects);
+
+    /**
+     * @brief Get the most recent annotated frame for local display
+     * @param frame Output frame (left untouched if no new frame is available)
+     * @return true if a new frame was returned
+     */
+    bool getDisplayFrame(cv::Mat& frame);
+
+    /**
+     * @brief Get a printable name of this camera
+     * @return Camera identifier string, e.g. "camera_2"
+     */
+    const std::string& getName() const { return name_; }
+
+    /**
+     * @brief Get the RTSP URLs of this camera, one per stream profile
+     * @return Comma-separated stream URLs
+     */
+    std::string getStreamUrls() const;
+
+    /**
+     * @brief Reset the frame and detection counters
+     */
+    void resetStatistics();
+
+    int getCaptureCount() const { return capture_count_; }       ///< Frames read from the source
+    int getFrameCount() const { return frame_count_; }           ///< Frames pushed by the output stage
+    int getInferenceCount() const { return inference_count_; }   ///< Detection results received
+    int getDetectionCount() const { return detection_count_; }   ///< Total detected objects
+    int getDroppedCount() const;                                 ///< Frames dropped before output or inference
+    double getInferenceLatencyMs() const;                        ///< Average capture-to-detection-result latency
+    double getOutputLatencyMs() const;                           ///< Average capture-to-RTSP-push latency
+    long long getInferenceLatencyTotalUs() const { return inference_latency_us_; } ///< Sum behind getInferenceLatencyMs()
+    long long getOutputLatencyTotalUs() const { return output_latency_us_; }       ///< Sum behind getOutputLatencyMs()
+    int getOutputQueueSize() const;                              ///< Captured frames waiting for the output stage
+    int getMotionSkippedCount() const { return motion_gate_.getSkippedCount(); } ///< Detections skipped on static frames
+    int getTrackCount() const { return tracker_.getActiveCount(); }              ///< Confirmed tracks
+    int getClipCount() const { return clip_recorder_ ? clip_recorder_->getClipCount() : 0; } ///< Event clips written
+
+    /**
+     * @brief Get the time the first frame was pushed to RTSP (not affected by resetStatistics())
+     * @param time Output time point
+     * @return false if no frame has been pushed yet
+     */
+    bool getFirstOutputTime(std::chrono::steady_clock::time_point& time) const {
+        const long long us = first_output_us_;
+        if (us == 0) return false;
+        time = std::chrono::steady_clock::time_point(std::chrono::microseconds(us));
+        return true;
+    }
+
+private:
+    int index_;
+    ConfigManager::CameraConfig camera_config_;
+    const ConfigManager::Config& config_;
+    const RuntimeSettingsStore& runtime_;
+    std::string name_;
+
+    YoloDetector& detector_;
+    CropClassifier& classifier_;
+    InferencePool& pool_;
+    RtspStreamer& streamer_;
+    MetadataPublisher& publisher_;
+    
+    /// RTSP stream fed for one of config_.rtsp_profiles
+    struct ProfileStream {
+        const ConfigManager::StreamProfile* profile;
+        int stream_index;
+    };
+    std::vector<ProfileStream> profile_streams_;
+
+    std::unique_ptr<FrameSource> source_;
+    std::unique_ptr<FrameQueue<FrameContext>> output_queue_;
+    MotionGate motion_gate_;    ///< Used by the stage that feeds the detector
+    MotionGateSettings motion_settings_;   ///< Settings motion_gate_ was configured with
+    ObjectTracker tracker_;     ///< Updated with each result, predicted for each output frame
+    TrackerSettings tracker_settings_;     ///< Settings tracker_ was configured with, under metadata_mutex_
+    std::shared_ptr<const DetectionLayout> detection_layout_;  ///< Attached to every captured frame (empty = whole frame)
+    std::shared_ptr<const DetectionLayout> scaled_layout_;     ///< detection_layout_ at the QoS input scale, capture thread only
+    float scaled_layout_scale_;
+    cv::Mat warmup_frame_;      ///< First frame of the camera until warmUp() has used it
+    cv::Mat annotated_frame_;   ///< Drawing scratch for YUV streams, reused by the output thread
+    
+    // Per-frame SEI metadata, encoded on the output thread
+    std::unique_ptr<MetadataSerializer> sei_serializer_;
+    DetectionMetadata sei_record_;
+    std::string sei_payload_;
+    std::thread capture_thread_;
+    std::thread output_thread_;
+    std::atomic<bool> running_;
+
+    // Latest annotated frame for the display loop on the main thread
+    cv::Mat display_frame_;
+    bool display_frame_ready_;
+    std::mutex display_mutex_;
+
+    // Timing for metadata publishing
+    std::chrono::steady_clock::time_point last_metadata_time_;
+    std::vector<Object> tracked_objects_;     ///< Confirmed tracks of the last result
+    std::vector<TrackEvent> track_events_;    ///< Events not yet queued for publishing
+    std::vector<Object> event_objects_;       ///< Tracks named by the pending events (events mode)
+    ClipRecorder* clip_recorder_;             ///< Ring of the first profile's encoded video (owned by the streamer)
+    std::vector<std::string> clip_classes_;   ///< Classes that trigger a clip (empty = any)
+    std::mutex metadata_mutex_;
+
+    // Statistics
+    std::atomic<int> frame_count_;
+    std::atomic<int> capture_count_;
+    std::atomic<int> inference_count_;
+    std::atomic<int> detection_count_;
+    std::atomic<int> stale_count_;                 ///< Frames too old to be worth output
+    std::atomic<long long> inference_latency_us_;  ///< Sum over inference_count_ results
+    std::atomic<long long> output_latency_us_;     ///< Sum over frame_count_ frames
+    std::atomic<long long> first_output_us_;       ///< steady_clock time of the first pushed frame (0 = none yet)
+
+    void updateMotionGate(const RuntimeSettings& settings);
+    const std::shared_ptr<const DetectionLayout>& getDetectionLayout(const RuntimeSettings& settings);
+    bool isClipTrigger(const Object& object) const;
+    void captureLoop();
+    void outputLoop();
+    void processFrame(const FrameContext& frame, const std::vector<Object>& objects);
+};
+
+#endif // CAMERA_CHANNEL_H
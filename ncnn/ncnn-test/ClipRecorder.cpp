@@ -0,0 +1,293 @@
+/**
+ * @file ClipRecorder.cpp
+ * @brief Implementation of the encoded ring buffer and the MP4 clip writer
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "ClipRecorder.h"
+#include "ThreadUtils.h"
+#include <gst/app/gstappsrc.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+// Clips cut while the writer is still busy; more are dropped rather than held in memory
+const size_t kMaxQueuedClips = 2;
+}
+
+ClipRecorder::ClipRecorder()
+    : max_bytes_(0), base_index_(0), caps_(nullptr), last_time_(GST_CLOCK_TIME_NONE), last_delta_(true),
+      pending_(false), pending_start_(0), pending_end_(0), pending_limit_(0), running_(false),
+      stamp_repeat_(0), clip_count_(0), failed_count_(0), buffered_bytes_(0) {
+}
+
+ClipRecorder::~ClipRecorder() {
+    stop();
+
+    for (auto& unit : units_) {
+        gst_buffer_unref(unit.buffer);
+    }
+    units_.clear();
+    if (caps_) {
+        gst_caps_unref(caps_);
+    }
+}
+
+bool ClipRecorder::start(const ClipRecorderSettings& settings, const std::string& name) {
+    if (mkdir(settings.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create clip directory: " << settings.directory << std::endl;
+        return false;
+    }
+
+    settings_ = settings;
+    settings_.pre_seconds = std::max(0, settings.pre_seconds);
+    settings_.post_seconds = std::max(0, settings.post_seconds);
+    settings_.max_clip_seconds = std::max(settings_.pre_seconds + settings_.post_seconds, settings.max_clip_seconds);
+    max_bytes_ = (size_t)std::max(1, settings.buffer_mb) * 1024 * 1024;
+    name_ = name;
+
+    running_ = true;
+    writer_ = std::thread(&ClipRecorder::writerLoop, this);
+
+    std::cout << "Clip recording for " << name_ << ": " << settings_.pre_seconds << " s before, "
+              << settings_.post_seconds << " s after each event, up to " << settings.buffer_mb << " MB, into "
+              << settings_.directory << std::endl;
+    return true;
+}
+
+void ClipRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+
+        // An event waiting for its end still gets the video recorded so far
+        if (pending_) {
+            cutClipLocked();
+        }
+        running_ = false;
+    }
+    clips_cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+void ClipRecorder::addBuffer(GstBuffer* buffer, GstCaps* caps, GstClockTime clock_time) {
+    if (!GST_CLOCK_TIME_IS_VALID(clock_time)) return;
+
+    const bool delta = GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+
+    // NAL-aligned encoders send the parameter sets and slices of a keyframe as
+    // separate buffers; the keyframe starts at the first of them
+    const bool keyframe = !delta && (last_delta_ || clock_time != last_time_);
+    last_delta_ = delta;
+    last_time_ = clock_time;
+
+    // Nothing before the first keyframe can be decoded
+    if (keyframes_.empty() && !keyframe) return;
+
+    if (caps && caps != caps_) {
+        if (caps_) gst_caps_unref(caps_);
+        caps_ = gst_caps_ref(caps);
+    }
+
+    // Pooled buffers belong to the encoder, which would stall if the ring held them for seconds
+    Unit unit;
+    unit.buffer = buffer->pool ? gst_buffer_copy_deep(buffer) : gst_buffer_ref(buffer);
+    unit.time = clock_time;
+    unit.keyframe = keyframe;
+    if (keyframe) {
+        keyframes_.push_back(base_index_ + units_.size());
+    }
+    units_.push_back(unit);
+    buffered_bytes_ += gst_buffer_get_size(unit.buffer);
+
+    if (pending_ && clock_time >= pending_end_) {
+        cutClipLocked();
+    }
+    trimLocked(clock_time);
+}
+
+void ClipRecorder::trigger(GstClockTime clock_time) {
+    if (!GST_CLOCK_TIME_IS_VALID(clock_time)) return;
+
+    const GstClockTime pre = (GstClockTime)settings_.pre_seconds * GST_SECOND;
+    const GstClockTime post = (GstClockTime)settings_.post_seconds * GST_SECOND;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+
+    if (!pending_) {
+        pending_ = true;
+        pending_start_ = clock_time > pre ? clock_time - pre : 0;
+        pending_end_ = clock_time + post;
+        pending_limit_ = pending_start_ + (GstClockTime)settings_.max_clip_seconds * GST_SECOND;
+        pending_wall_time_ = std::chrono::system_clock::now();
+    } else {
+        pending_end_ = std::min(std::max(pending_end_, clock_time + post), pending_limit_);
+    }
+}
+
+void ClipRecorder::trimLocked(GstClockTime now) {
+    const GstClockTime history = (GstClockTime)settings_.pre_seconds * GST_SECOND;
+    GstClockTime keep_from = now > history ? now - history : 0;
+    if (pending_) {
+        keep_from = std::min(keep_from, pending_start_);
+    }
+
+    // Drop the oldest GOP while the next one still starts early enough, or while over the cap
+    while (keyframes_.size() > 1) {
+        const Unit& next_gop = units_[keyframes_[1] - base_index_];
+        if (next_gop.time > keep_from && buffered_bytes_ <= max_bytes_) break;
+
+        while (base_index_ < keyframes_[1]) {
+            buffered_bytes_ -= gst_buffer_get_size(units_.front().buffer);
+            gst_buffer_unref(units_.front().buffer);
+            units_.pop_front();
+            base_index_++;
+        }
+        keyframes_.pop_front();
+    }
+}
+
+void ClipRecorder::cutClipLocked() {
+    pending_ = false;
+    if (keyframes_.empty() || !caps_) return;
+
+    // Start at the last keyframe at or before the requested start, or the oldest one kept
+    size_t first = (size_t)(keyframes_.front() - base_index_);
+    for (uint64_t index : keyframes_) {
+        const size_t position = (size_t)(index - base_index_);
+        if (units_[position].time > pending_start_) break;
+        first = position;
+    }
+
+    if (clips_.size() >= kMaxQueuedClips) {
+        std::cerr << "Clip writer busy, dropping clip of " << name_ << std::endl;
+        failed_count_++;
+        return;
+    }
+
+    Clip clip;
+    clip.caps = gst_caps_ref(caps_);
+    for (size_t i = first; i < units_.size() && units_[i].time <= pending_end_; i++) {
+        Unit unit = units_[i];
+        gst_buffer_ref(unit.buffer);
+        clip.units.push_back(unit);
+    }
+
+    // Milliseconds keep two events within one second apart; a counter covers the rest
+    char stamp[48];
+    const std::time_t wall_time = std::chrono::system_clock::to_time_t(pending_wall_time_);
+    const int milliseconds = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       pending_wall_time_.time_since_epoch()).count() % 1000);
+    std::tm local_time;
+    localtime_r(&wall_time, &local_time);
+    const size_t length = std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local_time);
+    std::snprintf(stamp + length, sizeof(stamp) - length, "-%03d", milliseconds);
+    stamp_repeat_ = last_stamp_ == stamp ? stamp_repeat_ + 1 : 0;
+    last_stamp_ = stamp;
+    clip.path = settings_.directory + "/" + name_ + "_" + stamp +
+                (stamp_repeat_ > 0 ? "_" + std::to_string(stamp_repeat_) : std::string()) + ".mp4";
+
+    clips_.push_back(std::move(clip));
+    clips_cv_.notify_one();
+}
+
+void ClipRecorder::writerLoop() {
+    setCurrentThreadName("clips-" + name_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        clips_cv_.wait(lock, [this] { return !running_ || !clips_.empty(); });
+        if (clips_.empty()) break;
+
+        Clip clip = std::move(clips_.front());
+        clips_.pop_front();
+        lock.unlock();
+
+        if (writeClip(clip)) {
+            clip_count_++;
+            std::cout << "Clip written: " << clip.path << std::endl;
+        } else {
+            failed_count_++;
+        }
+        releaseClip(clip);
+
+        lock.lock();
+    }
+}
+
+bool ClipRecorder::writeClip(const Clip& clip) {
+    if (clip.units.empty()) return false;
+
+    const GstStructure* structure = gst_caps_get_structure(clip.caps, 0);
+    const bool h265 = std::string(gst_structure_get_name(structure)) == "video/x-h265";
+    const std::string launch = std::string("appsrc name=src format=time ! ") + (h265 ? "h265parse" : "h264parse") +
+                               " ! mp4mux ! filesink location=\"" + clip.path + "\"";
+
+    GError* error = nullptr;
+    GstElement* pipeline = gst_parse_launch(launch.c_str(), &error);
+    if (error) {
+        std::cerr << "Cannot create clip pipeline: " << error->message << std::endl;
+        g_error_free(error);
+        if (pipeline) gst_object_unref(pipeline);
+        return false;
+    }
+
+    GstElement* src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    gst_app_src_set_caps(GST_APP_SRC(src), clip.caps);
+
+    // Shallow copies with the clip's own timeline; the encoded memory is shared.
+    // The live encoders run without B-frames, so DTS follows PTS.
+    const GstClockTime origin = clip.units.front().time;
+    for (const auto& unit : clip.units) {
+        GstBuffer* buffer = gst_buffer_copy(unit.buffer);
+        GST_BUFFER_PTS(buffer) = unit.time - origin;
+        GST_BUFFER_DTS(buffer) = unit.time - origin;
+        gst_app_src_push_buffer(GST_APP_SRC(src), buffer);
+    }
+    gst_app_src_end_of_stream(GST_APP_SRC(src));
+    gst_object_unref(src);
+
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* message = gst_bus_timed_pop_filtered(bus, 30 * GST_SECOND,
+                                                     (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    const bool written = message && GST_MESSAGE_TYPE(message) == GST_MESSAGE_EOS;
+    if (!message) {
+        std::cerr << "Timed out writing clip " << clip.path << std::endl;
+    } else if (!written) {
+        GError* message_error = nullptr;
+        gchar* debug = nullptr;
+        gst_message_parse_error(message, &message_error, &debug);
+        std::cerr << "Failed to write clip " << clip.path << ": " << (message_error ? message_error->message : "unknown error") << std::endl;
+        if (message_error) g_error_free(message_error);
+        g_free(debug);
+    }
+    if (message) gst_message_unref(message);
+    gst_object_unref(bus);
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return written;
+}
+
+void ClipRecorder::releaseClip(Clip& clip) {
+    for (auto& unit : clip.units) {
+        gst_buffer_unref(unit.buffer);
+    }
+    clip.units.clear();
+    if (clip.caps) {
+        gst_caps_unref(clip.caps);
+        clip.caps = nullptr;
+    }
+}
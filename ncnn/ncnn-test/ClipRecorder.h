@@ -0,0 +1,145 @@
+/**
+ * @file ClipRecorder.h
+ * @brief Ring buffer of encoded video with event-triggered MP4 export
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef CLIP_RECORDER_H
+#define CLIP_RECORDER_H
+
+#include <gst/gst.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct ClipRecorderSettings
+ * @brief History kept per stream and length of the exported clips
+ */
+struct ClipRecorderSettings {
+    int pre_seconds = 10;          ///< Video kept from before the event
+    int post_seconds = 10;         ///< Video recorded after the last event of a clip
+    int max_clip_seconds = 60;     ///< Later events stop extending a clip beyond this length
+    int buffer_mb = 32;            ///< Memory cap of the ring; the oldest GOPs go first
+    std::string directory = "clips"; ///< Where the MP4 files are written
+};
+
+/**
+ * @class ClipRecorder
+ * @brief Keeps the last seconds of one encoded stream and writes clips around events
+ *
+ * addBuffer() is called on the streaming thread with every buffer leaving
+ * the encoder. The buffer is kept by reference, so the encoded data is
+ * never copied; buffers from a pool (hardware encoders) are copied once so
+ * the encoder does not run out of them. The ring is indexed by keyframe and
+ * trimmed a whole GOP at a time, which keeps every clip decodable from its
+ * first frame.
+ *
+ * trigger() marks an event at a clock time. Once the stream has reached the
+ * end of the clip, the buffers from the last keyframe before the start are
+ * handed to a writer thread that muxes them into MP4 with a short parse !
+ * mp4mux ! filesink pipeline; the streaming thread only takes references.
+ * Events while a clip is pending extend it instead of starting another.
+ *
+ * All times are on the GStreamer system clock used for the capture
+ * timestamps (RtspStreamer::toClockTime()).
+ */
+class ClipRecorder {
+public:
+    ClipRecorder();
+    ~ClipRecorder();
+
+    /**
+     * @brief Start the writer thread
+     * @param settings History and clip lengths
+     * @param name Prefix of the clip file names, e.g. the camera name
+     * @return true if started, false if the directory cannot be created
+     */
+    bool start(const ClipRecorderSettings& settings, const std::string& name);
+
+    /**
+     * @brief Write the clips already cut, then stop the writer thread
+     */
+    void stop();
+
+    /**
+     * @brief Add one encoded buffer (streaming thread)
+     * @param buffer Encoder output; a reference is taken
+     * @param caps Caps of the buffer, used for the clip muxer
+     * @param clock_time Clock time of the buffer (base time + PTS)
+     */
+    void addBuffer(GstBuffer* buffer, GstCaps* caps, GstClockTime clock_time);
+
+    /**
+     * @brief Request a clip around an event
+     * @param clock_time Clock time of the event, e.g. the capture time of the detection
+     */
+    void trigger(GstClockTime clock_time);
+
+    int getClipCount() const { return clip_count_; }          ///< Clips written
+    int getFailedCount() const { return failed_count_; }      ///< Clips that could not be written or were dropped
+    size_t getBufferedBytes() const { return buffered_bytes_; } ///< Encoded bytes held by the ring
+
+private:
+    /// One encoder output buffer
+    struct Unit {
+        GstBuffer* buffer;
+        GstClockTime time;
+        bool keyframe;
+    };
+
+    /// Buffers of one clip on their way to the writer
+    struct Clip {
+        std::vector<Unit> units;
+        GstCaps* caps;
+        std::string path;
+    };
+
+    ClipRecorderSettings settings_;
+    std::string name_;
+    size_t max_bytes_;
+
+    // Ring, guarded by mutex_. keyframes_ holds absolute unit numbers;
+    // base_index_ is the number of units_.front().
+    std::mutex mutex_;
+    std::deque<Unit> units_;
+    std::deque<uint64_t> keyframes_;
+    uint64_t base_index_;
+    GstCaps* caps_;
+    GstClockTime last_time_;
+    bool last_delta_;
+
+    // Clip waiting for its end, guarded by mutex_
+    bool pending_;
+    GstClockTime pending_start_;
+    GstClockTime pending_end_;
+    GstClockTime pending_limit_;
+    std::chrono::system_clock::time_point pending_wall_time_;
+
+    // Clips cut and waiting for the writer, guarded by mutex_
+    std::deque<Clip> clips_;
+    std::condition_variable clips_cv_;
+    std::thread writer_;
+    bool running_;
+    std::string last_stamp_;        ///< Time stamp of the last clip name
+    int stamp_repeat_;              ///< Clips already named with last_stamp_
+
+    std::atomic<int> clip_count_;
+    std::atomic<int> failed_count_;
+    std::atomic<size_t> buffered_bytes_;
+
+    void trimLocked(GstClockTime now);
+    void cutClipLocked();
+    void writerLoop();
+    bool writeClip(const Clip& clip);
+    static void releaseClip(Clip& clip);
+};
+
+#endif // CLIP_RECORDER_H
@@ -7,6 +7,7 @@
 
 #include "ConfigManager.h"
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <iostream>
 
@@ -31,6 +32,8 @@ bool ConfigManager::loadConfig(const std::string& config_file) {
             outFile.close();
             std::cout << "Default config file created: " << config_file << std::endl;
         }
+        addDefaultCamera();
+        addDefaultProfile();
         return true; // Use default values
     }
     
@@ -40,18 +43,110 @@ bool ConfigManager::loadConfig(const std::string& config_file) {
     std::string json = buffer.str();
     file.close();
     
+    // Cut the camera list out first so its keys don't shadow the top-level ones
+    std::vector<std::string> camera_entries = parseJsonObjectArray(json, "cameras");
+    std::vector<std::string> profile_entries = parseJsonObjectArray(json, "rtsp_profiles");
+    
     // Parse JSON manually (simple parsing for basic config)
     config_.detection_threshold = parseJsonFloat(json, "detection_threshold", config_.detection_threshold);
     config_.nms_threshold = parseJsonFloat(json, "nms_threshold", config_.nms_threshold);
+    config_.nms_class_agnostic = parseJsonBool(json, "nms_class_agnostic", config_.nms_class_agnostic);
+    config_.class_thresholds = parseJsonString(json, "class_thresholds");
+    config_.max_detections = parseJsonInt(json, "max_detections", config_.max_detections);
+    config_.min_box_size = parseJsonInt(json, "min_box_size", config_.min_box_size);
+    config_.inference_size = parseJsonInt(json, "inference_size", config_.inference_size);
+    config_.tile_cols = parseJsonInt(json, "tile_cols", config_.tile_cols);
+    config_.tile_rows = parseJsonInt(json, "tile_rows", config_.tile_rows);
+    config_.tile_overlap = parseJsonFloat(json, "tile_overlap", config_.tile_overlap);
+    config_.tile_full_frame = parseJsonBool(json, "tile_full_frame", config_.tile_full_frame);
+    config_.async_detection = parseJsonBool(json, "async_detection", config_.async_detection);
+    config_.detection_interval = parseJsonInt(json, "detection_interval", config_.detection_interval);
+    config_.motion_gating = parseJsonBool(json, "motion_gating", config_.motion_gating);
+    config_.motion_threshold = parseJsonInt(json, "motion_threshold", config_.motion_threshold);
+    config_.motion_min_area = parseJsonFloat(json, "motion_min_area", config_.motion_min_area);
+    config_.motion_hold_ms = parseJsonInt(json, "motion_hold_ms", config_.motion_hold_ms);
+    config_.motion_idle_ms = parseJsonInt(json, "motion_idle_ms", config_.motion_idle_ms);
+    config_.tracking = parseJsonBool(json, "tracking", config_.tracking);
+    config_.tracker_iou_threshold = parseJsonFloat(json, "tracker_iou_threshold", config_.tracker_iou_threshold);
+    config_.tracker_high_threshold = parseJsonFloat(json, "tracker_high_threshold", config_.tracker_high_threshold);
+    config_.tracker_min_hits = parseJsonInt(json, "tracker_min_hits", config_.tracker_min_hits);
+    config_.tracker_max_misses = parseJsonInt(json, "tracker_max_misses", config_.tracker_max_misses);
+    config_.tracker_max_predict_ms = parseJsonInt(json, "tracker_max_predict_ms", config_.tracker_max_predict_ms);
+    
+    config_.clip_recording = parseJsonBool(json, "clip_recording", config_.clip_recording);
+    config_.clip_pre_seconds = parseJsonInt(json, "clip_pre_seconds", config_.clip_pre_seconds);
+    config_.clip_post_seconds = parseJsonInt(json, "clip_post_seconds", config_.clip_post_seconds);
+    config_.clip_max_seconds = parseJsonInt(json, "clip_max_seconds", config_.clip_max_seconds);
+    config_.clip_buffer_mb = parseJsonInt(json, "clip_buffer_mb", config_.clip_buffer_mb);
+    config_.clip_directory = parseJsonString(json, "clip_directory");
+    if (config_.clip_directory.empty()) config_.clip_directory = "clips";
+    config_.clip_trigger_classes = parseJsonString(json, "clip_trigger_classes");
     
     config_.camera_id = parseJsonInt(json, "camera_id", config_.camera_id);
     config_.frame_width = parseJsonInt(json, "frame_width", config_.frame_width);
     config_.frame_height = parseJsonInt(json, "frame_height", config_.frame_height);
     config_.frame_fps = parseJsonInt(json, "frame_fps", config_.frame_fps);
     
+    config_.cameras.clear();
+    for (size_t i = 0; i < camera_entries.size(); i++) {
+        const std::string& entry = camera_entries[i];
+        CameraConfig camera;
+        camera.camera_id = parseJsonInt(entry, "camera_id", config_.camera_id);
+        camera.frame_width = parseJsonInt(entry, "frame_width", config_.frame_width);
+        camera.frame_height = parseJsonInt(entry, "frame_height", config_.frame_height);
+        camera.frame_fps = parseJsonInt(entry, "frame_fps", config_.frame_fps);
+        camera.mount = parseJsonString(entry, "mount");
+        if (camera.mount.empty()) camera.mount = "/cam" + std::to_string(i);
+        camera.motion_roi = parseJsonString(entry, "motion_roi");
+        camera.detection_roi = parseJsonString(entry, "detection_roi");
+        camera.inference_size = parseJsonInt(entry, "inference_size", config_.inference_size);
+        camera.tile_cols = parseJsonInt(entry, "tile_cols", config_.tile_cols);
+        camera.tile_rows = parseJsonInt(entry, "tile_rows", config_.tile_rows);
+        config_.cameras.push_back(camera);
+    }
+    
+    config_.capture_backend = parseJsonString(json, "capture_backend");
+    if (config_.capture_backend.empty()) config_.capture_backend = "opencv";
+    config_.capture_decoder = parseJsonString(json, "capture_decoder");
+    if (config_.capture_decoder.empty()) config_.capture_decoder = "auto";
+    
     config_.rtsp_url = parseJsonString(json, "rtsp_url");
     if (config_.rtsp_url.empty()) config_.rtsp_url = "rtsp://localhost:8554/stream";
     config_.rtsp_port = parseJsonInt(json, "rtsp_port", config_.rtsp_port);
+    config_.rtsp_encoder = parseJsonString(json, "rtsp_encoder");
+    if (config_.rtsp_encoder.empty()) config_.rtsp_encoder = "auto";
+    config_.rtsp_codec = parseJsonString(json, "rtsp_codec");
+    if (config_.rtsp_codec.empty()) config_.rtsp_codec = "h264";
+    config_.rtsp_bitrate_kbps = parseJsonInt(json, "rtsp_bitrate_kbps", config_.rtsp_bitrate_kbps);
+    config_.rtsp_keyframe_interval = parseJsonInt(json, "rtsp_keyframe_interval", config_.rtsp_keyframe_interval);
+    config_.rtsp_sei_metadata = parseJsonBool(json, "rtsp_sei_metadata", config_.rtsp_sei_metadata);
+    config_.rtsp_queue_frames = parseJsonInt(json, "rtsp_queue_frames", config_.rtsp_queue_frames);
+    config_.rtsp_protocols = parseJsonString(json, "rtsp_protocols");
+    if (config_.rtsp_protocols.empty()) config_.rtsp_protocols = "tcp";
+    config_.rtsp_multicast_range = parseJsonString(json, "rtsp_multicast_range");
+    if (config_.rtsp_multicast_range.empty()) config_.rtsp_multicast_range = "239.255.42.0-239.255.42.255";
+    config_.rtsp_multicast_port_min = parseJsonInt(json, "rtsp_multicast_port_min", config_.rtsp_multicast_port_min);
+    config_.rtsp_multicast_port_max = parseJsonInt(json, "rtsp_multicast_port_max", config_.rtsp_multicast_port_max);
+    config_.rtsp_multicast_ttl = parseJsonInt(json, "rtsp_multicast_ttl", config_.rtsp_multicast_ttl);
+    config_.rtsp_client_send_buffer_kb = parseJsonInt(json, "rtsp_client_send_buffer_kb", config_.rtsp_client_send_buffer_kb);
+    config_.rtsp_max_clients = parseJsonInt(json, "rtsp_max_clients", config_.rtsp_max_clients);
+    
+    config_.rtsp_profiles.clear();
+    for (size_t i = 0; i < profile_entries.size(); i++) {
+        const std::string& entry = profile_entries[i];
+        StreamProfile profile;
+        profile.name = parseJsonString(entry, "name");
+        if (profile.name.empty()) profile.name = "profile" + std::to_string(i);
+        profile.mount_suffix = parseJsonString(entry, "mount_suffix");
+        profile.annotated = parseJsonBool(entry, "annotated", profile.annotated);
+        profile.width = parseJsonInt(entry, "width", profile.width);
+        profile.height = parseJsonInt(entry, "height", profile.height);
+        profile.bitrate_kbps = parseJsonInt(entry, "bitrate_kbps", profile.bitrate_kbps);
+        config_.rtsp_profiles.push_back(profile);
+    }
+    if (config_.rtsp_profiles.empty()) {
+        addDefaultProfile();
+    }
     
     config_.metadata_publish_interval_ms = parseJsonInt(json, "metadata_publish_interval_ms", config_.metadata_publish_interval_ms);
     config_.metadata_host = parseJsonString(json, "metadata_host");
@@ -59,18 +154,87 @@ bool ConfigManager::loadConfig(const std::string& config_file) {
     config_.metadata_port = parseJsonInt(json, "metadata_port", config_.metadata_port);
     config_.metadata_endpoint = parseJsonString(json, "metadata_endpoint");
     if (config_.metadata_endpoint.empty()) config_.metadata_endpoint = "/metadata";
+    config_.metadata_batch_size = parseJsonInt(json, "metadata_batch_size", config_.metadata_batch_size);
+    config_.metadata_batch_window_ms = parseJsonInt(json, "metadata_batch_window_ms", config_.metadata_batch_window_ms);
+    config_.metadata_queue_size = parseJsonInt(json, "metadata_queue_size", config_.metadata_queue_size);
+    config_.metadata_format = parseJsonString(json, "metadata_format");
+    if (config_.metadata_format.empty()) config_.metadata_format = "json";
+    config_.metadata_mode = parseJsonString(json, "metadata_mode");
+    if (config_.metadata_mode.empty()) config_.metadata_mode = "detections";
+    config_.metadata_transport = parseJsonString(json, "metadata_transport");
+    if (config_.metadata_transport.empty()) config_.metadata_transport = "http";
+    config_.metadata_mqtt_topic = parseJsonString(json, "metadata_mqtt_topic");
+    if (config_.metadata_mqtt_topic.empty()) config_.metadata_mqtt_topic = "detections";
+    config_.metadata_mqtt_qos = parseJsonInt(json, "metadata_mqtt_qos", config_.metadata_mqtt_qos);
+    config_.metadata_udp_ttl = parseJsonInt(json, "metadata_udp_ttl", config_.metadata_udp_ttl);
     
     config_.model_path = parseJsonString(json, "model_path");
     if (config_.model_path.empty()) config_.model_path = "ncnn-model/yolov4-tiny";
     config_.use_gpu = parseJsonBool(json, "use_gpu", config_.use_gpu);
+    config_.model_precision = parseJsonString(json, "model_precision");
+    if (config_.model_precision.empty()) config_.model_precision = "fp32";
+    config_.inference_workers = parseJsonInt(json, "inference_workers", config_.inference_workers);
+    config_.inference_cores = parseJsonString(json, "inference_cores");
+    config_.inference_batch_size = parseJsonInt(json, "inference_batch_size", config_.inference_batch_size);
+    config_.inference_threads = parseJsonInt(json, "inference_threads", config_.inference_threads);
+    config_.inference_cluster = parseJsonString(json, "inference_cluster");
+    if (config_.inference_cluster.empty()) config_.inference_cluster = "all";
+    config_.inference_pool_allocator = parseJsonBool(json, "inference_pool_allocator", config_.inference_pool_allocator);
+    config_.io_cores = parseJsonString(json, "io_cores");
+    
+    config_.classifier_model = parseJsonString(json, "classifier_model");
+    config_.classifier_labels = parseJsonString(json, "classifier_labels");
+    config_.classifier_classes = parseJsonString(json, "classifier_classes");
+    if (config_.classifier_classes.empty()) config_.classifier_classes = "person";
+    config_.classifier_input_size = parseJsonInt(json, "classifier_input_size", config_.classifier_input_size);
+    config_.classifier_min_size = parseJsonInt(json, "classifier_min_size", config_.classifier_min_size);
+    config_.classifier_threshold = parseJsonFloat(json, "classifier_threshold", config_.classifier_threshold);
+    config_.classifier_max_crops = parseJsonInt(json, "classifier_max_crops", config_.classifier_max_crops);
     
     config_.show_display = parseJsonBool(json, "show_display", config_.show_display);
     config_.draw_detections = parseJsonBool(json, "draw_detections", config_.draw_detections);
     
+    config_.frame_queue_size = parseJsonInt(json, "frame_queue_size", config_.frame_queue_size);
+    config_.frame_queue_policy = parseJsonString(json, "frame_queue_policy");
+    if (config_.frame_queue_policy.empty()) config_.frame_queue_policy = "drop_oldest";
+    config_.max_frame_age_ms = parseJsonInt(json, "max_frame_age_ms", config_.max_frame_age_ms);
+    config_.metrics_port = parseJsonInt(json, "metrics_port", config_.metrics_port);
+    config_.qos_enabled = parseJsonBool(json, "qos_enabled", config_.qos_enabled);
+    config_.qos_target_latency_ms = parseJsonInt(json, "qos_target_latency_ms", config_.qos_target_latency_ms);
+    config_.qos_interval_ms = parseJsonInt(json, "qos_interval_ms", config_.qos_interval_ms);
+    config_.qos_recover_periods = parseJsonInt(json, "qos_recover_periods", config_.qos_recover_periods);
+    config_.qos_order = parseJsonString(json, "qos_order");
+    if (config_.qos_order.empty()) config_.qos_order = "detection_interval,target_size,bitrate,frame_rate";
+    
+    if (config_.cameras.empty()) {
+        addDefaultCamera();
+    }
+    
     std::cout << "Config loaded from: " << config_file << std::endl;
     return true;
 }
 
+void ConfigManager::addDefaultCamera() {
+    // Single camera from the top-level settings, on the historical mount point
+    config_.cameras.clear();
+    CameraConfig camera;
+    camera.camera_id = config_.camera_id;
+    camera.frame_width = config_.frame_width;
+    camera.frame_height = config_.frame_height;
+    camera.frame_fps = config_.frame_fps;
+    camera.mount = "/stream";
+    camera.inference_size = config_.inference_size;
+    camera.tile_cols = config_.tile_cols;
+    camera.tile_rows = config_.tile_rows;
+    config_.cameras.push_back(camera);
+}
+
+void ConfigManager::addDefaultProfile() {
+    // One annotated stream at camera resolution on the camera mount point
+    config_.rtsp_profiles.clear();
+    config_.rtsp_profiles.push_back(StreamProfile());
+}
+
 bool ConfigManager::saveConfig(const std::string& config_file) {
     std::ofstream file(config_file);
     if (!file.is_open()) {
@@ -78,46 +242,284 @@ bool ConfigManager::saveConfig(const std::string& config_file) {
         return false;
     }
     
-    file << "{\n";
-    file << "  \"detection_threshold\": " << config_.detection_threshold << ",\n";
-    file << "  \"nms_threshold\": " << config_.nms_threshold << ",\n";
-    file << "  \"camera_id\": " << config_.camera_id << ",\n";
-    file << "  \"frame_width\": " << config_.frame_width << ",\n";
-    file << "  \"frame_height\": " << config_.frame_height << ",\n";
-    file << "  \"frame_fps\": " << config_.frame_fps << ",\n";
-    file << "  \"rtsp_url\": \"" << config_.rtsp_url << "\",\n";
-    file << "  \"rtsp_port\": " << config_.rtsp_port << ",\n";
-    file << "  \"metadata_publish_interval_ms\": " << config_.metadata_publish_interval_ms << ",\n";
-    file << "  \"metadata_host\": \"" << config_.metadata_host << "\",\n";
-    file << "  \"metadata_port\": " << config_.metadata_port << ",\n";
-    file << "  \"metadata_endpoint\": \"" << config_.metadata_endpoint << "\",\n";
-    file << "  \"model_path\": \"" << config_.model_path << "\",\n";
-    file << "  \"use_gpu\": " << (config_.use_gpu ? "true" : "false") << ",\n";
-    file << "  \"show_display\": " << (config_.show_display ? "true" : "false") << ",\n";
-    file << "  \"draw_detections\": " << (config_.draw_detections ? "true" : "false") << "\n";
-    file << "}\n";
-    
+    file << serialize(config_);
     file.close();
     std::cout << "Config saved to: " << config_file << std::endl;
     return true;
 }
 
+std::string ConfigManager::serialize(const Config& config) {
+    std::ostringstream file;
+    file << "{\n";
+    file << "  \"detection_threshold\": " << config.detection_threshold << ",\n";
+    file << "  \"nms_threshold\": " << config.nms_threshold << ",\n";
+    file << "  \"nms_class_agnostic\": " << (config.nms_class_agnostic ? "true" : "false") << ",\n";
+    file << "  \"class_thresholds\": \"" << config.class_thresholds << "\",\n";
+    file << "  \"max_detections\": " << config.max_detections << ",\n";
+    file << "  \"min_box_size\": " << config.min_box_size << ",\n";
+    file << "  \"inference_size\": " << config.inference_size << ",\n";
+    file << "  \"tile_cols\": " << config.tile_cols << ",\n";
+    file << "  \"tile_rows\": " << config.tile_rows << ",\n";
+    file << "  \"tile_overlap\": " << config.tile_overlap << ",\n";
+    file << "  \"tile_full_frame\": " << (config.tile_full_frame ? "true" : "false") << ",\n";
+    file << "  \"async_detection\": " << (config.async_detection ? "true" : "false") << ",\n";
+    file << "  \"detection_interval\": " << config.detection_interval << ",\n";
+    file << "  \"motion_gating\": " << (config.motion_gating ? "true" : "false") << ",\n";
+    file << "  \"motion_threshold\": " << config.motion_threshold << ",\n";
+    file << "  \"motion_min_area\": " << config.motion_min_area << ",\n";
+    file << "  \"motion_hold_ms\": " << config.motion_hold_ms << ",\n";
+    file << "  \"motion_idle_ms\": " << config.motion_idle_ms << ",\n";
+    file << "  \"tracking\": " << (config.tracking ? "true" : "false") << ",\n";
+    file << "  \"tracker_iou_threshold\": " << config.tracker_iou_threshold << ",\n";
+    file << "  \"tracker_high_threshold\": " << config.tracker_high_threshold << ",\n";
+    file << "  \"tracker_min_hits\": " << config.tracker_min_hits << ",\n";
+    file << "  \"tracker_max_misses\": " << config.tracker_max_misses << ",\n";
+    file << "  \"tracker_max_predict_ms\": " << config.tracker_max_predict_ms << ",\n";
+    file << "  \"clip_recording\": " << (config.clip_recording ? "true" : "false") << ",\n";
+    file << "  \"clip_pre_seconds\": " << config.clip_pre_seconds << ",\n";
+    file << "  \"clip_post_seconds\": " << config.clip_post_seconds << ",\n";
+    file << "  \"clip_max_seconds\": " << config.clip_max_seconds << ",\n";
+    file << "  \"clip_buffer_mb\": " << config.clip_buffer_mb << ",\n";
+    file << "  \"clip_directory\": \"" << config.clip_directory << "\",\n";
+    file << "  \"clip_trigger_classes\": \"" << config.clip_trigger_classes << "\",\n";
+    file << "  \"camera_id\": " << config.camera_id << ",\n";
+    file << "  \"frame_width\": " << config.frame_width << ",\n";
+    file << "  \"frame_height\": " << config.frame_height << ",\n";
+    file << "  \"frame_fps\": " << config.frame_fps << ",\n";
+    file << "  \"cameras\": [\n";
+    for (size_t i = 0; i < config.cameras.size(); i++) {
+        const CameraConfig& camera = config.cameras[i];
+        file << "    { \"camera_id\": " << camera.camera_id
+             << ", \"frame_width\": " << camera.frame_width
+             << ", \"frame_height\": " << camera.frame_height
+             << ", \"frame_fps\": " << camera.frame_fps
+             << ", \"mount\": \"" << camera.mount << "\""
+             << (camera.motion_roi.empty() ? "" : ", \"motion_roi\": \"" + camera.motion_roi + "\"")
+             << (camera.detection_roi.empty() ? "" : ", \"detection_roi\": \"" + camera.detection_roi + "\"")
+             << (camera.inference_size == config.inference_size ? "" : ", \"inference_size\": " + std::to_string(camera.inference_size))
+             << (camera.tile_cols == config.tile_cols ? "" : ", \"tile_cols\": " + std::to_string(camera.tile_cols))
+             << (camera.tile_rows == config.tile_rows ? "" : ", \"tile_rows\": " + std::to_string(camera.tile_rows)) << " }"
+             << (i + 1 < config.cameras.size() ? "," : "") << "\n";
+    }
+    file << "  ],\n";
+    file << "  \"capture_backend\": \"" << config.capture_backend << "\",\n";
+    file << "  \"capture_decoder\": \"" << config.capture_decoder << "\",\n";
+    file << "  \"rtsp_url\": \"" << config.rtsp_url << "\",\n";
+    file << "  \"rtsp_port\": " << config.rtsp_port << ",\n";
+    file << "  \"rtsp_encoder\": \"" << config.rtsp_encoder << "\",\n";
+    file << "  \"rtsp_codec\": \"" << config.rtsp_codec << "\",\n";
+    file << "  \"rtsp_bitrate_kbps\": " << config.rtsp_bitrate_kbps << ",\n";
+    file << "  \"rtsp_keyframe_interval\": " << config.rtsp_keyframe_interval << ",\n";
+    file << "  \"rtsp_sei_metadata\": " << (config.rtsp_sei_metadata ? "true" : "false") << ",\n";
+    file << "  \"rtsp_queue_frames\": " << config.rtsp_queue_frames << ",\n";
+    file << "  \"rtsp_protocols\": \"" << config.rtsp_protocols << "\",\n";
+    file << "  \"rtsp_multicast_range\": \"" << config.rtsp_multicast_range << "\",\n";
+    file << "  \"rtsp_multicast_port_min\": " << config.rtsp_multicast_port_min << ",\n";
+    file << "  \"rtsp_multicast_port_max\": " << config.rtsp_multicast_port_max << ",\n";
+    file << "  \"rtsp_multicast_ttl\": " << config.rtsp_multicast_ttl << ",\n";
+    file << "  \"rtsp_client_send_buffer_kb\": " << config.rtsp_client_send_buffer_kb << ",\n";
+    file << "  \"rtsp_max_clients\": " << config.rtsp_max_clients << ",\n";
+    file << "  \"rtsp_profiles\": [\n";
+    for (size_t i = 0; i < config.rtsp_profiles.size(); i++) {
+        const StreamProfile& profile = config.rtsp_profiles[i];
+        file << "    { \"name\": \"" << profile.name << "\""
+             << ", \"mount_suffix\": \"" << profile.mount_suffix << "\""
+             << ", \"annotated\": " << (profile.annotated ? "true" : "false")
+             << ", \"width\": " << profile.width
+             << ", \"height\": " << profile.height
+             << ", \"bitrate_kbps\": " << profile.bitrate_kbps << " }"
+             << (i + 1 < config.rtsp_profiles.size() ? "," : "") << "\n";
+    }
+    file << "  ],\n";
+    file << "  \"metadata_publish_interval_ms\": " << config.metadata_publish_interval_ms << ",\n";
+    file << "  \"metadata_host\": \"" << config.metadata_host << "\",\n";
+    file << "  \"metadata_port\": " << config.metadata_port << ",\n";
+    file << "  \"metadata_endpoint\": \"" << config.metadata_endpoint << "\",\n";
+    file << "  \"metadata_batch_size\": " << config.metadata_batch_size << ",\n";
+    file << "  \"metadata_batch_window_ms\": " << config.metadata_batch_window_ms << ",\n";
+    file << "  \"metadata_queue_size\": " << config.metadata_queue_size << ",\n";
+    file << "  \"metadata_format\": \"" << config.metadata_format << "\",\n";
+    file << "  \"metadata_mode\": \"" << config.metadata_mode << "\",\n";
+    file << "  \"metadata_transport\": \"" << config.metadata_transport << "\",\n";
+    file << "  \"metadata_mqtt_topic\": \"" << config.metadata_mqtt_topic << "\",\n";
+    file << "  \"metadata_mqtt_qos\": " << config.metadata_mqtt_qos << ",\n";
+    file << "  \"metadata_udp_ttl\": " << config.metadata_udp_ttl << ",\n";
+    file << "  \"model_path\": \"" << config.model_path << "\",\n";
+    file << "  \"use_gpu\": " << (config.use_gpu ? "true" : "false") << ",\n";
+    file << "  \"model_precision\": \"" << config.model_precision << "\",\n";
+    file << "  \"inference_workers\": " << config.inference_workers << ",\n";
+    file << "  \"inference_cores\": \"" << config.inference_cores << "\",\n";
+    file << "  \"inference_batch_size\": " << config.inference_batch_size << ",\n";
+    file << "  \"inference_threads\": " << config.inference_threads << ",\n";
+    file << "  \"inference_cluster\": \"" << config.inference_cluster << "\",\n";
+    file << "  \"inference_pool_allocator\": " << (config.inference_pool_allocator ? "true" : "false") << ",\n";
+    file << "  \"io_cores\": \"" << config.io_cores << "\",\n";
+    file << "  \"classifier_model\": \"" << config.classifier_model << "\",\n";
+    file << "  \"classifier_labels\": \"" << config.classifier_labels << "\",\n";
+    file << "  \"classifier_classes\": \"" << config.classifier_classes << "\",\n";
+    file << "  \"classifier_input_size\": " << config.classifier_input_size << ",\n";
+    file << "  \"classifier_min_size\": " << config.classifier_min_size << ",\n";
+    file << "  \"classifier_threshold\": " << config.classifier_threshold << ",\n";
+    file << "  \"classifier_max_crops\": " << config.classifier_max_crops << ",\n";
+    file << "  \"show_display\": " << (config.show_display ? "true" : "false") << ",\n";
+    file << "  \"draw_detections\": " << (config.draw_detections ? "true" : "false") << ",\n";
+    file << "  \"frame_queue_size\": " << config.frame_queue_size << ",\n";
+    file << "  \"frame_queue_policy\": \"" << config.frame_queue_policy << "\",\n";
+    file << "  \"max_frame_age_ms\": " << config.max_frame_age_ms << ",\n";
+    file << "  \"metrics_port\": " << config.metrics_port << ",\n";
+    file << "  \"qos_enabled\": " << (config.qos_enabled ? "true" : "false") << ",\n";
+    file << "  \"qos_target_latency_ms\": " << config.qos_target_latency_ms << ",\n";
+    file << "  \"qos_interval_ms\": " << config.qos_interval_ms << ",\n";
+    file << "  \"qos_recover_periods\": " << config.qos_recover_periods << ",\n";
+    file << "  \"qos_order\": \"" << config.qos_order << "\"\n";
+    file << "}\n";
+    return file.str();
+}
+
+std::vector<std::string> ConfigManager::changedKeys(const Config& a, const Config& b) {
+    // serialize() writes one key per line and one array element per line
+    auto collect = [](const std::string& text) {
+        std::map<std::string, std::string> values;
+        std::istringstream lines(text);
+        std::string line, array;
+        while (std::getline(lines, line)) {
+            const size_t open = line.find('"');
+            if (line.compare(0, 4, "    ") == 0) {
+                values[array] += line;
+            } else if (open == 2) {
+                const std::string key = line.substr(3, line.find('"', 3) - 3);
+                values[key] = line;
+                if (line.back() == '[') array = key;
+            }
+        }
+        return values;
+    };
+    
+    const std::map<std::string, std::string> before = collect(serialize(a));
+    const std::map<std::string, std::string> after = collect(serialize(b));
+    
+    std::vector<std::string> keys;
+    for (const auto& entry : after) {
+        auto it = before.find(entry.first);
+        if (it == before.end() || it->second != entry.second) {
+            keys.push_back(entry.first);
+        }
+    }
+    return keys;
+}
+
 void ConfigManager::printConfig() const {
     std::cout << "=== Current Configuration ===" << std::endl;
     std::cout << "Detection threshold: " << config_.detection_threshold << std::endl;
-    std::cout << "NMS threshold: " << config_.nms_threshold << std::endl;
-    std::cout << "Camera ID: " << config_.camera_id << std::endl;
-    std::cout << "Frame size: " << config_.frame_width << "x" << config_.frame_height << std::endl;
-    std::cout << "Frame FPS: " << config_.frame_fps << std::endl;
+    std::cout << "NMS threshold: " << config_.nms_threshold << (config_.nms_class_agnostic ? " (class-agnostic)" : " (per class)") << std::endl;
+    if (!config_.class_thresholds.empty()) {
+        std::cout << "Class thresholds: " << config_.class_thresholds << std::endl;
+    }
+    std::cout << "Max detections: " << (config_.max_detections > 0 ? std::to_string(config_.max_detections) : "unlimited") << std::endl;
+    std::cout << "Min box size: " << config_.min_box_size << "px" << std::endl;
+    std::cout << "Tile overlap: " << config_.tile_overlap << (config_.tile_full_frame ? " (with full-frame pass)" : "") << std::endl;
+    std::cout << "Async detection: " << (config_.async_detection ? "Yes" : "No") << std::endl;
+    std::cout << "Detection interval: every " << config_.detection_interval << " frame(s)" << std::endl;
+    if (config_.motion_gating) {
+        std::cout << "Motion gating: threshold " << config_.motion_threshold << ", min area " << config_.motion_min_area
+                  << ", hold " << config_.motion_hold_ms << "ms, idle detection "
+                  << (config_.motion_idle_ms > 0 ? "every " + std::to_string(config_.motion_idle_ms) + "ms" : "off") << std::endl;
+    } else {
+        std::cout << "Motion gating: No" << std::endl;
+    }
+    if (config_.tracking) {
+        std::cout << "Tracking: IoU " << config_.tracker_iou_threshold << ", high confidence " << config_.tracker_high_threshold
+                  << ", confirm after " << config_.tracker_min_hits << ", end after " << config_.tracker_max_misses
+                  << " missed run(s), predict up to " << config_.tracker_max_predict_ms << "ms" << std::endl;
+    } else {
+        std::cout << "Tracking: No" << std::endl;
+    }
+    if (config_.clip_recording) {
+        std::cout << "Clip recording: " << config_.clip_pre_seconds << "s before, " << config_.clip_post_seconds
+                  << "s after, up to " << config_.clip_max_seconds << "s, " << config_.clip_buffer_mb << "MB per camera, into "
+                  << config_.clip_directory << " on " << (config_.clip_trigger_classes.empty() ? "any class" : config_.clip_trigger_classes)
+                  << std::endl;
+    } else {
+        std::cout << "Clip recording: No" << std::endl;
+    }
+    std::cout << "Cameras: " << config_.cameras.size() << std::endl;
+    for (const auto& camera : config_.cameras) {
+        std::cout << "  Camera " << camera.camera_id << ": " << camera.frame_width << "x" << camera.frame_height
+                  << " @ " << camera.frame_fps << "fps -> " << camera.mount
+                  << (camera.motion_roi.empty() ? "" : " (motion ROI " + camera.motion_roi + ")")
+                  << (camera.detection_roi.empty() ? "" : " (detection ROI " + camera.detection_roi + ")")
+                  << ", inference " << (camera.inference_size > 0 ? std::to_string(camera.inference_size) : "default")
+                  << (camera.tile_cols > 1 || camera.tile_rows > 1
+                          ? ", " + std::to_string(camera.tile_cols) + "x" + std::to_string(camera.tile_rows) + " tiles" : "")
+                  << std::endl;
+    }
+    std::cout << "Capture backend: " << config_.capture_backend
+              << (config_.capture_backend == "gstreamer" ? " (decoder: " + config_.capture_decoder + ")" : "") << std::endl;
     std::cout << "RTSP URL: " << config_.rtsp_url << std::endl;
     std::cout << "RTSP Port: " << config_.rtsp_port << std::endl;
+    std::cout << "RTSP encoder: " << config_.rtsp_encoder << " (" << config_.rtsp_codec << ", "
+              << config_.rtsp_bitrate_kbps << " kbps, keyframe every " << config_.rtsp_keyframe_interval << " frames)" << std::endl;
+    std::cout << "RTSP SEI metadata: " << (config_.rtsp_sei_metadata ? "Yes" : "No") << std::endl;
+    std::cout << "RTSP queue: " << config_.rtsp_queue_frames << " frame(s)" << std::endl;
+    std::cout << "RTSP transports: " << config_.rtsp_protocols;
+    if (config_.rtsp_protocols.find("mcast") != std::string::npos || config_.rtsp_protocols.find("multicast") != std::string::npos) {
+        std::cout << " (multicast " << config_.rtsp_multicast_range << ", ports " << config_.rtsp_multicast_port_min
+                  << "-" << config_.rtsp_multicast_port_max << ", ttl " << config_.rtsp_multicast_ttl << ")";
+    }
+    std::cout << std::endl;
+    std::cout << "RTSP client limits: " << (config_.rtsp_max_clients > 0 ? std::to_string(config_.rtsp_max_clients) : "unlimited")
+              << " sessions, send buffer "
+              << (config_.rtsp_client_send_buffer_kb > 0 ? std::to_string(config_.rtsp_client_send_buffer_kb) + " KB" : "default") << std::endl;
+    std::cout << "RTSP profiles: " << config_.rtsp_profiles.size() << std::endl;
+    for (const auto& profile : config_.rtsp_profiles) {
+        std::cout << "  " << profile.name << ": <mount>" << profile.mount_suffix
+                  << (profile.annotated ? ", annotated" : ", clean");
+        if (profile.width > 0 || profile.height > 0) {
+            std::cout << ", " << profile.width << "x" << profile.height;
+        }
+        if (profile.bitrate_kbps > 0) {
+            std::cout << ", " << profile.bitrate_kbps << " kbps";
+        }
+        std::cout << std::endl;
+    }
     std::cout << "Metadata interval: " << config_.metadata_publish_interval_ms << "ms" << std::endl;
     std::cout << "Metadata host: " << config_.metadata_host << ":" << config_.metadata_port << std::endl;
     std::cout << "Metadata endpoint: " << config_.metadata_endpoint << std::endl;
+    std::cout << "Metadata batch: up to " << config_.metadata_batch_size << " record(s)";
+    if (config_.metadata_batch_window_ms > 0) std::cout << " within " << config_.metadata_batch_window_ms << "ms";
+    std::cout << ", queue " << config_.metadata_queue_size << std::endl;
+    std::cout << "Metadata format: " << config_.metadata_format << " (" << config_.metadata_mode << ")" << std::endl;
+    std::cout << "Metadata transport: " << config_.metadata_transport;
+    if (config_.metadata_transport == "mqtt") {
+        std::cout << " (topic " << config_.metadata_mqtt_topic << ", QoS " << config_.metadata_mqtt_qos << ")";
+    } else if (config_.metadata_transport == "udp") {
+        std::cout << " (TTL " << config_.metadata_udp_ttl << ")";
+    }
+    std::cout << std::endl;
     std::cout << "Model path: " << config_.model_path << std::endl;
     std::cout << "Use GPU: " << (config_.use_gpu ? "Yes" : "No") << std::endl;
+    std::cout << "Model precision: " << config_.model_precision << std::endl;
+    std::cout << "Inference workers: " << (config_.inference_workers > 0 ? std::to_string(config_.inference_workers) : "auto")
+              << " (cores: " << (config_.inference_cores.empty() ? "all" : config_.inference_cores) << ")" << std::endl;
+    std::cout << "Inference batch size: " << config_.inference_batch_size << std::endl;
+    std::cout << "Inference threads per worker: " << (config_.inference_threads > 0 ? std::to_string(config_.inference_threads) : "auto")
+              << " (cluster: " << config_.inference_cluster << ")" << std::endl;
+    std::cout << "Inference pool allocator: " << (config_.inference_pool_allocator ? "Yes" : "No") << std::endl;
+    std::cout << "I/O cores: " << (config_.io_cores.empty() ? "auto" : config_.io_cores) << std::endl;
+    if (!config_.classifier_model.empty()) {
+        std::cout << "Classifier: " << config_.classifier_model << " on " << config_.classifier_classes << " ("
+                  << config_.classifier_input_size << "px input, boxes from " << config_.classifier_min_size << "px, threshold "
+                  << config_.classifier_threshold << ", up to " << config_.classifier_max_crops << " crops per batch)" << std::endl;
+    }
     std::cout << "Show display: " << (config_.show_display ? "Yes" : "No") << std::endl;
     std::cout << "Draw detections: " << (config_.draw_detections ? "Yes" : "No") << std::endl;
+    std::cout << "Frame queue: " << config_.frame_queue_size << " (" << config_.frame_queue_policy << ")" << std::endl;
+    std::cout << "Max frame age: " << (config_.max_frame_age_ms > 0 ? std::to_string(config_.max_frame_age_ms) + "ms" : "unlimited") << std::endl;
+    std::cout << "Metrics port: " << (config_.metrics_port > 0 ? std::to_string(config_.metrics_port) : "disabled") << std::endl;
+    if (config_.qos_enabled) {
+        std::cout << "QoS: target " << config_.qos_target_latency_ms << "ms, window " << config_.qos_interval_ms
+                  << "ms, recover after " << config_.qos_recover_periods << " calm windows, order " << config_.qos_order << std::endl;
+    }
     std::cout << "=============================" << std::endl;
 }
 
@@ -207,23 +609,139 @@ bool ConfigManager::parseJsonBool(const std::string& json, const std::string& ke
     return defaultValue;
 }
 
+std::vector<std::string> ConfigManager::parseJsonObjectArray(std::string& json, const std::string& key) {
+    std::vector<std::string> objects;
+    
+    std::string searchKey = "\"" + key + "\"";
+    size_t keyPos = json.find(searchKey);
+    if (keyPos == std::string::npos) return objects;
+    
+    size_t pos = json.find(":", keyPos);
+    if (pos == std::string::npos) return objects;
+    pos = json.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos || json[pos] != '[') return objects;
+    
+    // Walk the array, collecting each top-level {...} element
+    int depth = 0;
+    size_t objectStart = std::string::npos;
+    size_t endPos = pos + 1;
+    for (; endPos < json.length(); endPos++) {
+        char c = json[endPos];
+        if (c == '{') {
+            if (depth == 0) objectStart = endPos;
+            depth++;
+        } else if (c == '}') {
+            depth--;
+            if (depth == 0 && objectStart != std::string::npos) {
+                objects.push_back(json.substr(objectStart, endPos - objectStart + 1));
+                objectStart = std::string::npos;
+            }
+        } else if (c == ']' && depth == 0) {
+            break;
+        }
+    }
+    
+    if (endPos >= json.length()) return std::vector<std::string>();
+    
+    // Remove the whole "key": [...] pair from the document
+    json.erase(keyPos, endPos - keyPos + 1);
+    return objects;
+}
+
 std::string ConfigManager::createDefaultConfig() {
     return R"({
   "detection_threshold": 0.25,
   "nms_threshold": 0.45,
+  "nms_class_agnostic": false,
+  "class_thresholds": "",
+  "max_detections": 100,
+  "min_box_size": 10,
+  "inference_size": 0,
+  "tile_cols": 1,
+  "tile_rows": 1,
+  "tile_overlap": 0.2,
+  "tile_full_frame": true,
+  "async_detection": true,
+  "detection_interval": 1,
+  "motion_gating": false,
+  "motion_threshold": 25,
+  "motion_min_area": 0.002,
+  "motion_hold_ms": 1000,
+  "motion_idle_ms": 1000,
+  "tracking": false,
+  "tracker_iou_threshold": 0.3,
+  "tracker_high_threshold": 0.5,
+  "tracker_min_hits": 2,
+  "tracker_max_misses": 3,
+  "tracker_max_predict_ms": 500,
+  "clip_recording": false,
+  "clip_pre_seconds": 10,
+  "clip_post_seconds": 10,
+  "clip_max_seconds": 60,
+  "clip_buffer_mb": 32,
+  "clip_directory": "clips",
+  "clip_trigger_classes": "",
   "camera_id": 2,
   "frame_width": 640,
   "frame_height": 480,
   "frame_fps": 30,
+  "capture_backend": "opencv",
+  "capture_decoder": "auto",
   "rtsp_url": "rtsp://localhost:8554/stream",
   "rtsp_port": 8554,
+  "rtsp_encoder": "auto",
+  "rtsp_codec": "h264",
+  "rtsp_bitrate_kbps": 1000,
+  "rtsp_keyframe_interval": 30,
+  "rtsp_sei_metadata": false,
+  "rtsp_queue_frames": 2,
+  "rtsp_protocols": "tcp",
+  "rtsp_multicast_range": "239.255.42.0-239.255.42.255",
+  "rtsp_multicast_port_min": 5000,
+  "rtsp_multicast_port_max": 5999,
+  "rtsp_multicast_ttl": 1,
+  "rtsp_client_send_buffer_kb": 0,
+  "rtsp_max_clients": 0,
   "metadata_publish_interval_ms": 100,
   "metadata_host": "localhost",
   "metadata_port": 8080,
   "metadata_endpoint": "/metadata",
+  "metadata_batch_size": 1,
+  "metadata_batch_window_ms": 0,
+  "metadata_queue_size": 100,
+  "metadata_format": "json",
+  "metadata_mode": "detections",
+  "metadata_transport": "http",
+  "metadata_mqtt_topic": "detections",
+  "metadata_mqtt_qos": 0,
+  "metadata_udp_ttl": 1,
   "model_path": "ncnn-model/yolov4-tiny",
   "use_gpu": false,
+  "model_precision": "fp32",
+  "inference_workers": 0,
+  "inference_cores": "",
+  "inference_batch_size": 1,
+  "inference_threads": 0,
+  "inference_cluster": "all",
+  "inference_pool_allocator": true,
+  "io_cores": "",
+  "classifier_model": "",
+  "classifier_labels": "",
+  "classifier_classes": "person",
+  "classifier_input_size": 224,
+  "classifier_min_size": 32,
+  "classifier_threshold": 0.5,
+  "classifier_max_crops": 8,
   "show_display": true,
-  "draw_detections": true
+  "draw_detections": true,
+  "frame_queue_size": 2,
+  "frame_queue_policy": "drop_oldest",
+  "max_frame_age_ms": 0,
+  "metrics_port": 0,
+  "qos_enabled": false,
+  "qos_target_latency_ms": 300,
+  "qos_interval_ms": 1000,
+  "qos_recover_periods": 5,
+  "qos_order": "detection_interval,target_size,bitrate,frame_rate"
 })";
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #define CONFIG_MANAGER_H
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <iostream>
 
@@ -22,6 +23,36 @@
  */
 class ConfigManager {
 public:
+    /**
+     * @struct CameraConfig
+     * @brief Settings of one camera and its RTSP mount point
+     */
+    struct CameraConfig {
+        int camera_id = 2;               ///< V4L2 device index
+        int frame_width = 640;
+        int frame_height = 480;
+        int frame_fps = 30;
+        std::string mount = "/stream";   ///< RTSP mount point of this camera
+        std::string motion_roi;          ///< Regions watched by the motion gate, "x,y,w,h;..." as frame fractions (empty = all)
+        std::string detection_roi;       ///< Regions the detector analyses, "x,y,w,h;..." as frame fractions (empty = all)
+        int inference_size = 0;          ///< Network input size for this camera (0 = model default)
+        int tile_cols = 1;               ///< Tiles per detection region horizontally
+        int tile_rows = 1;               ///< Tiles per detection region vertically
+    };
+
+    /**
+     * @struct StreamProfile
+     * @brief One RTSP stream served for every camera
+     */
+    struct StreamProfile {
+        std::string name = "main";       ///< Profile name used in logs
+        std::string mount_suffix;        ///< Appended to the camera mount ("" = the camera mount itself)
+        bool annotated = true;           ///< Stream frames with the detections drawn (when draw_detections is set)
+        int width = 0;                   ///< Frame width (0 = camera width, or scaled from height)
+        int height = 0;                  ///< Frame height (0 = camera height, or scaled from width)
+        int bitrate_kbps = 0;            ///< Encoder bitrate (0 = rtsp_bitrate_kbps)
+    };
+
     /**
      * @struct Config
      * @brief Configuration structure holding all application settings
@@ -30,30 +61,117 @@ public:
         // Detection settings
         float detection_threshold = 0.25f;    ///< Object detection confidence threshold
         float nms_threshold = 0.45f;          ///< Non-maximum suppression threshold
+        bool nms_class_agnostic = false;      ///< Let boxes of any class suppress each other
+        std::string class_thresholds = "";    ///< Per-class confidence thresholds, e.g. "person:0.4,car:0.5"
+        int max_detections = 100;             ///< Most detections kept per frame (0 = unlimited)
+        int min_box_size = 10;                ///< Smallest detection side kept, in frame pixels
+        int inference_size = 0;               ///< Network input size, default for all cameras (0 = model default, 416)
+        int tile_cols = 1;                    ///< Tiles across the frame, default for all cameras (1 = no tiling)
+        int tile_rows = 1;                    ///< Tiles down the frame, default for all cameras (1 = no tiling)
+        float tile_overlap = 0.2f;            ///< Overlap of neighbouring tiles as a fraction of the tile size
+        bool tile_full_frame = true;          ///< Also detect on the whole tiled area, for objects larger than the overlap
+        bool async_detection = true;          ///< Run detection on its own worker, never stalling the video
+        int detection_interval = 1;           ///< Run the detector on every Nth frame
+        bool motion_gating = false;           ///< Skip detection on frames without motion, reusing the last detections
+        int motion_threshold = 25;            ///< Grey level change of a pixel counted as motion
+        float motion_min_area = 0.002f;       ///< Fraction of the motion ROI that must change
+        int motion_hold_ms = 1000;            ///< Keep detecting this long after motion stops
+        int motion_idle_ms = 1000;            ///< Detect this often on a static scene anyway (0 = never)
+        bool tracking = false;                ///< Track detections with stable ids, predicting boxes between detector runs
+        float tracker_iou_threshold = 0.3f;   ///< Minimum IoU to match a detection to a track
+        float tracker_high_threshold = 0.5f;  ///< Confidence that is matched first and may start a track
+        int tracker_min_hits = 2;             ///< Detector runs before a track is reported ("enter")
+        int tracker_max_misses = 3;           ///< Detector runs without a match before a track ends ("exit")
+        int tracker_max_predict_ms = 500;     ///< Longest box extrapolation past the last match
         
-        // Camera settings
+        // Event clip settings
+        bool clip_recording = false;          ///< Keep recent encoded video and write MP4 clips around detections
+        int clip_pre_seconds = 10;            ///< Video kept from before an event
+        int clip_post_seconds = 10;           ///< Video recorded after the last event of a clip
+        int clip_max_seconds = 60;            ///< Longest clip; later events start the next one
+        int clip_buffer_mb = 32;              ///< Memory cap of each camera's ring of encoded video
+        std::string clip_directory = "clips"; ///< Directory of the clip files
+        std::string clip_trigger_classes;     ///< Comma-separated classes that start a clip (empty = any)
+        
+        // Camera settings (defaults for entries of "cameras")
         int camera_id = 2;
         int frame_width = 640;
         int frame_height = 480;
         int frame_fps = 30;
+        std::vector<CameraConfig> cameras;    ///< One entry per camera, built from top-level settings if absent
+        std::string capture_backend = "opencv";  ///< Capture backend: "opencv" or "gstreamer"
+        std::string capture_decoder = "auto";    ///< JPEG decoder of the gstreamer backend (e.g. "v4l2jpegdec") or "auto"
         
         // RTSP settings
         std::string rtsp_url = "rtsp://localhost:8554/stream";
         int rtsp_port = 8554;
+        std::string rtsp_encoder = "auto";    ///< Encoder element (e.g. "v4l2h264enc", "x264enc") or "auto"
+        std::string rtsp_codec = "h264";      ///< Video codec: "h264" or "h265"
+        int rtsp_bitrate_kbps = 1000;         ///< Encoder target bitrate in kbit/s
+        int rtsp_keyframe_interval = 30;      ///< Frames between key frames
+        bool rtsp_sei_metadata = false;       ///< Embed each frame's detections in the video as SEI
+        int rtsp_queue_frames = 2;            ///< Frames each stream may queue ahead of the encoder before dropping
+        std::string rtsp_protocols = "tcp";   ///< RTP transports offered to clients: "udp", "udp-mcast", "tcp" (comma-separated)
+        std::string rtsp_multicast_range = "239.255.42.0-239.255.42.255"; ///< Multicast group pool, "first-last"
+        int rtsp_multicast_port_min = 5000;   ///< First port of the multicast groups
+        int rtsp_multicast_port_max = 5999;   ///< Last port of the multicast groups
+        int rtsp_multicast_ttl = 1;           ///< Multicast TTL (1 = local network only)
+        int rtsp_client_send_buffer_kb = 0;   ///< Kernel send buffer per client (0 = system default)
+        int rtsp_max_clients = 0;             ///< Max concurrent RTSP sessions (0 = unlimited)
+        std::vector<StreamProfile> rtsp_profiles; ///< Streams per camera, a single annotated one if absent
         
         // Metadata settings
         int metadata_publish_interval_ms = 100;  // 100ms = 10Hz
         std::string metadata_host = "localhost";
         int metadata_port = 8080;
         std::string metadata_endpoint = "/metadata";
+        int metadata_batch_size = 1;          ///< Max records per POST (above 1 they are sent as a JSON array)
+        int metadata_batch_window_ms = 0;     ///< How long a batch keeps gathering after its first record (0 = send what is queued)
+        int metadata_queue_size = 100;        ///< Records that may wait for the publisher before new ones are rejected
+        std::string metadata_format = "json"; ///< Wire format: "json", "compact_json" or "cbor"
+        std::string metadata_mode = "detections"; ///< "detections" (every interval) or "events" (track enter/exit only)
+        std::string metadata_transport = "http"; ///< "http", "websocket", "mqtt" or "udp"
+        std::string metadata_mqtt_topic = "detections";
+        int metadata_mqtt_qos = 0;            ///< MQTT QoS: 0 (at most once) or 1 (at least once)
+        int metadata_udp_ttl = 1;             ///< Multicast TTL for the udp transport
         
         // Model settings
         std::string model_path = "ncnn-model/yolov4-tiny";
         bool use_gpu = false;
+        std::string model_precision = "fp32"; ///< Network precision: "fp32", "fp16" or "int8" (loads "<model_path>-int8")
+        int inference_workers = 0;            ///< Detection worker threads shared by all cameras (0 = auto)
+        std::string inference_cores = "";     ///< Cores to pin detection workers to, e.g. "0-3" (empty = all)
+        int inference_batch_size = 1;         ///< Max frames from different cameras a worker detects in one batch
+        int inference_threads = 0;            ///< NCNN threads per worker (0 = size of the worker's core slice)
+        std::string inference_cluster = "all"; ///< Core cluster used when inference_cores is empty: "all", "big" or "little"
+        bool inference_pool_allocator = true; ///< Reuse NCNN blob/workspace memory between detections
+        std::string io_cores = "";            ///< Cores for capture, encoding and publishing threads (empty = cores not used by inference)
+        
+        // Second-stage classifier
+        std::string classifier_model = "";    ///< Classifier run on crops of detections (empty = none), same precision and device as the detector
+        std::string classifier_labels = "";   ///< Label file, one per line (empty = "<classifier_model>.labels")
+        std::string classifier_classes = "person"; ///< Comma-separated detector classes whose crops are classified
+        int classifier_input_size = 224;      ///< Square classifier input
+        int classifier_min_size = 32;         ///< Smallest box side classified, in pixels
+        float classifier_threshold = 0.5f;    ///< Minimum confidence for an attribute to be attached
+        int classifier_max_crops = 8;         ///< Crops classified per inference batch, most confident first (0 = all)
         
         // Display settings
         bool show_display = true;
         bool draw_detections = true;
+        
+        // Pipeline settings
+        int frame_queue_size = 2;                        ///< Capacity of each queue between pipeline stages
+        std::string frame_queue_policy = "drop_oldest";  ///< Queue overflow policy: "drop_oldest" or "block"
+        int max_frame_age_ms = 0;                        ///< Frames older than this are dropped instead of processed (0 = never)
+        int metrics_port = 0;                            ///< Prometheus /metrics HTTP port (0 = disabled)
+        
+        // Load shedding
+        bool qos_enabled = false;                        ///< Turn detection, input size, bitrate and frame rate down while behind
+        int qos_target_latency_ms = 300;                 ///< Capture-to-output latency the controller holds
+        int qos_interval_ms = 1000;                      ///< Measurement window; at most one step per window
+        int qos_recover_periods = 5;                     ///< Calm windows before a step is undone
+        std::string qos_order = "detection_interval,target_size,bitrate,frame_rate"; ///< Knobs, first turned down first
     };
 
     ConfigManager();
@@ -62,6 +180,21 @@ public:
     bool loadConfig(const std::string& config_file = "config.json");
     bool saveConfig(const std::string& config_file = "config.json");
     
+    /**
+     * @brief Render a configuration as the JSON written by saveConfig()
+     * @param config Configuration to render
+     * @return JSON text
+     */
+    static std::string serialize(const Config& config);
+    
+    /**
+     * @brief List the top-level keys whose values differ between two configurations
+     * @param a Old configuration
+     * @param b New configuration
+     * @return Changed key names; array entries are reported under the array's key
+     */
+    static std::vector<std::string> changedKeys(const Config& a, const Config& b);
+    
     const Config& getConfig() const { return config_; }
     Config& getConfig() { return config_; }
     
@@ -73,7 +206,10 @@ private:
     float parseJsonFloat(const std::string& json, const std::string& key, float defaultValue);
     int parseJsonInt(const std::string& json, const std::string& key, int defaultValue);
     bool parseJsonBool(const std::string& json, const std::string& key, bool defaultValue);
+    std::vector<std::string> parseJsonObjectArray(std::string& json, const std::string& key);
     std::string createDefaultConfig();
+    void addDefaultCamera();
+    void addDefaultProfile();
 };
 
 #endif // CONFIG_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,195 @@
+/**
+ * @file CropClassifier.cpp
+ * @brief Implementation of the second-stage crop classifier
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "CropClassifier.h"
+#include "PipelineMetrics.h"
+#include "ThreadUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+// ImageNet normalization in RGB order, the convention of most exported classifiers
+const float kMeanValues[3] = {123.675f, 116.28f, 103.53f};
+const float kNormValues[3] = {1 / 58.395f, 1 / 57.12f, 1 / 57.375f};
+}
+
+CropClassifier::CropClassifier() : num_threads_(0), classified_count_(0) {
+}
+
+CropClassifier::~CropClassifier() {
+}
+
+bool CropClassifier::load(ModelRegistry& registry, const CropClassifierSettings& settings) {
+    net_.reset();
+    settings_ = settings;
+    settings_.input_size = std::max(8, settings.input_size);
+
+    selected_.assign(YoloDetector::getClassCount(), false);
+    bool any_selected = false;
+    std::stringstream list(settings.classes);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (name.empty()) continue;
+
+        const int label = YoloDetector::findClass(name);
+        if (label < 0) {
+            std::cerr << "Ignoring unknown classifier class '" << name << "'" << std::endl;
+            continue;
+        }
+        selected_[label] = true;
+        any_selected = true;
+    }
+    if (!any_selected) {
+        std::cerr << "No detector class selected for the classifier" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<const ncnn::Net> net = registry.acquire(settings.model_path, settings.use_gpu, settings.precision);
+    if (!net) {
+        std::cerr << "Failed to load classifier model: " << settings.model_path << std::endl;
+        return false;
+    }
+    if (net->input_names().empty() || net->output_names().empty()) {
+        std::cerr << "Classifier model has no input or output blob: " << settings.model_path << std::endl;
+        return false;
+    }
+    input_name_ = net->input_names()[0];
+    output_name_ = net->output_names()[0];
+
+    const std::string labels_path = settings.labels_path.empty() ? settings.model_path + ".labels" : settings.labels_path;
+    if (!loadLabels(labels_path)) {
+        std::cerr << "Failed to load classifier labels: " << labels_path << std::endl;
+        return false;
+    }
+
+    net_ = net;
+    std::cout << "Classifier loaded: " << settings.model_path << " (" << labels_.size() << " labels, "
+              << settings_.input_size << "x" << settings_.input_size << " input) for " << settings.classes << std::endl;
+    return true;
+}
+
+bool CropClassifier::loadLabels(const std::string& path) {
+    labels_.clear();
+
+    std::ifstream file(path);
+    std::string line;
+    while (file && std::getline(file, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        labels_.push_back(line);
+    }
+    return !labels_.empty();
+}
+
+int CropClassifier::classify(const cv::Mat& image, std::vector<Object>& objects) {
+    std::vector<std::vector<Object>> batch(1);
+    batch[0].swap(objects);
+    const int ret = classify(std::vector<cv::Mat>(1, image), batch);
+    objects.swap(batch[0]);
+    return ret;
+}
+
+int CropClassifier::classify(const std::vector<cv::Mat>& images, std::vector<std::vector<Object>>& objects) {
+    if (!net_) return 0;
+
+    // Reused across batches on this thread, like the detector's arenas
+    static thread_local std::vector<Crop> crops;
+    crops.clear();
+
+    const int label_count = (int)selected_.size();
+    for (size_t i = 0; i < images.size() && i < objects.size(); i++) {
+        const cv::Rect bounds(0, 0, images[i].cols, images[i].rows);
+        for (Object& object : objects[i]) {
+            object.attribute = nullptr;
+            object.attribute_prob = 0.f;
+            if (object.label < 0 || object.label >= label_count || !selected_[object.label]) continue;
+
+            const cv::Rect rect = cv::Rect(object.rect) & bounds;
+            if (std::min(rect.width, rect.height) < settings_.min_size) continue;
+            crops.push_back({images[i](rect), &object});
+        }
+    }
+    if (crops.empty()) return 0;
+
+    // Bounded cost per batch: the most confident detections are classified
+    if (settings_.max_crops > 0 && (int)crops.size() > settings_.max_crops) {
+        std::partial_sort(crops.begin(), crops.begin() + settings_.max_crops, crops.end(),
+                          [](const Crop& a, const Crop& b) { return a.object->prob > b.object->prob; });
+        crops.resize(settings_.max_crops);
+    }
+
+    ScopedStageTimer timer(PipelineStage::Classify);
+
+    const int count = (int)crops.size();
+    const int total_threads = std::max(1, num_threads_ > 0 ? num_threads_ : net_->opt.num_threads);
+    const int groups = std::min(count, std::min(total_threads, getParallelism()));
+    const int threads_per_group = std::max(1, total_threads / groups);
+
+    // Taken by reference: on the helper threads the name refers to their own, empty vector
+    std::vector<Crop>& work = crops;
+    std::vector<int> results(count, 0);
+    parallelFor(count, groups, [&](int i) {
+        results[i] = classifyCrop(work[i], threads_per_group);
+    });
+    classified_count_ += count;
+
+    for (int ret : results) {
+        if (ret != 0) return ret;
+    }
+    return 0;
+}
+
+int CropClassifier::classifyCrop(const Crop& crop, int num_threads) const {
+    // Resize and BGR to RGB straight from the view into the frame
+    const int size = settings_.input_size;
+    ncnn::Mat in = ncnn::Mat::from_pixels_resize(crop.image.data, ncnn::Mat::PIXEL_BGR2RGB, crop.image.cols,
+                                                 crop.image.rows, (int)crop.image.step[0], size, size);
+    in.substract_mean_normalize(kMeanValues, kNormValues);
+
+    ncnn::Extractor ex = net_->create_extractor();
+    ex.set_num_threads(num_threads);
+    ex.input(input_name_.c_str(), in);
+
+    ncnn::Mat out;
+    const int ret = ex.extract(output_name_.c_str(), out);
+    if (ret != 0) return ret;
+
+    const ncnn::Mat scores = out.reshape(out.w * out.h * out.c);
+    const int count = scores.w;
+    if (count <= 0) return -1;
+
+    const float* score = scores;
+    int best = 0;
+    float sum = 0.f;
+    bool probabilities = true;
+    for (int i = 0; i < count; i++) {
+        if (score[i] > score[best]) best = i;
+        probabilities = probabilities && score[i] >= 0.f;
+        sum += score[i];
+    }
+
+    // Models without a final softmax output logits
+    float prob = score[best];
+    if (!probabilities || std::fabs(sum - 1.f) > 0.01f) {
+        float total = 0.f;
+        for (int i = 0; i < count; i++) {
+            total += std::exp(score[i] - score[best]);
+        }
+        prob = 1.f / total;
+    }
+
+    if (prob < settings_.threshold) return 0;
+
+    // Labels are fixed after load(), so the pointer stays valid for the classifier's lifetime
+    crop.object->attribute = best < (int)labels_.size() ? labels_[best].c_str() : "unknown";
+    crop.object->attribute_prob = prob;
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file CropClassifier.h
+ * @brief Second-stage NCNN classifier run on crops of selected detections
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef CROP_CLASSIFIER_H
+#define CROP_CLASSIFIER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ModelRegistry.h"
+#include "YoloDetector.h"
+
+/**
+ * @struct CropClassifierSettings
+ * @brief Model and selection of the detections it runs on
+ */
+struct CropClassifierSettings {
+    std::string model_path;          ///< Model files without extension (empty = no second stage)
+    std::string labels_path;         ///< One label per line (empty = "<model_path>.labels")
+    std::string classes = "person";  ///< Detector classes whose crops are classified, comma-separated
+    int input_size = 224;            ///< Square network input the crops are resized to
+    int min_size = 32;               ///< Crops with a shorter side in pixels are skipped
+    float threshold = 0.5f;          ///< Attributes below this confidence are not attached
+    int max_crops = 8;               ///< Crops per batch, most confident detections first (0 = all)
+    bool use_gpu = false;
+    ModelPrecision precision = ModelPrecision::FP32;
+};
+
+/**
+ * @class CropClassifier
+ * @brief Runs a classification network on the boxes of a detection batch
+ *
+ * The detector's boxes of the selected classes are cut out of the frames
+ * they were found in (views, not copies), resized to the network input in
+ * one pass and run through the network together: the crops of a whole
+ * inference batch are spread over the configured NCNN threads like the
+ * detector's tiles. The best label is attached to the Object as its
+ * attribute, so it reaches the tracker, the overlay and the metadata.
+ *
+ * The network comes from the ModelRegistry and is shared; the model is
+ * expected to take an RGB image normalized with the ImageNet mean and
+ * standard deviation, and to output one score per label.
+ */
+class CropClassifier {
+public:
+    CropClassifier();
+    ~CropClassifier();
+
+    /**
+     * @brief Load the model and the labels
+     * @param registry Registry the network is shared through
+     * @param settings Model, labels and crop selection
+     * @return true if loaded, false if the model cannot be loaded or no class is selected
+     */
+    bool load(ModelRegistry& registry, const CropClassifierSettings& settings);
+
+    /**
+     * @brief Check if a model is loaded; classify() does nothing otherwise
+     * @return true if loaded
+     */
+    bool isLoaded() const { return (bool)net_; }
+
+    /**
+     * @brief Set the number of NCNN threads shared by the crops of one classify() call
+     * @param num_threads Thread count (0 = NCNN default)
+     */
+    void setNumThreads(int num_threads) { num_threads_ = std::max(0, num_threads); }
+
+    /**
+     * @brief Classify the selected detections of a batch of frames
+     * @param images Frames the detections were found in
+     * @param objects Detections per frame; the selected ones receive their attribute
+     * @return 0 on success, non-zero if a crop failed
+     */
+    int classify(const std::vector<cv::Mat>& images, std::vector<std::vector<Object>>& objects);
+
+    /**
+     * @brief Classify the selected detections of one frame
+     * @param image Frame the detections were found in
+     * @param objects Detections; the selected ones receive their attribute
+     * @return 0 on success, non-zero if a crop failed
+     */
+    int classify(const cv::Mat& image, std::vector<Object>& objects);
+
+    int getClassifiedCount() const { return classified_count_; }  ///< Crops run through the network
+    int getLabelCount() const { return (int)labels_.size(); }
+
+private:
+    /// One detection to classify
+    struct Crop {
+        cv::Mat image;      ///< View of the box in its frame
+        Object* object;     ///< Receives the attribute
+    };
+
+    std::shared_ptr<const ncnn::Net> net_;
+    CropClassifierSettings settings_;
+    std::vector<std::string> labels_;
+    std::vector<bool> selected_;        ///< Per detector label
+    std::string input_name_;
+    std::string output_name_;
+    int num_threads_;
+    std::atomic<int> classified_count_;
+
+    bool loadLabels(const std::string& path);
+    int classifyCrop(const Crop& crop, int num_threads) const;
+};
+
+#endif // CROP_CLASSIFIER_H
@@ -0,0 +1,89 @@
+/**
+ * @file DetectionLayout.cpp
+ * @brief Implementation of the per-camera detection layout
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "DetectionLayout.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+DetectionLayout DetectionLayout::create(const cv::Size& frame_size, const std::vector<cv::Rect2f>& areas,
+                                        int tile_cols, int tile_rows, float overlap, bool full_pass, int target_size) {
+    DetectionLayout layout;
+    layout.target_size = target_size;
+
+    tile_cols = std::max(1, tile_cols);
+    tile_rows = std::max(1, tile_rows);
+    overlap = std::max(0.0f, std::min(overlap, 0.9f));
+    const bool tiled = tile_cols > 1 || tile_rows > 1;
+    if (areas.empty() && !tiled) return layout;
+
+    const cv::Rect frame(0, 0, frame_size.width, frame_size.height);
+    std::vector<cv::Rect> bases;
+    if (areas.empty()) {
+        bases.push_back(frame);
+    }
+    for (const auto& area : areas) {
+        const cv::Rect rect = cv::Rect(cvRound(area.x * frame.width), cvRound(area.y * frame.height),
+                                       cvRound(area.width * frame.width), cvRound(area.height * frame.height)) & frame;
+        if (rect.width > 0 && rect.height > 0) bases.push_back(rect);
+    }
+
+    for (const auto& base : bases) {
+        if (!tiled || full_pass) {
+            layout.regions.push_back({base, 0});
+        }
+        if (!tiled) continue;
+
+        // n tiles overlapping by a fraction o cover n - (n - 1) * o tile sizes
+        const float tile_w = base.width / (tile_cols - (tile_cols - 1) * overlap);
+        const float tile_h = base.height / (tile_rows - (tile_rows - 1) * overlap);
+        const float step_x = tile_w * (1.0f - overlap);
+        const float step_y = tile_h * (1.0f - overlap);
+
+        for (int row = 0; row < tile_rows; row++) {
+            const int y0 = base.y + cvRound(row * step_y);
+            const int y1 = row == tile_rows - 1 ? base.y + base.height : base.y + cvRound(row * step_y + tile_h);
+            for (int col = 0; col < tile_cols; col++) {
+                const int x0 = base.x + cvRound(col * step_x);
+                const int x1 = col == tile_cols - 1 ? base.x + base.width : base.x + cvRound(col * step_x + tile_w);
+
+                // Without the full pass nothing sees an object larger than the overlap whole,
+                // so its cut boxes are kept and left to the NMS
+                int inner_edges = 0;
+                if (full_pass) {
+                    if (col > 0) inner_edges |= DetectionRegion::Left;
+                    if (row > 0) inner_edges |= DetectionRegion::Top;
+                    if (col < tile_cols - 1) inner_edges |= DetectionRegion::Right;
+                    if (row < tile_rows - 1) inner_edges |= DetectionRegion::Bottom;
+                }
+                layout.regions.push_back({cv::Rect(x0, y0, x1 - x0, y1 - y0), inner_edges});
+            }
+        }
+    }
+    return layout;
+}
+
+bool DetectionLayout::parseAreas(const std::string& text, std::vector<cv::Rect2f>& areas) {
+    areas.clear();
+
+    std::stringstream list(text);
+    std::string entry;
+    while (std::getline(list, entry, ';')) {
+        if (entry.find_first_not_of(" \t") == std::string::npos) continue;
+
+        float x = 0, y = 0, w = 0, h = 0;
+        char c1 = 0, c2 = 0, c3 = 0;
+        std::stringstream values(entry);
+        if (!(values >> x >> c1 >> y >> c2 >> w >> c3 >> h) || c1 != ',' || c2 != ',' || c3 != ',' || w <= 0 || h <= 0) {
+            std::cerr << "Invalid ROI entry '" << entry << "', expected x,y,w,h fractions" << std::endl;
+            areas.clear();
+            return false;
+        }
+        areas.push_back(cv::Rect2f(x, y, w, h));
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file DetectionLayout.h
+ * @brief Crops and input resolution the detector analyses a camera's frames with
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef DETECTION_LAYOUT_H
+#define DETECTION_LAYOUT_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @struct DetectionRegion
+ * @brief One crop of the frame run through the network on its own
+ */
+struct DetectionRegion {
+    /// Crop edges that cut through the analysed area rather than bounding it
+    enum Edge { Left = 1, Top = 2, Right = 4, Bottom = 8 };
+
+    cv::Rect rect;           ///< Crop in frame pixels
+    int inner_edges = 0;     ///< Edge flags; boxes touching these are left to the neighbouring tile
+};
+
+/**
+ * @struct DetectionLayout
+ * @brief Per-camera detection geometry
+ *
+ * With no regions the whole frame is letterboxed into the network, as before.
+ * Otherwise every region is detected separately (in parallel, or in one GPU
+ * batch), the boxes are moved back to frame coordinates and merged with NMS.
+ * Tiles overlap, so small objects cut by one tile are whole in its neighbour.
+ * With the full-area pass, which finds the objects larger than the overlap,
+ * boxes touching an inner tile edge are dropped instead of merged.
+ */
+struct DetectionLayout {
+    int target_size = 0;                   ///< Network input size of the longer side (0 = model default)
+    std::vector<DetectionRegion> regions;  ///< Crops to analyse (empty = whole frame)
+
+    /**
+     * @brief Build a layout
+     * @param frame_size Camera frame size
+     * @param areas Areas to analyse as fractions of the frame (empty = whole frame)
+     * @param tile_cols Tiles per area horizontally
+     * @param tile_rows Tiles per area vertically
+     * @param overlap Overlap of neighbouring tiles as a fraction of the tile size
+     * @param full_pass Also analyse each tiled area as a whole, for objects larger than the overlap
+     * @param target_size Network input size (0 = model default)
+     * @return Layout; without areas or tiles it has no regions
+     */
+    static DetectionLayout create(const cv::Size& frame_size, const std::vector<cv::Rect2f>& areas,
+                                  int tile_cols, int tile_rows, float overlap, bool full_pass, int target_size);
+
+    /**
+     * @brief Parse areas written as "x,y,w,h;..." fractions of the frame
+     * @param text Area list (empty = none)
+     * @param areas Output areas
+     * @return false if an entry could not be parsed (areas is then empty)
+     */
+    static bool parseAreas(const std::string& text, std::vector<cv::Rect2f>& areas);
+};
+
+#endif // DETECTION_LAYOUT_H
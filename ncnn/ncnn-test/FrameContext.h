@@ -0,0 +1,46 @@
+/**
+ * @file FrameContext.h
+ * @brief Captured frame with its identity and capture time
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef FRAME_CONTEXT_H
+#define FRAME_CONTEXT_H
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+struct DetectionLayout;
+struct RuntimeSettings;
+
+/**
+ * @struct FrameContext
+ * @brief One captured frame, created by the capture stage and passed through every later stage
+ *
+ * The pixel data is shared read-only between the stages, so copying a context
+ * is cheap. capture_time is the reference for per-stage latency, staleness and
+ * RTSP timestamps; wall_time is what metadata records report.
+ */
+struct FrameContext {
+    cv::Mat image;                                      ///< BGR frame
+    uint64_t sequence = 0;                              ///< Per-camera capture sequence number
+    int camera = -1;                                    ///< Camera index
+    std::chrono::steady_clock::time_point capture_time; ///< Monotonic time the frame was captured (or read, if the source has no timestamps)
+    std::chrono::system_clock::time_point wall_time;    ///< Wall-clock time matching capture_time
+    std::shared_ptr<const DetectionLayout> layout;      ///< Regions the detector analyses (empty = whole frame)
+    std::shared_ptr<const RuntimeSettings> settings;    ///< Thresholds and intervals in effect at capture
+
+    /**
+     * @brief Time elapsed since capture
+     * @param now Current monotonic time
+     * @return Age in milliseconds
+     */
+    double ageMs(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const {
+        return std::chrono::duration<double, std::milli>(now - capture_time).count();
+    }
+};
+
+#endif // FRAME_CONTEXT_H
@@ -0,0 +1,251 @@
+/**
+ * @file FrameQueue.h
+ * @brief Bounded lock-free ring buffer used to link the pipeline stages
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @enum OverflowPolicy
+ * @brief What the producer does when the queue is full
+ */
+enum class OverflowPolicy {
+    DropOldest,  ///< Discard the oldest queued item to make room (never blocks the producer)
+    Block        ///< Wait until the consumer frees a slot
+};
+
+/**
+ * @brief Parse an overflow policy name from the configuration
+ * @param name "drop_oldest" or "block"
+ * @return Matching policy, DropOldest for unknown names
+ */
+inline OverflowPolicy parseOverflowPolicy(const std::string& name) {
+    return name == "block" ? OverflowPolicy::Block : OverflowPolicy::DropOldest;
+}
+
+/**
+ * @class FrameQueue
+ * @brief Bounded single-producer / single-consumer ring buffer
+ *
+ * The data path is lock-free: every slot carries a sequence number and the
+ * read index is claimed with a CAS, which also lets the producer evict the
+ * oldest item when the DropOldest policy is active. A mutex/condition
+ * variable pair is only touched when one side actually has to sleep.
+ *
+ * @tparam T Item type, must be default-constructible and movable
+ */
+template <typename T>
+class FrameQueue {
+public:
+    /**
+     * @brief Construct a queue
+     * @param capacity Maximum number of queued items (minimum 2)
+     * @param policy Behaviour of push() when the queue is full
+     */
+    explicit FrameQueue(size_t capacity, OverflowPolicy policy = OverflowPolicy::DropOldest)
+        : policy_(policy), closed_(false), enqueue_pos_(0), dequeue_pos_(0),
+          dropped_count_(0), consumer_waiting_(0), producer_waiting_(0) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        capacity_ = capacity < 2 ? 2 : capacity;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    /**
+     * @brief Enqueue an item (producer side)
+     * @param item Item to enqueue
+     * @return false if the queue was closed before the item could be queued
+     */
+    bool push(T item) {
+        while (!closed_.load(std::memory_order_acquire)) {
+            if (size() < capacity_) {
+                if (tryPush(item)) {
+                    notify(consumer_waiting_, not_empty_);
+                    return true;
+                }
+                // A concurrent pop has claimed the slot but not released it yet
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (policy_ == OverflowPolicy::DropOldest) {
+                T discarded;
+                if (tryPop(discarded)) {
+                    dropped_count_++;
+                }
+                continue;
+            }
+
+            // Block policy: sleep until the consumer frees a slot
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            producer_waiting_++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_full_.wait_for(lock, std::chrono::milliseconds(10), [this] {
+                return size() < capacity_ || closed_.load(std::memory_order_acquire);
+            });
+            producer_waiting_--;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Dequeue an item without waiting (consumer side)
+     * @param item Receives the dequeued item
+     * @return true if an item was dequeued
+     */
+    bool pop(T& item) {
+        if (tryPop(item)) {
+            notify(producer_waiting_, not_full_);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Dequeue an item, waiting up to timeout for one to arrive
+     * @param item Receives the dequeued item
+     * @param timeout Maximum time to wait
+     * @return true if an item was dequeued, false on timeout or when closed and empty
+     */
+    bool waitPop(T& item, std::chrono::milliseconds timeout) {
+        if (pop(item)) return true;
+
+        {
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            consumer_waiting_++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_empty_.wait_for(lock, timeout, [this] {
+                return size() > 0 || closed_.load(std::memory_order_acquire);
+            });
+            consumer_waiting_--;
+        }
+        return pop(item);
+    }
+
+    /**
+     * @brief Close the queue and wake up any waiting producer or consumer
+     */
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    /**
+     * @brief Check if the queue has been closed
+     * @return true if closed
+     */
+    bool isClosed() const { return closed_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Approximate number of queued items
+     * @return Queue depth
+     */
+    size_t size() const {
+        size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+        size_t deq = dequeue_pos_.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    /**
+     * @brief Get the configured capacity
+     * @return Maximum number of queued items
+     */
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief Get the number of items evicted by the DropOldest policy
+     * @return Dropped item count
+     */
+    uint64_t getDroppedCount() const { return dropped_count_.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const OverflowPolicy policy_;
+    std::atomic<bool> closed_;
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    size_t capacity_;
+
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+    alignas(64) std::atomic<uint64_t> dropped_count_;
+
+    // Only used when one side has to sleep
+    std::mutex wait_mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::atomic<int> consumer_waiting_;
+    std::atomic<int> producer_waiting_;
+
+    bool tryPush(T& item) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != pos) {
+            return false; // Slot still owned by the consumer side
+        }
+        cell.data = std::move(item);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        enqueue_pos_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Safe to call from both the consumer and the producer (DropOldest eviction)
+    bool tryPop(T& item) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel)) {
+                    item = std::move(cell.data);
+                    cell.data = T();
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void notify(std::atomic<int>& waiting, std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            cv.notify_one();
+        }
+    }
+};
+
+#endif // FRAME_QUEUE_H
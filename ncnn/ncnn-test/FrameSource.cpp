@@ -0,0 +1,22 @@
+/**
+ * @file FrameSource.cpp
+ * @brief Capture backend factory
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "FrameSource.h"
+#include "OpenCvFrameSource.h"
+#include "GstFrameSource.h"
+#include <iostream>
+
+std::unique_ptr<FrameSource> FrameSource::create(const std::string& backend, const std::string& decoder) {
+    if (backend == "gstreamer") {
+        return std::make_unique<GstFrameSource>(decoder);
+    }
+
+    if (backend != "opencv") {
+        std::cerr << "Unknown capture backend '" << backend << "', using opencv" << std::endl;
+    }
+    return std::make_unique<OpenCvFrameSource>();
+}
@@ -0,0 +1,70 @@
+/**
+ * @file FrameSource.h
+ * @brief Camera capture backend interface
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "ConfigManager.h"
+
+/**
+ * @class FrameSource
+ * @brief Delivers BGR frames from one camera
+ *
+ * Implementations: OpenCvFrameSource (cv::VideoCapture, software MJPEG
+ * decode) and GstFrameSource (v4l2src pipeline with hardware JPEG decode).
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    /**
+     * @brief Open the camera
+     * @param camera Camera settings (device index, size, frame rate)
+     * @return true if the camera was opened, false otherwise
+     */
+    virtual bool open(const ConfigManager::CameraConfig& camera) = 0;
+
+    /**
+     * @brief Read the next frame
+     * @param frame Output BGR frame; a new Mat is allocated unless frame already owns a buffer of the right size
+     * @return true if a frame was read, false on timeout or error
+     */
+    virtual bool read(cv::Mat& frame) = 0;
+
+    /**
+     * @brief Get the time the frame last returned by read() was captured
+     * @param time Receives the capture time on the monotonic clock
+     * @return true if the backend timestamps its frames, false if the caller has to use the read time
+     */
+    virtual bool getCaptureTime(std::chrono::steady_clock::time_point& time) const { return false; }
+
+    /**
+     * @brief Release the camera
+     */
+    virtual void close() = 0;
+
+    /**
+     * @brief Get a printable name of the backend
+     * @return Backend description, e.g. "gstreamer (v4l2jpegdec)"
+     */
+    virtual std::string getName() const = 0;
+
+    /**
+     * @brief Create a capture backend
+     * @param backend "opencv" or "gstreamer" (unknown values fall back to "opencv")
+     * @param decoder JPEG decoder element for the GStreamer backend, or "auto"
+     * @return New frame source
+     */
+    static std::unique_ptr<FrameSource> create(const std::string& backend, const std::string& decoder);
+};
+
+#endif // FRAME_SOURCE_H
@@ -0,0 +1,206 @@
+/**
+ * @file GstFrameSource.cpp
+ * @brief Implementation of the GStreamer capture backend
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "GstFrameSource.h"
+#include <iostream>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+
+/**
+ * @brief JPEG decoders probed in order when the decoder is "auto"
+ */
+static const char* jpeg_decoders[] = { "nvjpegdec", "v4l2jpegdec", "jpegdec" };
+
+GstFrameSource::GstFrameSource(const std::string& decoder)
+    : requested_decoder_(decoder), pipeline_(nullptr), appsink_(nullptr), has_capture_time_(false) {
+}
+
+GstFrameSource::~GstFrameSource() {
+    close();
+}
+
+std::string GstFrameSource::selectDecoder() const {
+    if (!requested_decoder_.empty() && requested_decoder_ != "auto") {
+        GstElementFactory* factory = gst_element_factory_find(requested_decoder_.c_str());
+        if (factory) {
+            gst_object_unref(factory);
+            return requested_decoder_;
+        }
+        std::cerr << "JPEG decoder " << requested_decoder_ << " not available, probing..." << std::endl;
+    }
+
+    for (const char* decoder : jpeg_decoders) {
+        GstElementFactory* factory = gst_element_factory_find(decoder);
+        if (factory) {
+            gst_object_unref(factory);
+            return decoder;
+        }
+    }
+
+    return "";
+}
+
+bool GstFrameSource::open(const ConfigManager::CameraConfig& camera) {
+    close();
+
+    gst_init(nullptr, nullptr);
+
+    decoder_ = selectDecoder();
+    if (decoder_.empty()) {
+        std::cerr << "No JPEG decoder available for camera " << camera.camera_id << std::endl;
+        return false;
+    }
+
+    // Hardware decoders import the camera's DMA-BUFs instead of copying them
+    std::string io_mode = decoder_ == "v4l2jpegdec" ? " io-mode=dmabuf" : "";
+
+    std::string launch =
+        "v4l2src device=/dev/video" + std::to_string(camera.camera_id) + io_mode + " ! "
+        "image/jpeg,width=" + std::to_string(camera.frame_width) +
+        ",height=" + std::to_string(camera.frame_height) +
+        ",framerate=" + std::to_string(camera.frame_fps) + "/1 ! " +
+        decoder_ + " ! videoconvert ! video/x-raw,format=BGR ! "
+        "appsink name=sink max-buffers=1 drop=true sync=false";
+
+    std::cout << "Capture pipeline [" << camera.camera_id << "]: " << launch << std::endl;
+
+    GError* error = nullptr;
+    pipeline_ = gst_parse_launch(launch.c_str(), &error);
+    if (!pipeline_) {
+        std::cerr << "Failed to create capture pipeline: " << (error ? error->message : "unknown error") << std::endl;
+        if (error) g_error_free(error);
+        return false;
+    }
+    if (error) {
+        g_error_free(error);
+    }
+
+    appsink_ = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
+    if (!appsink_) {
+        std::cerr << "Failed to get capture appsink" << std::endl;
+        close();
+        return false;
+    }
+
+    // Same clock as the RTSP media pipelines; read() turns the buffer timestamps into capture times on it
+    GstClock* clock = gst_system_clock_obtain();
+    gst_pipeline_use_clock(GST_PIPELINE(pipeline_), clock);
+    gst_object_unref(clock);
+
+    if (gst_element_set_state(pipeline_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE ||
+        gst_element_get_state(pipeline_, nullptr, nullptr, 5 * GST_SECOND) == GST_STATE_CHANGE_FAILURE) {
+        std::cerr << "Failed to start capture pipeline for camera " << camera.camera_id << std::endl;
+        logBusErrors();
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool GstFrameSource::read(cv::Mat& frame) {
+    if (!appsink_) {
+        return false;
+    }
+
+    GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink_), GST_SECOND);
+    if (!sample) {
+        logBusErrors();
+        return false;
+    }
+
+    GstVideoInfo info;
+    GstCaps* caps = gst_sample_get_caps(sample);
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    if (!caps || !buffer || !gst_video_info_from_caps(&info, caps)) {
+        gst_sample_unref(sample);
+        return false;
+    }
+
+    updateCaptureTime(sample, buffer);
+
+    GstMapInfo map;
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        gst_sample_unref(sample);
+        return false;
+    }
+
+    // The sample goes back to the pipeline, so the frame needs its own pixels
+    cv::Mat view(GST_VIDEO_INFO_HEIGHT(&info), GST_VIDEO_INFO_WIDTH(&info), CV_8UC3,
+                 map.data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 0), GST_VIDEO_INFO_PLANE_STRIDE(&info, 0));
+    view.copyTo(frame);
+
+    gst_buffer_unmap(buffer, &map);
+    gst_sample_unref(sample);
+    return true;
+}
+
+void GstFrameSource::updateCaptureTime(GstSample* sample, GstBuffer* buffer) {
+    has_capture_time_ = false;
+
+    const GstClockTime pts = GST_BUFFER_PTS(buffer);
+    GstClock* clock = gst_element_get_clock(pipeline_);
+    if (!clock || !GST_CLOCK_TIME_IS_VALID(pts)) {
+        if (clock) gst_object_unref(clock);
+        return;
+    }
+
+    // v4l2src stamps the driver's capture time as running time; base time puts it on the clock
+    const GstSegment* segment = gst_sample_get_segment(sample);
+    const GstClockTime running = segment ? gst_segment_to_running_time(segment, GST_FORMAT_TIME, pts) : pts;
+    const GstClockTime now = gst_clock_get_time(clock);
+    const auto steady_now = std::chrono::steady_clock::now();
+    gst_object_unref(clock);
+
+    if (!GST_CLOCK_TIME_IS_VALID(running)) return;
+    const GstClockTime captured = gst_element_get_base_time(pipeline_) + running;
+    if (captured > now) return;
+
+    capture_time_ = steady_now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::nanoseconds(now - captured));
+    has_capture_time_ = true;
+}
+
+bool GstFrameSource::getCaptureTime(std::chrono::steady_clock::time_point& time) const {
+    if (!has_capture_time_) return false;
+    time = capture_time_;
+    return true;
+}
+
+void GstFrameSource::close() {
+    if (pipeline_) {
+        gst_element_set_state(pipeline_, GST_STATE_NULL);
+    }
+    if (appsink_) {
+        gst_object_unref(appsink_);
+        appsink_ = nullptr;
+    }
+    if (pipeline_) {
+        gst_object_unref(pipeline_);
+        pipeline_ = nullptr;
+    }
+    has_capture_time_ = false;
+}
+
+void GstFrameSource::logBusErrors() {
+    if (!pipeline_) return;
+
+    GstBus* bus = gst_element_get_bus(pipeline_);
+    if (!bus) return;
+
+    GstMessage* message;
+    while ((message = gst_bus_timed_pop_filtered(bus, 0, GST_MESSAGE_ERROR)) != nullptr) {
+        GError* error = nullptr;
+        gchar* debug = nullptr;
+        gst_message_parse_error(message, &error, &debug);
+        std::cerr << "Capture pipeline error: " << (error ? error->message : "unknown") << std::endl;
+        if (error) g_error_free(error);
+        g_free(debug);
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file GstFrameSource.h
+ * @brief Capture backend based on a GStreamer v4l2src pipeline
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef GST_FRAME_SOURCE_H
+#define GST_FRAME_SOURCE_H
+
+#include <gst/gst.h>
+#include "FrameSource.h"
+
+/**
+ * @class GstFrameSource
+ * @brief Reads MJPG from v4l2src and decodes it with a hardware JPEG decoder
+ *
+ * Pipeline: v4l2src ! image/jpeg ! <decoder> ! videoconvert ! BGR appsink.
+ * The decoder is probed in order nvjpegdec, v4l2jpegdec, jpegdec. With
+ * v4l2jpegdec the camera buffers are exported as DMA-BUF to the decoder.
+ *
+ * The decoded frame is still copied out of the mapped sample, since the
+ * sample has to go back to the pipeline while the stages use the frame. The
+ * pipeline runs on the GStreamer system clock, and each frame's capture time
+ * is its buffer timestamp on that clock (base time + running time), so
+ * latencies and RTSP timestamps start at the camera, not after decode and copy.
+ */
+class GstFrameSource : public FrameSource {
+public:
+    /**
+     * @brief Constructor
+     * @param decoder JPEG decoder element, or "auto" to probe
+     */
+    explicit GstFrameSource(const std::string& decoder = "auto");
+    ~GstFrameSource() override;
+
+    bool open(const ConfigManager::CameraConfig& camera) override;
+    bool read(cv::Mat& frame) override;
+    bool getCaptureTime(std::chrono::steady_clock::time_point& time) const override;
+    void close() override;
+    std::string getName() const override { return "gstreamer (" + decoder_ + ")"; }
+
+private:
+    std::string requested_decoder_;
+    std::string decoder_;
+    GstElement* pipeline_;
+    GstElement* appsink_;
+    std::chrono::steady_clock::time_point capture_time_;  ///< Capture time of the last frame read
+    bool has_capture_time_;                               ///< false if that frame carried no timestamp
+
+    std::string selectDecoder() const;
+    void updateCaptureTime(GstSample* sample, GstBuffer* buffer);
+    void logBusErrors();
+};
+
+#endif // GST_FRAME_SOURCE_H
@@ -0,0 +1,94 @@
+/**
+ * @file HttpTransport.cpp
+ * @brief Implementation of the HTTP POST metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "HttpTransport.h"
+#include <iostream>
+
+/**
+ * @brief Callback function for libcurl to handle HTTP response data
+ * @param contents Pointer to received data
+ * @param size Size of each data element
+ * @param nmemb Number of data elements
+ * @param userp User-defined pointer (string to store response)
+ * @return Total number of bytes processed
+ */
+static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    ((std::string*)userp)->append((char*)contents, size * nmemb);
+    return size * nmemb;
+}
+
+HttpTransport::HttpTransport(const MetadataTransportSettings& settings, const std::string& content_type)
+    : url_("http://" + settings.host + ":" + std::to_string(settings.port) + settings.endpoint),
+      content_type_(content_type), timeout_ms_(settings.timeout_ms),
+      curl_(nullptr), headers_(nullptr), last_response_code_(0) {
+}
+
+HttpTransport::~HttpTransport() {
+    close();
+}
+
+bool HttpTransport::connect() {
+    close();
+
+    curl_ = curl_easy_init();
+    if (!curl_) return false;
+
+    // Everything except the body stays the same between posts
+    std::string content_type = "Content-Type: " + content_type_;
+    headers_ = curl_slist_append(nullptr, content_type.c_str());
+    // No "Expect: 100-continue" round trip for larger bodies
+    headers_ = curl_slist_append(headers_, "Expect:");
+    curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
+    curl_easy_setopt(curl_, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers_);
+    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_data_);
+    curl_easy_setopt(curl_, CURLOPT_TIMEOUT_MS, (long)timeout_ms_);
+    curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl_, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl_, CURLOPT_TCP_KEEPALIVE, 1L);
+    return true;
+}
+
+bool HttpTransport::send(const std::string& data, bool binary) {
+    if (!curl_) return false;
+
+    response_data_.clear();
+    curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, data.data());
+    curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, (long)data.size());
+
+    CURLcode res = curl_easy_perform(curl_);
+    if (res != CURLE_OK) {
+        // Don't spam error messages - server might not be running
+        // std::cerr << "HTTP POST failed: " << curl_easy_strerror(res) << std::endl;
+        return false;
+    }
+
+    long response_code = 0;
+    curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &response_code);
+    const bool success = response_code >= 200 && response_code < 300;
+    if (response_code != last_response_code_) {
+        if (!success) {
+            std::cout << "HTTP POST failed with response code: " << response_code << std::endl;
+        } else if (last_response_code_ != 0 && (last_response_code_ < 200 || last_response_code_ >= 300)) {
+            std::cout << "HTTP POST succeeds again (response code " << response_code << ")" << std::endl;
+        }
+        last_response_code_ = response_code;
+    }
+    return success;
+}
+
+void HttpTransport::close() {
+    if (curl_) {
+        curl_easy_cleanup(curl_);
+        curl_ = nullptr;
+    }
+    if (headers_) {
+        curl_slist_free_all(headers_);
+        headers_ = nullptr;
+    }
+}
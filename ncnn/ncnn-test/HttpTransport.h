@@ -0,0 +1,45 @@
+/**
+ * @file HttpTransport.h
+ * @brief HTTP POST metadata transport over a keep-alive libcurl handle
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <curl/curl.h>
+#include <string>
+
+#include "MetadataTransport.h"
+
+/**
+ * @class HttpTransport
+ * @brief Posts every message to one URL, reusing the TCP connection
+ *
+ * The curl easy handle keeps its connection cache across posts, so only the
+ * first post pays for the handshake; curl reconnects by itself after errors.
+ */
+class HttpTransport : public MetadataTransport {
+public:
+    HttpTransport(const MetadataTransportSettings& settings, const std::string& content_type);
+    ~HttpTransport() override;
+
+    bool connect() override;
+    bool isConnected() const override { return curl_ != nullptr; }
+    bool send(const std::string& data, bool binary) override;
+    void close() override;
+    std::string getName() const override { return url_; }
+
+private:
+    std::string url_;
+    std::string content_type_;
+    int timeout_ms_;
+
+    CURL* curl_;
+    struct curl_slist* headers_;
+    std::string response_data_;
+    long last_response_code_;  ///< HTTP status of the last post, failures are logged when it changes
+};
+
+#endif // HTTP_TRANSPORT_H
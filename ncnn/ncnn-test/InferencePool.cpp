@@ -0,0 +1,259 @@
+/**
+ * @file InferencePool.cpp
+ * @brief Implementation of the shared detection worker pool
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "InferencePool.h"
+#include "RuntimeSettings.h"
+#include "ThreadUtils.h"
+#include <iostream>
+#include <algorithm>
+
+InferencePool::InferencePool(YoloDetector& detector, CropClassifier& classifier)
+    : detector_(detector), classifier_(classifier), prob_threshold_(0.25f), nms_threshold_(0.45f), batch_size_(1), max_frame_age_ms_(0),
+      running_(false), next_camera_(0), wake_generation_(0) {
+}
+
+InferencePool::~InferencePool() {
+    stop();
+}
+
+bool InferencePool::start(int camera_count, int worker_count, const std::vector<int>& cores,
+                          float prob_threshold, float nms_threshold, size_t queue_size, OverflowPolicy policy,
+                          int batch_size, int threads_per_worker) {
+    if (running_) {
+        std::cout << "Inference pool already running" << std::endl;
+        return true;
+    }
+
+    if (camera_count <= 0) {
+        std::cerr << "Inference pool needs at least one camera" << std::endl;
+        return false;
+    }
+
+    prob_threshold_ = prob_threshold;
+    nms_threshold_ = nms_threshold;
+    batch_size_ = std::max(1, std::min(batch_size, camera_count));
+
+    cameras_.clear();
+    for (int i = 0; i < camera_count; i++) {
+        std::unique_ptr<CameraSlot> slot(new CameraSlot());
+        slot->queue = std::make_unique<FrameQueue<FrameContext>>(queue_size, policy);
+        cameras_.push_back(std::move(slot));
+    }
+
+    std::vector<int> worker_cores = cores;
+    if (worker_cores.empty()) {
+        for (int core = 0; core < getCpuCount(); core++) {
+            worker_cores.push_back(core);
+        }
+    }
+
+    if (worker_count <= 0) {
+        worker_count = std::min((int)worker_cores.size(), camera_count);
+    }
+    if (worker_count > (int)worker_cores.size()) {
+        std::cerr << "Inference workers limited to " << worker_cores.size() << ", one per inference core (requested "
+                  << worker_count << ")" << std::endl;
+        worker_count = (int)worker_cores.size();
+    }
+
+    // Split the cores between the workers so their NCNN thread pools do not overlap; the
+    // first workers take one leftover core each so no inference core sits idle
+    const int slice = std::max(1, (int)worker_cores.size() / worker_count);
+    const int remainder = (int)worker_cores.size() - slice * worker_count;
+    const int num_threads = threads_per_worker > 0 ? threads_per_worker : slice;
+    detector_.setNumThreads(num_threads);
+    classifier_.setNumThreads(num_threads);
+
+    running_ = true;
+    size_t next_core = 0;
+    for (int i = 0; i < worker_count; i++) {
+        std::vector<int> pinned;
+        const int cores_for_worker = slice + (i < remainder ? 1 : 0);
+        for (int k = 0; k < cores_for_worker; k++) {
+            pinned.push_back(worker_cores[next_core++]);
+        }
+        workers_.emplace_back(&InferencePool::workerLoop, this, i, pinned, num_threads);
+    }
+
+    std::cout << "Inference pool started: " << worker_count << " worker(s) x " << num_threads << " thread(s) on "
+              << slice << (remainder > 0 ? "-" + std::to_string(slice + 1) : std::string()) << " core(s) each for "
+              << camera_count << " camera(s), batch size " << batch_size_ << std::endl;
+    return true;
+}
+
+void InferencePool::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    for (auto& camera : cameras_) {
+        camera->queue->close();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_all();
+    }
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+
+    std::cout << "Inference pool stopped" << std::endl;
+}
+
+bool InferencePool::submit(int camera, const FrameContext& frame) {
+    if (!running_ || frame.image.empty() || camera < 0 || camera >= (int)cameras_.size()) {
+        return false;
+    }
+
+    if (!cameras_[camera]->queue->push(frame)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_generation_++;
+    wake_cv_.notify_one();
+    return true;
+}
+
+int InferencePool::getLatest(int camera, std::vector<Object>& objects) const {
+    if (camera < 0 || camera >= (int)cameras_.size()) {
+        objects.clear();
+        return 0;
+    }
+
+    const CameraSlot& slot = *cameras_[camera];
+    std::lock_guard<std::mutex> lock(slot.latest_mutex);
+    objects = slot.latest_objects;
+    return slot.processed_count;
+}
+
+int InferencePool::getProcessedCount(int camera) const {
+    if (camera < 0 || camera >= (int)cameras_.size()) return 0;
+    return cameras_[camera]->processed_count;
+}
+
+int InferencePool::getDroppedCount(int camera) const {
+    if (camera < 0 || camera >= (int)cameras_.size()) return 0;
+    return (int)cameras_[camera]->queue->getDroppedCount() + cameras_[camera]->stale_count;
+}
+
+int InferencePool::getQueueDepth(int camera) const {
+    if (camera < 0 || camera >= (int)cameras_.size()) return 0;
+    return (int)cameras_[camera]->queue->size();
+}
+
+void InferencePool::acquireCameras(std::vector<int>& cameras, std::vector<FrameContext>& frames) {
+    cameras.clear();
+    frames.clear();
+
+    const int count = (int)cameras_.size();
+    const int max_age_ms = max_frame_age_ms_;
+    const auto now = std::chrono::steady_clock::now();
+    const int start = (int)(next_camera_.fetch_add(1) % count);
+
+    for (int i = 0; i < count && (int)cameras.size() < batch_size_; i++) {
+        int camera = (start + i) % count;
+        CameraSlot& slot = *cameras_[camera];
+
+        if (slot.queue->size() == 0) continue;
+
+        // Claim the camera so its frames are never processed out of order
+        bool expected = false;
+        if (!slot.in_flight.compare_exchange_strong(expected, true)) continue;
+
+        // Skip frames that waited too long; a newer one may be right behind
+        FrameContext frame;
+        bool popped = false;
+        while ((popped = slot.queue->pop(frame)) && max_age_ms > 0 && frame.ageMs(now) > max_age_ms) {
+            slot.stale_count++;
+        }
+        if (popped) {
+            cameras.push_back(camera);
+            frames.push_back(std::move(frame));
+            continue;
+        }
+        slot.in_flight = false;
+    }
+}
+
+void InferencePool::workerLoop(int worker_index, std::vector<int> cores, int num_threads) {
+    setCurrentThreadName("infer-" + std::to_string(worker_index));
+
+    // NCNN's OpenMP threads are created on the first detection and inherit this mask
+    setCurrentThreadAffinity(cores);
+
+    // Helpers that split batches and tiles with this worker, on its cores; they live as long
+    // as the worker so their per-thread buffers and allocators are kept between batches
+    WorkerGroup helpers;
+    helpers.start(std::max(1, num_threads) - 1, cores, "infer-" + std::to_string(worker_index));
+    WorkerGroup::setCurrent(&helpers);
+
+    std::vector<int> cameras;
+    std::vector<FrameContext> frames;
+    std::vector<cv::Mat> images;
+    std::vector<const DetectionLayout*> layouts;
+    std::vector<std::vector<Object>> results;
+    while (running_) {
+        unsigned generation;
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            generation = wake_generation_;
+        }
+
+        acquireCameras(cameras, frames);
+        if (cameras.empty()) {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                return wake_generation_ != generation || !running_;
+            });
+            continue;
+        }
+
+        images.clear();
+        layouts.clear();
+        for (const auto& frame : frames) {
+            images.push_back(frame.image);
+            layouts.push_back(frame.layout.get());
+        }
+        // A batch uses the thresholds its first frame was captured with
+        const RuntimeSettings* settings = frames[0].settings.get();
+        detector_.detectBatch(images, results,
+                              settings ? settings->detection_threshold : prob_threshold_,
+                              settings ? settings->nms_threshold : nms_threshold_, layouts);
+        classifier_.classify(images, results);
+
+        bool pending = false;
+        for (size_t i = 0; i < cameras.size(); i++) {
+            CameraSlot& slot = *cameras_[cameras[i]];
+            {
+                std::lock_guard<std::mutex> lock(slot.latest_mutex);
+                slot.latest_objects = results[i];
+                slot.processed_count++;
+            }
+
+            if (result_callback_) {
+                result_callback_(cameras[i], frames[i], results[i]);
+            }
+
+            slot.in_flight = false;
+            pending = pending || slot.queue->size() > 0;
+        }
+
+        // Frames of these cameras that arrived meanwhile were skipped by idle workers
+        if (pending) {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            wake_generation_++;
+            wake_cv_.notify_one();
+        }
+    }
+
+    WorkerGroup::setCurrent(nullptr);
+}
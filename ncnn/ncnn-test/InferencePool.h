@@ -0,0 +1,179 @@
+/**
+ * @file InferencePool.h
+ * @brief Shared detection worker pool serving several camera streams
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef INFERENCE_POOL_H
+#define INFERENCE_POOL_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "YoloDetector.h"
+#include "CropClassifier.h"
+#include "FrameQueue.h"
+#include "FrameContext.h"
+
+/**
+ * @class InferencePool
+ * @brief Pool of detection workers sharing one loaded YoloDetector
+ *
+ * Every camera gets its own bounded input queue. The cores are split into one
+ * disjoint slice per worker; each worker and the NCNN threads it spawns stay
+ * on that slice. Workers pick cameras in round-robin order, with at most one frame per camera in
+ * flight, so a busy camera cannot starve the others and per-camera results
+ * stay in capture order. Each worker creates its own ncnn::Extractor from the
+ * shared ncnn::Net, so the model weights are loaded only once. With a batch
+ * size above one a worker takes pending frames of several cameras at once and
+ * runs them through YoloDetector::detectBatch(); the crops the classifier
+ * selects from the whole batch then go through the second stage together
+ * before the results are delivered. Frames older than the
+ * configured maximum age are discarded unprocessed, since their result would
+ * arrive too late to be useful.
+ */
+class InferencePool {
+public:
+    /**
+     * @brief Callback invoked on a worker thread after every completed detection
+     */
+    using ResultCallback = std::function<void(int camera, const FrameContext& frame, const std::vector<Object>& objects)>;
+
+    /**
+     * @brief Constructor
+     * @param detector Loaded detector instance (must outlive this object)
+     * @param classifier Second stage run on the detections (must outlive this object; idle if not loaded)
+     */
+    InferencePool(YoloDetector& detector, CropClassifier& classifier);
+
+    /**
+     * @brief Destructor
+     */
+    ~InferencePool();
+
+    /**
+     * @brief Create the per-camera queues and start the workers
+     * @param camera_count Number of cameras submitting frames
+     * @param worker_count Number of worker threads (0 = one per core, capped at camera count; never more than the cores)
+     * @param cores Cores shared out between the workers in equal slices (empty = all cores)
+     * @param prob_threshold Minimum confidence threshold for detections
+     * @param nms_threshold Non-maximum suppression threshold
+     * @param queue_size Number of frames per camera that may wait for a worker
+     * @param policy Overflow policy of the per-camera queues
+     * @param batch_size Maximum number of cameras a worker detects in one batch
+     * @param threads_per_worker NCNN threads per detection (0 = size of the worker's core slice)
+     * @return true if started successfully, false otherwise
+     */
+    bool start(int camera_count, int worker_count, const std::vector<int>& cores,
+               float prob_threshold, float nms_threshold, size_t queue_size = 2,
+               OverflowPolicy policy = OverflowPolicy::DropOldest, int batch_size = 1,
+               int threads_per_worker = 0);
+
+    /**
+     * @brief Stop all workers
+     */
+    void stop();
+
+    /**
+     * @brief Check if the pool is running
+     * @return true if running, false otherwise
+     */
+    bool isRunning() const { return running_; }
+
+    /**
+     * @brief Set the callback invoked with every detection result
+     * @param callback Result callback (called on worker threads)
+     */
+    void setResultCallback(ResultCallback callback) { result_callback_ = std::move(callback); }
+
+    /**
+     * @brief Set the age beyond which queued frames are discarded instead of detected
+     * @param max_age_ms Maximum frame age in milliseconds (0 = never discard)
+     */
+    void setMaxFrameAge(int max_age_ms) { max_frame_age_ms_ = max_age_ms; }
+
+    /**
+     * @brief Queue a frame for detection without waiting for the result
+     * @param camera Camera index
+     * @param frame Frame to analyse (pixel data is shared, not copied)
+     * @return true if the frame was queued, false if stopped or camera out of range
+     */
+    bool submit(int camera, const FrameContext& frame);
+
+    /**
+     * @brief Copy the most recent detections of a camera
+     * @param camera Camera index
+     * @param objects Output vector receiving the latest detections
+     * @return Number of detection results produced for this camera so far
+     */
+    int getLatest(int camera, std::vector<Object>& objects) const;
+
+    /**
+     * @brief Get number of frames processed for a camera
+     * @param camera Camera index
+     * @return Processed frame count
+     */
+    int getProcessedCount(int camera) const;
+
+    /**
+     * @brief Get number of submitted frames evicted or discarded as stale before inference
+     * @param camera Camera index
+     * @return Dropped frame count
+     */
+    int getDroppedCount(int camera) const;
+
+    /**
+     * @brief Get number of frames waiting for a worker
+     * @param camera Camera index
+     * @return Queued frame count
+     */
+    int getQueueDepth(int camera) const;
+
+    /**
+     * @brief Get number of worker threads
+     * @return Worker count
+     */
+    int getWorkerCount() const { return (int)workers_.size(); }
+
+private:
+    struct CameraSlot {
+        std::unique_ptr<FrameQueue<FrameContext>> queue;
+        std::atomic<bool> in_flight;
+        std::atomic<int> processed_count;
+        std::atomic<int> stale_count;
+        std::vector<Object> latest_objects;
+        mutable std::mutex latest_mutex;
+
+        CameraSlot() : in_flight(false), processed_count(0), stale_count(0) {}
+    };
+
+    YoloDetector& detector_;
+    CropClassifier& classifier_;
+    float prob_threshold_;
+    float nms_threshold_;
+    int batch_size_;
+    std::atomic<int> max_frame_age_ms_;
+
+    std::atomic<bool> running_;
+    std::vector<std::unique_ptr<CameraSlot>> cameras_;
+    std::vector<std::thread> workers_;
+    std::atomic<unsigned> next_camera_;   ///< Round-robin scheduling cursor
+    ResultCallback result_callback_;
+
+    // Idle workers sleep here until a frame is submitted
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    unsigned wake_generation_;            ///< Bumped on every submit, guarded by wake_mutex_
+
+    void workerLoop(int worker_index, std::vector<int> cores, int num_threads);
+    void acquireCameras(std::vector<int>& cameras, std::vector<FrameContext>& frames);
+};
+
+#endif // INFERENCE_POOL_H
@@ -7,59 +7,49 @@
 
 #include "MetadataPublisher.h"
 #include "YoloDetector.h"
+#include "ThreadUtils.h"
+#include "PipelineMetrics.h"
 #include <iostream>
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
 #include <curl/curl.h>
 
-/**
- * @brief COCO dataset class names for object classification
- */
-const char* MetadataPublisher::class_names_[] = {
-    "background", "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat", 
-    "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat", "dog", "horse", "sheep", 
-    "cow", "elephant", "bear", "zebra", "giraffe", "backpack", "umbrella", "handbag", "tie", "suitcase", 
-    "frisbee", "skis", "snowboard", "sports ball", "kite", "baseball bat", "baseball glove", "skateboard", "surfboard",
-    "tennis racket", "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
-    "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair", "couch",
-    "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse", "remote", "keyboard", "cell phone",
-    "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase", "scissors", "teddy bear",
-    "hair drier", "toothbrush"
-};
-
-/**
- * @brief Callback function for libcurl to handle HTTP response data
- * @param contents Pointer to received data
- * @param size Size of each data element
- * @param nmemb Number of data elements
- * @param userp User-defined pointer (string to store response)
- * @return Total number of bytes processed
- */
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
-    return size * nmemb;
-}
-
 MetadataPublisher::MetadataPublisher() 
-    : running_(false), initialized_(false), published_count_(0) {
+    : batch_size_(1), batch_window_ms_(0), queue_capacity_(100),
+      running_(false), initialized_(false), published_count_(0),
+      enqueued_count_(0), dropped_count_(0), failed_count_(0),
+      dictionary_sent_(false) {
 }
 
 MetadataPublisher::~MetadataPublisher() {
     stop();
 }
 
-bool MetadataPublisher::initialize(const std::string& host, int port, const std::string& endpoint, int publish_interval_ms) {
-    host_ = host;
-    port_ = port;
-    endpoint_ = endpoint;
-    publish_interval_ms_ = publish_interval_ms;
+bool MetadataPublisher::initialize(const MetadataTransportSettings& transport, int batch_size,
+                                   int batch_window_ms, int queue_capacity, const std::string& format) {
+    transport_settings_ = transport;
+    batch_size_ = std::max(1, batch_size);
+    batch_window_ms_ = std::max(0, batch_window_ms);
+    {
+        // The cameras keep queueing while a reload rebuilds a stopped publisher
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_capacity_ = (size_t)std::max(1, queue_capacity);
+    }
+    serializer_ = MetadataSerializer::create(format);
+    transport_ = MetadataTransport::create(transport_settings_, serializer_->getContentType());
+    dictionary_sent_ = false;
     
     // Initialize libcurl
     curl_global_init(CURL_GLOBAL_DEFAULT);
     
     initialized_ = true;
-    std::cout << "Metadata Publisher initialized: " << host_ << ":" << port_ << endpoint_ << std::endl;
-    std::cout << "Publish interval: " << publish_interval_ms_ << "ms" << std::endl;
+    std::cout << "Metadata Publisher initialized: " << transport_->getName()
+              << " (" << serializer_->getName() << ")" << std::endl;
+    std::cout << "Metadata queue capacity " << queue_capacity_;
+    if (batch_size_ > 1) {
+        std::cout << ", batches of up to " << batch_size_ << " records";
+        if (batch_window_ms_ > 0) std::cout << " within " << batch_window_ms_ << "ms";
+    }
+    std::cout << std::endl;
     
     return true;
 }
@@ -85,7 +75,11 @@ bool MetadataPublisher::start() {
 void MetadataPublisher::stop() {
     if (!running_) return;
     
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+        queue_cv_.notify_all();
+    }
     
     if (publisher_thread_.joinable()) {
         publisher_thread_.join();
@@ -97,23 +91,33 @@ void MetadataPublisher::stop() {
     std::cout << "Metadata Publisher stopped" << std::endl;
 }
 
-void MetadataPublisher::publishDetections(const std::vector<Object>& objects, int frame_width, int frame_height, const std::string& camera_id) {
-    if (!running_) return;
+bool MetadataPublisher::publishDetections(const std::vector<Object>& objects, const FrameContext& frame, const std::string& camera_id,
+                                          const std::vector<TrackEvent>& events) {
+    if (!running_) return false;
     
     DetectionMetadata metadata;
-    metadata.timestamp = std::chrono::system_clock::now();
+    metadata.timestamp = frame.wall_time;
     metadata.objects = objects;
-    metadata.frame_width = frame_width;
-    metadata.frame_height = frame_height;
+    metadata.frame_width = frame.image.cols;
+    metadata.frame_height = frame.image.rows;
     metadata.camera_id = camera_id;
+    metadata.frame_sequence = frame.sequence;
+    metadata.events = events;
     
     std::lock_guard<std::mutex> lock(queue_mutex_);
-    metadata_queue_.push(metadata);
     
-    // Limit queue size to prevent memory issues
-    if (metadata_queue_.size() > 100) {
-        metadata_queue_.pop();
+    // Reject rather than evict: queued records are older and already paid for
+    if (metadata_queue_.size() >= queue_capacity_) {
+        if (dropped_count_++ == 0) {
+            std::cerr << "Metadata queue full, rejecting new records" << std::endl;
+        }
+        return false;
     }
+    
+    metadata_queue_.push(std::move(metadata));
+    enqueued_count_++;
+    queue_cv_.notify_one();
+    return true;
 }
 
 std::string MetadataPublisher::createJsonMetadata(const std::vector<Object>& objects, int frame_width, int frame_height, const std::string& camera_id) {
@@ -124,7 +128,9 @@ std::string MetadataPublisher::createJsonMetadata(const std::vector<Object>& obj
     metadata.frame_height = frame_height;
     metadata.camera_id = camera_id;
     
-    return createJsonMetadata(metadata);
+    std::string json;
+    MetadataSerializer::create("json")->writeRecord(metadata, json);
+    return json;
 }
 
 int MetadataPublisher::getQueueSize() const {
@@ -132,136 +138,88 @@ int MetadataPublisher::getQueueSize() const {
     return metadata_queue_.size();
 }
 
+bool MetadataPublisher::isBackpressured() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return metadata_queue_.size() >= queue_capacity_;
+}
+
 void MetadataPublisher::publishingLoop() {
-    while (running_) {
-        DetectionMetadata metadata;
-        bool has_metadata = false;
-        
-        // Get metadata from queue
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex_);
-            if (!metadata_queue_.empty()) {
-                metadata = metadata_queue_.front();
-                metadata_queue_.pop();
-                has_metadata = true;
-            }
+    setCurrentThreadName("metadata");
+
+    ensureConnected();
+
+    // No pacing here: the cameras already limit their rate, so send whatever is pending
+    std::vector<DetectionMetadata> batch;
+    while (collectBatch(batch)) {
+        // Receivers of id-only formats need the names before the first record
+        if (serializer_->needsClassDictionary() && !dictionary_sent_) {
+            serializer_->writeClassDictionary(payload_);
+            dictionary_sent_ = sendMessage(payload_);
         }
         
-        if (has_metadata) {
-            // Create JSON and send
-            std::string json_data = createJsonMetadata(metadata);
-            
-            // For debugging, print to console instead of HTTP POST
-            // metadata 출력하는 코드인데 일단 로그 확인하려고 주석처리함
-            //std::cout << "=== Metadata JSON ===" << std::endl;
-            //std::cout << json_data << std::endl;
-            //std::cout << "===================" << std::endl;
-            
-            // Attempt HTTP POST (will fail if no server, but that's OK for demo)
-            if (sendHttpPost(json_data)) {
-                published_count_++;
-            }
+        // Encode and send
+        if (batch_size_ > 1) {
+            serializer_->writeBatch(batch, payload_);
+        } else {
+            serializer_->writeRecord(batch.front(), payload_);
         }
         
-        std::this_thread::sleep_for(std::chrono::milliseconds(publish_interval_ms_));
-    }
-}
-
-std::string MetadataPublisher::createJsonMetadata(const DetectionMetadata& metadata) {
-    std::stringstream json;
-    
-    json << "{\n";
-    json << "  \"timestamp\": \"" << formatTimestamp(metadata.timestamp) << "\",\n";
-    json << "  \"camera_id\": \"" << metadata.camera_id << "\",\n";
-    json << "  \"frame_width\": " << metadata.frame_width << ",\n";
-    json << "  \"frame_height\": " << metadata.frame_height << ",\n";
-    json << "  \"detections\": [\n";
-    
-    for (size_t i = 0; i < metadata.objects.size(); i++) {
-        const Object& obj = metadata.objects[i];
-        
-        json << "    {\n";
-        json << "      \"class_id\": " << obj.label << ",\n";
-        json << "      \"class_name\": \"" << getClassNameForLabel(obj.label) << "\",\n";
-        json << "      \"confidence\": " << std::fixed << std::setprecision(4) << obj.prob << ",\n";
-        json << "      \"bbox\": {\n";
-        json << "        \"x\": " << std::fixed << std::setprecision(2) << obj.rect.x << ",\n";
-        json << "        \"y\": " << std::fixed << std::setprecision(2) << obj.rect.y << ",\n";
-        json << "        \"width\": " << std::fixed << std::setprecision(2) << obj.rect.width << ",\n";
-        json << "        \"height\": " << std::fixed << std::setprecision(2) << obj.rect.height << "\n";
-        json << "      }\n";
-        json << "    }";
+        // For debugging, print to console instead of HTTP POST
+        // metadata 출력하는 코드인데 일단 로그 확인하려고 주석처리함
+        //std::cout << "=== Metadata JSON ===" << std::endl;
+        //std::cout << payload_ << std::endl;
+        //std::cout << "===================" << std::endl;
         
-        if (i < metadata.objects.size() - 1) {
-            json << ",";
+        // Attempt to send (will fail if no server, but that's OK for demo)
+        if (sendMessage(payload_)) {
+            published_count_ += (int)batch.size();
+        } else {
+            failed_count_ += (int)batch.size();
+            dictionary_sent_ = false;
         }
-        json << "\n";
     }
-    
-    json << "  ],\n";
-    json << "  \"detection_count\": " << metadata.objects.size() << "\n";
-    json << "}";
-    
-    return json.str();
+
+    transport_->close();
 }
 
-bool MetadataPublisher::sendHttpPost(const std::string& json_data) {
-    CURL *curl;
-    CURLcode res;
-    std::string response_data;
-    bool success = false;
+bool MetadataPublisher::collectBatch(std::vector<DetectionMetadata>& batch) {
+    batch.clear();
     
-    curl = curl_easy_init();
-    if (curl) {
-        std::string url = "http://" + host_ + ":" + std::to_string(port_) + endpoint_;
-        
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_data.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L); // 5 second timeout
-        
-        // Set content type header
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        
-        res = curl_easy_perform(curl);
-        
-        if (res == CURLE_OK) {
-            long response_code;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-            if (response_code == 200) {
-                success = true;
-            } else {
-                std::cout << "HTTP POST failed with response code: " << response_code << std::endl;
-            }
-        } else {
-            // Don't spam error messages - server might not be running
-            // std::cerr << "HTTP POST failed: " << curl_easy_strerror(res) << std::endl;
-        }
-        
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_cv_.wait(lock, [this] { return !metadata_queue_.empty() || !running_; });
+    
+    // On stop, keep sending until the queue is drained so accepted records are not lost
+    if (metadata_queue_.empty()) return false;
+    
+    // The window starts with the first record of the batch
+    if (running_ && batch_window_ms_ > 0 && (int)metadata_queue_.size() < batch_size_) {
+        queue_cv_.wait_for(lock, std::chrono::milliseconds(batch_window_ms_), [this] {
+            return (int)metadata_queue_.size() >= batch_size_ || !running_;
+        });
     }
     
-    return success;
+    while (!metadata_queue_.empty() && (int)batch.size() < batch_size_) {
+        batch.push_back(std::move(metadata_queue_.front()));
+        metadata_queue_.pop();
+    }
+    return true;
 }
 
-std::string MetadataPublisher::formatTimestamp(const std::chrono::system_clock::time_point& timestamp) {
-    auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()) % 1000;
+bool MetadataPublisher::ensureConnected() {
+    if (transport_->isConnected()) return true;
+    
+    // Don't hammer an unreachable server: one attempt per second at most
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_connect_attempt_ < std::chrono::seconds(1)) return false;
+    last_connect_attempt_ = now;
     
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << ms.count() << "Z";
+    if (!transport_->connect()) return false;
     
-    return ss.str();
+    std::cout << "Metadata connected: " << transport_->getName() << std::endl;
+    return true;
 }
 
-std::string MetadataPublisher::getClassNameForLabel(int label) {
-    if (label >= 0 && label < 80) {
-        return std::string(class_names_[label]);
-    }
-    return "unknown";
-}
\ No newline at end of file
+bool MetadataPublisher::sendMessage(const std::string& data) {
+    ScopedStageTimer timer(PipelineStage::Publish);
+    return ensureConnected() && transport_->send(data, serializer_->isBinary());
+}
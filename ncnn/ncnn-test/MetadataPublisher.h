@@ -13,31 +13,35 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <queue>
 #include <chrono>
+#include <memory>
 #include <opencv2/opencv.hpp>
 
-// Forward declaration for Object struct
-struct Object;
-
-/**
- * @struct DetectionMetadata
- * @brief Container for detection metadata with timestamp and camera info
- */
-struct DetectionMetadata {
-    std::chrono::system_clock::time_point timestamp; ///< Detection timestamp
-    std::vector<Object> objects;                     ///< Detected objects list
-    int frame_width;                                 ///< Frame width in pixels
-    int frame_height;                                ///< Frame height in pixels
-    std::string camera_id;                           ///< Camera identifier
-};
+#include "MetadataSerializer.h"
+#include "FrameContext.h"
+#include "ObjectTracker.h"
+#include "MetadataTransport.h"
 
 /**
  * @class MetadataPublisher
- * @brief Publishes detection metadata in JSON format via HTTP POST
+ * @brief Publishes detection metadata over HTTP, WebSocket, MQTT or UDP
  * 
- * This class manages a background thread that periodically sends detection
- * results as JSON metadata to a configured HTTP endpoint.
+ * This class manages a background thread that sends detection results to a
+ * configured MetadataTransport. The transport keeps its connection open for
+ * the whole lifetime of the thread (reconnecting at most once per second after
+ * a failure), and several records can be gathered into one array per message.
+ *
+ * The thread sleeps on a condition variable and drains everything pending on
+ * each wake-up, so it sends as fast as records arrive and the connection
+ * allows. When the bounded queue is full, new records are rejected (and
+ * counted) instead of silently evicting queued ones, and publishDetections()
+ * reports the rejection so the producer can retry with a later result.
+ *
+ * Records are encoded by a MetadataSerializer into one reused buffer. Formats
+ * that send class ids only send the class dictionary first, and again after
+ * any failed send in case the receiver restarted.
  */
 class MetadataPublisher {
 public:
@@ -53,13 +57,17 @@ public:
     
     /**
      * @brief Initialize metadata publisher with network settings
-     * @param host Target HTTP server hostname
-     * @param port Target HTTP server port
-     * @param endpoint HTTP endpoint path for metadata
-     * @param publish_interval_ms Publishing interval in milliseconds
+     * @param transport Transport type and destination
+     * @param batch_size Maximum records per message (1 = one record per message, otherwise an array)
+     * @param batch_window_ms Time to keep gathering records after the first one of a batch (0 = send what is queued)
+     * @param queue_capacity Maximum number of records waiting to be sent
+     * @param format Wire format: "json", "compact_json" or "cbor"
      * @return true if initialization successful, false otherwise
+     *
+     * May be called again after stop() to switch transport or format.
      */
-    bool initialize(const std::string& host, int port, const std::string& endpoint, int publish_interval_ms);
+    bool initialize(const MetadataTransportSettings& transport, int batch_size = 1,
+                    int batch_window_ms = 0, int queue_capacity = 100, const std::string& format = "json");
     
     /**
      * @brief Start the metadata publishing thread
@@ -69,6 +77,8 @@ public:
     
     /**
      * @brief Stop the metadata publishing thread
+     *
+     * Records still queued are sent (or counted as failed) before the thread exits.
      */
     void stop();
     
@@ -81,11 +91,13 @@ public:
     /**
      * @brief Add detection data to publishing queue
      * @param objects Vector of detected objects
-     * @param frame_width Frame width in pixels
-     * @param frame_height Frame height in pixels
+     * @param frame Analysed frame; its size, capture time and sequence number go into the record
      * @param camera_id Camera identifier string
+     * @param events Track enter/exit events to send with the record
+     * @return true if queued, false if stopped or the queue is full (backpressure)
      */
-    void publishDetections(const std::vector<Object>& objects, int frame_width, int frame_height, const std::string& camera_id = "camera_0");
+    bool publishDetections(const std::vector<Object>& objects, const FrameContext& frame, const std::string& camera_id = "camera_0",
+                           const std::vector<TrackEvent>& events = std::vector<TrackEvent>());
     
     /**
      * @brief Create JSON metadata string from detection objects
@@ -103,37 +115,52 @@ public:
      */
     int getQueueSize() const;
     
+    /**
+     * @brief Check if the queue is full and new records are being rejected
+     * @return true while the publisher cannot keep up
+     */
+    bool isBackpressured() const;
+    
     /**
      * @brief Get total published count
      * @return Number of successfully published metadata items
      */
     int getPublishedCount() const { return published_count_; }
+    
+    int getEnqueuedCount() const { return enqueued_count_; }  ///< Records accepted into the queue
+    int getDroppedCount() const { return dropped_count_; }    ///< Records rejected because the queue was full
+    int getFailedCount() const { return failed_count_; }      ///< Records that could not be sent
 
 private:
-    std::string host_;
-    int port_;
-    std::string endpoint_;
-    int publish_interval_ms_;
+    MetadataTransportSettings transport_settings_;
+    int batch_size_;
+    int batch_window_ms_;
+    size_t queue_capacity_;
     
     std::atomic<bool> running_;
     std::atomic<bool> initialized_;
     std::atomic<int> published_count_;
+    std::atomic<int> enqueued_count_;
+    std::atomic<int> dropped_count_;
+    std::atomic<int> failed_count_;
     
     std::thread publisher_thread_;
     std::queue<DetectionMetadata> metadata_queue_;
     mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;   ///< Signalled on every enqueue and on stop
+    
+    // Connection and encoding, owned by the publisher thread
+    std::unique_ptr<MetadataTransport> transport_;
+    std::unique_ptr<MetadataSerializer> serializer_;
+    std::string payload_;                ///< Reused output buffer of the serializer
+    bool dictionary_sent_;
+    std::chrono::steady_clock::time_point last_connect_attempt_;
     
     // Publishing methods
     void publishingLoop();
-    std::string createJsonMetadata(const DetectionMetadata& metadata);
-    bool sendHttpPost(const std::string& json_data);
-    
-    // Utility methods
-    std::string formatTimestamp(const std::chrono::system_clock::time_point& timestamp);
-    std::string getClassNameForLabel(int label);
-    
-    // Class names (same as in main.cpp)
-    static const char* class_names_[];
+    bool collectBatch(std::vector<DetectionMetadata>& batch);
+    bool ensureConnected();
+    bool sendMessage(const std::string& data);
 };
 
 #endif // METADATA_PUBLISHER_H
\ No newline at end of file
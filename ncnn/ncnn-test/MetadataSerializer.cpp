@@ -0,0 +1,489 @@
+/**
+ * @file MetadataSerializer.cpp
+ * @brief JSON, compact JSON and CBOR encoders for detection metadata
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "MetadataSerializer.h"
+#include "YoloDetector.h"
+#include "ObjectTracker.h"
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Text helpers (no streams, no locale, no temporary strings)
+// ---------------------------------------------------------------------------
+
+void appendUnsigned(std::string& out, unsigned long long value, int min_digits = 1) {
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0 || n < min_digits);
+
+    while (n > 0) {
+        out += digits[--n];
+    }
+}
+
+void appendInt(std::string& out, long long value) {
+    if (value < 0) {
+        out += '-';
+        appendUnsigned(out, (unsigned long long)(-value));
+    } else {
+        appendUnsigned(out, (unsigned long long)value);
+    }
+}
+
+/// Same digits as std::fixed << std::setprecision(decimals), up to 4 decimals
+void appendFixed(std::string& out, float value, int decimals) {
+    static const long long scales[] = {1, 10, 100, 1000, 10000};
+    if (!std::isfinite(value)) {
+        out += '0';  // JSON has no NaN/Inf
+        return;
+    }
+
+    const long long scale = scales[decimals];
+    long long scaled = std::llround((double)value * scale);
+    if (scaled < 0) {
+        out += '-';
+        scaled = -scaled;
+    }
+
+    appendUnsigned(out, (unsigned long long)(scaled / scale));
+    if (decimals > 0) {
+        out += '.';
+        appendUnsigned(out, (unsigned long long)(scaled % scale), decimals);
+    }
+}
+
+const char* getEventName(const TrackEvent& event) {
+    return event.type == TrackEvent::Enter ? "enter" : "exit";
+}
+
+long long toEpochMillis(const std::chrono::system_clock::time_point& timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+/// ISO 8601 UTC with milliseconds, e.g. 2025-10-14T08:30:00.123Z
+void appendIsoTimestamp(std::string& out, const std::chrono::system_clock::time_point& timestamp) {
+    const long long ms = toEpochMillis(timestamp);
+    std::time_t seconds = (std::time_t)(ms / 1000);
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+
+    appendUnsigned(out, utc.tm_year + 1900, 4);
+    out += '-';
+    appendUnsigned(out, utc.tm_mon + 1, 2);
+    out += '-';
+    appendUnsigned(out, utc.tm_mday, 2);
+    out += 'T';
+    appendUnsigned(out, utc.tm_hour, 2);
+    out += ':';
+    appendUnsigned(out, utc.tm_min, 2);
+    out += ':';
+    appendUnsigned(out, utc.tm_sec, 2);
+    out += '.';
+    appendUnsigned(out, ms % 1000, 3);
+    out += 'Z';
+}
+
+// ---------------------------------------------------------------------------
+// "json": the original pretty-printed format
+// ---------------------------------------------------------------------------
+
+class JsonSerializer : public MetadataSerializer {
+public:
+    void writeRecord(const DetectionMetadata& metadata, std::string& out) override {
+        out.clear();
+        appendRecord(metadata, out);
+    }
+
+    void writeBatch(const std::vector<DetectionMetadata>& batch, std::string& out) override {
+        out.clear();
+        out += "[\n";
+        for (size_t i = 0; i < batch.size(); i++) {
+            appendRecord(batch[i], out);
+            out += (i + 1 < batch.size()) ? ",\n" : "\n";
+        }
+        out += "]";
+    }
+
+    void writeClassDictionary(std::string& out) override {
+        out.clear();
+    }
+
+    bool needsClassDictionary() const override { return false; }
+    const char* getContentType() const override { return "application/json"; }
+    const char* getName() const override { return "json"; }
+
+private:
+    static void appendRecord(const DetectionMetadata& metadata, std::string& out) {
+        out += "{\n";
+        out += "  \"timestamp\": \"";
+        appendIsoTimestamp(out, metadata.timestamp);
+        out += "\",\n";
+        out += "  \"camera_id\": ";
+        appendJsonString(out, metadata.camera_id.c_str());
+        out += ",\n";
+        out += "  \"frame_sequence\": ";
+        appendUnsigned(out, metadata.frame_sequence);
+        out += ",\n";
+        out += "  \"frame_width\": ";
+        appendInt(out, metadata.frame_width);
+        out += ",\n";
+        out += "  \"frame_height\": ";
+        appendInt(out, metadata.frame_height);
+        out += ",\n";
+        out += "  \"detections\": [\n";
+
+        for (size_t i = 0; i < metadata.objects.size(); i++) {
+            const Object& obj = metadata.objects[i];
+
+            out += "    {\n";
+            appendObject(obj, out);
+            out += "    }";
+            out += (i + 1 < metadata.objects.size()) ? ",\n" : "\n";
+        }
+
+        out += "  ],\n";
+
+        if (!metadata.events.empty()) {
+            out += "  \"events\": [\n";
+            for (size_t i = 0; i < metadata.events.size(); i++) {
+                out += "    {\n";
+                out += "      \"type\": \"";
+                out += getEventName(metadata.events[i]);
+                out += "\",\n";
+                appendObject(metadata.events[i].object, out);
+                out += "    }";
+                out += (i + 1 < metadata.events.size()) ? ",\n" : "\n";
+            }
+            out += "  ],\n";
+        }
+        out += "  \"detection_count\": ";
+        appendUnsigned(out, metadata.objects.size());
+        out += "\n";
+        out += "}";
+    }
+
+    static void appendObject(const Object& obj, std::string& out) {
+        if (obj.track_id >= 0) {
+            out += "      \"track_id\": ";
+            appendInt(out, obj.track_id);
+            out += ",\n";
+        }
+        out += "      \"class_id\": ";
+        appendInt(out, obj.label);
+        out += ",\n";
+        out += "      \"class_name\": ";
+        appendJsonString(out, YoloDetector::getClassName(obj.label));
+        out += ",\n";
+        out += "      \"confidence\": ";
+        appendFixed(out, obj.prob, 4);
+        out += ",\n";
+        if (obj.attribute) {
+            out += "      \"attribute\": ";
+            appendJsonString(out, obj.attribute);
+            out += ",\n";
+            out += "      \"attribute_confidence\": ";
+            appendFixed(out, obj.attribute_prob, 4);
+            out += ",\n";
+        }
+        out += "      \"bbox\": {\n";
+        out += "        \"x\": ";
+        appendFixed(out, obj.rect.x, 2);
+        out += ",\n";
+        out += "        \"y\": ";
+        appendFixed(out, obj.rect.y, 2);
+        out += ",\n";
+        out += "        \"width\": ";
+        appendFixed(out, obj.rect.width, 2);
+        out += ",\n";
+        out += "        \"height\": ";
+        appendFixed(out, obj.rect.height, 2);
+        out += "\n";
+        out += "      }\n";
+    }
+};
+
+// ---------------------------------------------------------------------------
+// "compact_json": no whitespace, class ids only
+// ---------------------------------------------------------------------------
+
+class CompactJsonSerializer : public MetadataSerializer {
+public:
+    void writeRecord(const DetectionMetadata& metadata, std::string& out) override {
+        out.clear();
+        appendRecord(metadata, out);
+    }
+
+    void writeBatch(const std::vector<DetectionMetadata>& batch, std::string& out) override {
+        out.clear();
+        out += '[';
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (i > 0) out += ',';
+            appendRecord(batch[i], out);
+        }
+        out += ']';
+    }
+
+    void writeClassDictionary(std::string& out) override {
+        out.clear();
+        out += "{\"type\":\"class_dictionary\",\"class_names\":[";
+        for (int label = 0; label < YoloDetector::getClassCount(); label++) {
+            if (label > 0) out += ',';
+            appendJsonString(out, YoloDetector::getClassName(label));
+        }
+        out += "]}";
+    }
+
+    const char* getContentType() const override { return "application/json"; }
+    const char* getName() const override { return "compact_json"; }
+
+private:
+    static void appendRecord(const DetectionMetadata& metadata, std::string& out) {
+        out += "{\"type\":\"detections\",\"timestamp_ms\":";
+        appendInt(out, toEpochMillis(metadata.timestamp));
+        out += ",\"camera_id\":";
+        appendJsonString(out, metadata.camera_id.c_str());
+        out += ",\"frame_sequence\":";
+        appendUnsigned(out, metadata.frame_sequence);
+        out += ",\"frame_width\":";
+        appendInt(out, metadata.frame_width);
+        out += ",\"frame_height\":";
+        appendInt(out, metadata.frame_height);
+        out += ",\"detections\":[";
+
+        for (size_t i = 0; i < metadata.objects.size(); i++) {
+            if (i > 0) out += ',';
+            out += '{';
+            appendObject(metadata.objects[i], out);
+            out += '}';
+        }
+        out += ']';
+
+        if (!metadata.events.empty()) {
+            out += ",\"events\":[";
+            for (size_t i = 0; i < metadata.events.size(); i++) {
+                if (i > 0) out += ',';
+                out += "{\"type\":\"";
+                out += getEventName(metadata.events[i]);
+                out += "\",";
+                appendObject(metadata.events[i].object, out);
+                out += '}';
+            }
+            out += ']';
+        }
+        out += '}';
+    }
+
+    static void appendObject(const Object& obj, std::string& out) {
+        if (obj.track_id >= 0) {
+            out += "\"track_id\":";
+            appendInt(out, obj.track_id);
+            out += ',';
+        }
+        out += "\"class_id\":";
+        appendInt(out, obj.label);
+        out += ",\"confidence\":";
+        appendFixed(out, obj.prob, 4);
+        if (obj.attribute) {
+            out += ",\"attribute\":";
+            appendJsonString(out, obj.attribute);
+            out += ",\"attribute_confidence\":";
+            appendFixed(out, obj.attribute_prob, 4);
+        }
+        out += ",\"bbox\":[";
+        appendFixed(out, obj.rect.x, 1);
+        out += ',';
+        appendFixed(out, obj.rect.y, 1);
+        out += ',';
+        appendFixed(out, obj.rect.width, 1);
+        out += ',';
+        appendFixed(out, obj.rect.height, 1);
+        out += ']';
+    }
+};
+
+// ---------------------------------------------------------------------------
+// "cbor": binary, same content as compact_json
+// ---------------------------------------------------------------------------
+
+class CborSerializer : public MetadataSerializer {
+public:
+    void writeRecord(const DetectionMetadata& metadata, std::string& out) override {
+        out.clear();
+        appendRecord(metadata, out);
+    }
+
+    void writeBatch(const std::vector<DetectionMetadata>& batch, std::string& out) override {
+        out.clear();
+        appendHead(out, kArray, batch.size());
+        for (const auto& metadata : batch) {
+            appendRecord(metadata, out);
+        }
+    }
+
+    void writeClassDictionary(std::string& out) override {
+        out.clear();
+        appendHead(out, kArray, 2);
+        appendHead(out, kUnsigned, kDictionaryMessage);
+        appendHead(out, kArray, YoloDetector::getClassCount());
+        for (int label = 0; label < YoloDetector::getClassCount(); label++) {
+            appendText(out, YoloDetector::getClassName(label));
+        }
+    }
+
+    bool isBinary() const override { return true; }
+    const char* getContentType() const override { return "application/cbor"; }
+    const char* getName() const override { return "cbor"; }
+
+private:
+    // CBOR major types
+    static const int kUnsigned = 0;
+    static const int kNegative = 1;
+    static const int kText = 3;
+    static const int kArray = 4;
+
+    static const int kDetectionMessage = 0;
+    static const int kDictionaryMessage = 1;
+
+    static void appendHead(std::string& out, int major, uint64_t value) {
+        const char type = (char)(major << 5);
+        if (value < 24) {
+            out += (char)(type | value);
+        } else if (value <= 0xff) {
+            out += (char)(type | 24);
+            out += (char)value;
+        } else if (value <= 0xffff) {
+            out += (char)(type | 25);
+            appendBigEndian(out, value, 2);
+        } else if (value <= 0xffffffffULL) {
+            out += (char)(type | 26);
+            appendBigEndian(out, value, 4);
+        } else {
+            out += (char)(type | 27);
+            appendBigEndian(out, value, 8);
+        }
+    }
+
+    static void appendBigEndian(std::string& out, uint64_t value, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) {
+            out += (char)((value >> (i * 8)) & 0xff);
+        }
+    }
+
+    static void appendInt(std::string& out, long long value) {
+        if (value < 0) {
+            appendHead(out, kNegative, (uint64_t)(-1 - value));
+        } else {
+            appendHead(out, kUnsigned, (uint64_t)value);
+        }
+    }
+
+    static void appendFloat(std::string& out, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        out += (char)0xfa;
+        appendBigEndian(out, bits, 4);
+    }
+
+    static void appendText(std::string& out, const char* text) {
+        const size_t length = std::strlen(text);
+        appendHead(out, kText, length);
+        out.append(text, length);
+    }
+
+    static void appendRecord(const DetectionMetadata& metadata, std::string& out) {
+        appendHead(out, kArray, metadata.events.empty() ? 7 : 8);
+        appendHead(out, kUnsigned, kDetectionMessage);
+        appendInt(out, toEpochMillis(metadata.timestamp));
+        appendText(out, metadata.camera_id.c_str());
+        appendHead(out, kUnsigned, metadata.frame_sequence);
+        appendInt(out, metadata.frame_width);
+        appendInt(out, metadata.frame_height);
+
+        appendHead(out, kArray, metadata.objects.size());
+        for (const Object& obj : metadata.objects) {
+            // Optional trailing fields: track id, then attribute and its confidence (track id -1 if untracked)
+            appendHead(out, kArray, obj.attribute ? 9 : (obj.track_id >= 0 ? 7 : 6));
+            appendInt(out, obj.label);
+            appendFloat(out, obj.prob);
+            appendFloat(out, obj.rect.x);
+            appendFloat(out, obj.rect.y);
+            appendFloat(out, obj.rect.width);
+            appendFloat(out, obj.rect.height);
+            if (obj.track_id >= 0 || obj.attribute) {
+                appendInt(out, obj.track_id);
+            }
+            if (obj.attribute) {
+                appendText(out, obj.attribute);
+                appendFloat(out, obj.attribute_prob);
+            }
+        }
+
+        if (!metadata.events.empty()) {
+            appendHead(out, kArray, metadata.events.size());
+            for (const TrackEvent& event : metadata.events) {
+                appendHead(out, kArray, 7);
+                appendHead(out, kUnsigned, event.type == TrackEvent::Enter ? 0 : 1);
+                appendInt(out, event.object.track_id);
+                appendInt(out, event.object.label);
+                appendFloat(out, event.object.rect.x);
+                appendFloat(out, event.object.rect.y);
+                appendFloat(out, event.object.rect.width);
+                appendFloat(out, event.object.rect.height);
+            }
+        }
+    }
+};
+
+} // namespace
+
+std::unique_ptr<MetadataSerializer> MetadataSerializer::create(const std::string& format) {
+    if (format == "compact_json") {
+        return std::make_unique<CompactJsonSerializer>();
+    }
+    if (format == "cbor") {
+        return std::make_unique<CborSerializer>();
+    }
+
+    if (format != "json") {
+        std::cerr << "Unknown metadata format '" << format << "', using json" << std::endl;
+    }
+    return std::make_unique<JsonSerializer>();
+}
+
+void MetadataSerializer::appendJsonString(std::string& out, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (const char* c = text; *c; c++) {
+        const unsigned char byte = (unsigned char)*c;
+        switch (byte) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (byte < 0x20) {
+                out += "\\u00";
+                out += hex[byte >> 4];
+                out += hex[byte & 0xf];
+            } else {
+                out += *c;
+            }
+        }
+    }
+    out += '"';
+}
@@ -0,0 +1,124 @@
+/**
+ * @file MetadataSerializer.h
+ * @brief Wire formats for detection metadata
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef METADATA_SERIALIZER_H
+#define METADATA_SERIALIZER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations for Object and TrackEvent structs
+struct Object;
+struct TrackEvent;
+
+/**
+ * @struct DetectionMetadata
+ * @brief Container for detection metadata with timestamp and camera info
+ */
+struct DetectionMetadata {
+    std::chrono::system_clock::time_point timestamp; ///< Capture time of the analysed frame
+    std::vector<Object> objects;                     ///< Detected objects list
+    int frame_width;                                 ///< Frame width in pixels
+    int frame_height;                                ///< Frame height in pixels
+    std::string camera_id;                           ///< Camera identifier
+    uint64_t frame_sequence = 0;                     ///< Capture sequence number of the analysed frame
+    std::vector<TrackEvent> events;                  ///< Tracks that started or ended (tracking only)
+};
+
+/**
+ * @class MetadataSerializer
+ * @brief Encodes detection records into a caller-owned, reused buffer
+ *
+ * Formats:
+ * - "json": the original pretty-printed JSON with ISO timestamps and class names
+ * - "compact_json": JSON without whitespace, epoch-millisecond timestamps and
+ *   class ids only; names are sent once in a class dictionary message
+ * - "cbor": the same content in CBOR (RFC 8949) arrays:
+ *   record = [0, timestamp_ms, camera_id, frame_sequence, frame_width, frame_height,
+ *             [object, ...](, events)],
+ *   object = [class_id, confidence, x, y, width, height(, track_id(, attribute, attribute_confidence))],
+ *   events = [[type (0 = enter, 1 = exit), track_id, class_id, x, y, width, height], ...],
+ *   dictionary = [1, [name_0, name_1, ...]] (floats are float32)
+ *
+ * Tracked objects carry their track id and records with track events carry
+ * them too. Objects whose crop was classified carry the attribute and its
+ * confidence after the track id, which is then -1 if the object is untracked.
+ * Objects that are neither tracked nor classified keep the six-value form.
+ *
+ * Every write method replaces the contents of @p out but keeps its capacity,
+ * so a buffer reused across calls stops allocating once it has grown.
+ */
+class MetadataSerializer {
+public:
+    virtual ~MetadataSerializer() {}
+
+    /**
+     * @brief Encode a single record
+     * @param metadata Record to encode
+     * @param out Output buffer
+     */
+    virtual void writeRecord(const DetectionMetadata& metadata, std::string& out) = 0;
+
+    /**
+     * @brief Encode several records as one array
+     * @param batch Records to encode
+     * @param out Output buffer
+     */
+    virtual void writeBatch(const std::vector<DetectionMetadata>& batch, std::string& out) = 0;
+
+    /**
+     * @brief Encode the class id to name dictionary
+     * @param out Output buffer
+     */
+    virtual void writeClassDictionary(std::string& out) = 0;
+
+    /**
+     * @brief Check if receivers need the class dictionary to decode records
+     * @return true if records carry class ids only
+     */
+    virtual bool needsClassDictionary() const { return true; }
+
+    /**
+     * @brief Check if the encoding is binary
+     * @return true for binary formats (sent as binary WebSocket frames)
+     */
+    virtual bool isBinary() const { return false; }
+
+    /**
+     * @brief Get the HTTP Content-Type of the encoded data
+     * @return MIME type, e.g. "application/json"
+     */
+    virtual const char* getContentType() const = 0;
+
+    /**
+     * @brief Get the format name
+     * @return Format name as used in the configuration
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * @brief Create a serializer
+     * @param format "json", "compact_json" or "cbor" (unknown values fall back to "json")
+     * @return New serializer
+     */
+    static std::unique_ptr<MetadataSerializer> create(const std::string& format);
+
+    /**
+     * @brief Append text as a quoted JSON string
+     *
+     * Quotes, backslashes and control characters are escaped (\\n, \\r, \\t, \\b,
+     * \\f, otherwise \\u00XX); other bytes, including UTF-8, are copied as-is.
+     * @param out Buffer to append to
+     * @param text Text to quote
+     */
+    static void appendJsonString(std::string& out, const char* text);
+};
+
+#endif // METADATA_SERIALIZER_H
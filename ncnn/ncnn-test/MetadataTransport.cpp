@@ -0,0 +1,96 @@
+/**
+ * @file MetadataTransport.cpp
+ * @brief Metadata transport factory and socket helpers
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "MetadataTransport.h"
+#include "HttpTransport.h"
+#include "WebSocketTransport.h"
+#include "MqttTransport.h"
+#include "UdpTransport.h"
+#include <iostream>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+std::unique_ptr<MetadataTransport> MetadataTransport::create(const MetadataTransportSettings& settings,
+                                                             const std::string& content_type) {
+    if (settings.type == "websocket") {
+        return std::make_unique<WebSocketTransport>(settings);
+    }
+    if (settings.type == "mqtt") {
+        return std::make_unique<MqttTransport>(settings);
+    }
+    if (settings.type == "udp") {
+        return std::make_unique<UdpTransport>(settings);
+    }
+
+    if (settings.type != "http") {
+        std::cerr << "Unknown metadata transport '" << settings.type << "', using http" << std::endl;
+    }
+    return std::make_unique<HttpTransport>(settings, content_type);
+}
+
+int MetadataTransport::openTcpSocket(const std::string& host, int port, int timeout_ms) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int fd = -1;
+    for (struct addrinfo* addr = result; addr; addr = addr->ai_next) {
+        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) continue;
+
+        // SO_SNDTIMEO also bounds a blocking connect() on Linux
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) break;
+
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool MetadataTransport::sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool MetadataTransport::recvAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = ::recv(fd, data, size, 0);
+        if (received <= 0) return false;
+        data += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file MetadataTransport.h
+ * @brief Network backends delivering encoded metadata messages
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef METADATA_TRANSPORT_H
+#define METADATA_TRANSPORT_H
+
+#include <memory>
+#include <string>
+
+/**
+ * @struct MetadataTransportSettings
+ * @brief Destination of the metadata messages
+ */
+struct MetadataTransportSettings {
+    std::string type = "http";           ///< "http", "websocket", "mqtt" or "udp"
+    std::string host = "localhost";      ///< Server, broker or multicast group address
+    int port = 8080;
+    std::string endpoint = "/metadata";  ///< HTTP/WebSocket path
+    std::string mqtt_topic = "detections";
+    int mqtt_qos = 0;                    ///< 0 = at most once, 1 = wait for PUBACK
+    int udp_ttl = 1;                     ///< Multicast TTL (hops)
+    int timeout_ms = 5000;               ///< Connect and send timeout
+};
+
+/**
+ * @class MetadataTransport
+ * @brief Delivers one encoded message at a time over a persistent connection
+ *
+ * Implementations: HttpTransport (keep-alive POST), WebSocketTransport,
+ * MqttTransport (QoS 0/1) and UdpTransport (fire-and-forget, multicast
+ * capable). All methods are called from the publisher thread only.
+ */
+class MetadataTransport {
+public:
+    virtual ~MetadataTransport() {}
+
+    /**
+     * @brief Open the connection (also used to reconnect after a failure)
+     * @return true if connected, false otherwise
+     */
+    virtual bool connect() = 0;
+
+    /**
+     * @brief Check if the connection is usable
+     * @return true if connected
+     */
+    virtual bool isConnected() const = 0;
+
+    /**
+     * @brief Send one message
+     * @param data Encoded message
+     * @param binary true for binary payloads (CBOR), false for text (JSON)
+     * @return true if delivered (or handed to the network for fire-and-forget transports)
+     */
+    virtual bool send(const std::string& data, bool binary) = 0;
+
+    /**
+     * @brief Close the connection
+     */
+    virtual void close() = 0;
+
+    /**
+     * @brief Get a printable description of the destination
+     * @return Destination URL, e.g. "mqtt://broker:1883/detections"
+     */
+    virtual std::string getName() const = 0;
+
+    /**
+     * @brief Create a transport
+     * @param settings Destination settings (unknown types fall back to "http")
+     * @param content_type MIME type of the messages (used by HTTP)
+     * @return New, not yet connected transport
+     */
+    static std::unique_ptr<MetadataTransport> create(const MetadataTransportSettings& settings,
+                                                     const std::string& content_type);
+
+protected:
+    /**
+     * @brief Open a blocking TCP connection with send/receive timeouts
+     * @return Socket descriptor, or -1 on failure
+     */
+    static int openTcpSocket(const std::string& host, int port, int timeout_ms);
+
+    /**
+     * @brief Write a whole buffer to a socket
+     * @return true if every byte was written
+     */
+    static bool sendAll(int fd, const char* data, size_t size);
+
+    /**
+     * @brief Read exactly size bytes from a socket
+     * @return true if every byte was read before the timeout
+     */
+    static bool recvAll(int fd, char* data, size_t size);
+};
+
+#endif // METADATA_TRANSPORT_H
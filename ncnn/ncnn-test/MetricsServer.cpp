@@ -0,0 +1,126 @@
+/**
+ * @file MetricsServer.cpp
+ * @brief Implementation of the /metrics HTTP server
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "MetricsServer.h"
+#include "ThreadUtils.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+MetricsServer::MetricsServer() : listen_fd_(-1), port_(0), running_(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(int port, RenderFunction render) {
+    if (running_) return true;
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Failed to create metrics socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+
+    if (bind(listen_fd_, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd_, 8) != 0) {
+        std::cerr << "Failed to listen for metrics on port " << port << ": " << std::strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    port_ = port;
+    render_ = std::move(render);
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::serveLoop, this);
+
+    std::cout << "Metrics endpoint: http://0.0.0.0:" << port_ << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void MetricsServer::serveLoop() {
+    setCurrentThreadName("metrics");
+
+    while (running_) {
+        // Wake up regularly to notice stop()
+        struct pollfd listener = {listen_fd_, POLLIN, 0};
+        if (poll(&listener, 1, 200) <= 0) continue;
+
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        handleConnection(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsServer::handleConnection(int fd) {
+    // A stuck client must not block the next scrape for long
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters; read until the end of the headers
+    char buffer[2048];
+    size_t length = 0;
+    while (length < sizeof(buffer) - 1) {
+        ssize_t received = recv(fd, buffer + length, sizeof(buffer) - 1 - length, 0);
+        if (received <= 0) break;
+        length += (size_t)received;
+        buffer[length] = '\0';
+        if (std::strstr(buffer, "\r\n\r\n")) break;
+    }
+    buffer[length] = '\0';
+
+    const bool found = std::strncmp(buffer, "GET /metrics ", 13) == 0 || std::strncmp(buffer, "GET /metrics?", 13) == 0;
+
+    page_.clear();
+    if (found && render_) {
+        render_(page_);
+    }
+
+    std::string response = found ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                 : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n";
+    if (!found) page_ = "Not found, try /metrics\n";
+    response += "Content-Length: " + std::to_string(page_.size()) + "\r\nConnection: close\r\n\r\n";
+
+    send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+    size_t sent = 0;
+    while (sent < page_.size()) {
+        ssize_t n = send(fd, page_.data() + sent, page_.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += (size_t)n;
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file MetricsServer.h
+ * @brief Minimal HTTP server exposing a Prometheus /metrics page
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * @class MetricsServer
+ * @brief Serves GET /metrics from one background thread
+ *
+ * Requests are handled one at a time and every connection is closed after
+ * the response, which is all a Prometheus scraper needs. The page is rendered
+ * on demand by a caller-supplied function, so nothing is computed between
+ * scrapes.
+ */
+class MetricsServer {
+public:
+    /**
+     * @brief Renders the metrics page into the given (cleared) string
+     */
+    using RenderFunction = std::function<void(std::string& out)>;
+
+    MetricsServer();
+    ~MetricsServer();
+
+    /**
+     * @brief Bind the port and start serving
+     * @param port TCP port to listen on (all interfaces)
+     * @param render Page renderer, called on the server thread
+     * @return true if listening, false otherwise
+     */
+    bool start(int port, RenderFunction render);
+
+    /**
+     * @brief Stop serving and close the socket
+     */
+    void stop();
+
+    /**
+     * @brief Check if the server is running
+     * @return true if running, false otherwise
+     */
+    bool isRunning() const { return running_; }
+
+private:
+    int listen_fd_;
+    int port_;
+    RenderFunction render_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::string page_;  ///< Reused response body
+
+    void serveLoop();
+    void handleConnection(int fd);
+};
+
+#endif // METRICS_SERVER_H
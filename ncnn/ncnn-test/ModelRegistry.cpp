@@ -0,0 +1,160 @@
+/**
+ * @file ModelRegistry.cpp
+ * @brief Implementation of the shared NCNN network cache
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "ModelRegistry.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if NCNN_VULKAN
+#include <ncnn/gpu.h>
+#include <ncnn/pipelinecache.h>
+#endif
+
+namespace {
+
+/**
+ * @brief A network together with the memory its layers may reference
+ *
+ * NCNN references weights it does not convert straight from the mapping, so
+ * the layers are cleared before the mapping (and the pipeline cache) go away.
+ */
+struct LoadedNet
+{
+    ncnn::Net net;
+    void* weights_data = nullptr;
+    size_t weights_size = 0;
+#if NCNN_VULKAN
+    std::shared_ptr<ncnn::PipelineCache> pipeline_cache;
+#endif
+
+    ~LoadedNet()
+    {
+        net.clear();
+        if (weights_data)
+            munmap(weights_data, weights_size);
+    }
+};
+
+/**
+ * @brief Load the network weights through a memory mapping
+ * @param model Network to fill; receives the mapping
+ * @param path Path of the .bin file
+ * @return 0 on success, non-zero on failure
+ *
+ * The weights are paged in from the page cache instead of copied, and a
+ * restart with a warm cache reads nothing from disk. The mapping is private
+ * and writable in case a layer rewrites its weights in place. Reading the
+ * file normally is the fallback when it cannot be mapped.
+ */
+int loadWeights(LoadedNet& model, const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            madvise(data, (size_t)st.st_size, MADV_WILLNEED);
+            model.weights_data = data;
+            model.weights_size = (size_t)st.st_size;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+
+    if (!model.weights_data)
+        return model.net.load_model(path.c_str());
+
+    // Returns the number of bytes consumed, 0 on failure
+    return model.net.load_model((const unsigned char*)model.weights_data) > 0 ? 0 : -1;
+}
+
+} // namespace
+
+ModelRegistry::ModelRegistry()
+{
+}
+
+ModelRegistry::~ModelRegistry()
+{
+}
+
+std::shared_ptr<const ncnn::Net> ModelRegistry::acquire(const std::string& modelpath, bool use_gpu, ModelPrecision precision)
+{
+    const std::string key = modelpath + (use_gpu ? "@gpu:" : "@cpu:") + getPrecisionName(precision);
+
+    // Loading under the lock keeps two users of the same model from loading it twice
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = models_.find(key);
+    if (it != models_.end())
+        return it->second;
+
+    std::shared_ptr<const ncnn::Net> net = load(modelpath, use_gpu, precision);
+    if (net)
+        models_[key] = net;
+    return net;
+}
+
+int ModelRegistry::getModelCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (int)models_.size();
+}
+
+std::shared_ptr<const ncnn::Net> ModelRegistry::load(const std::string& modelpath, bool use_gpu, ModelPrecision precision)
+{
+    std::shared_ptr<LoadedNet> model = std::make_shared<LoadedNet>();
+    ncnn::Option& opt = model->net.opt;
+
+    opt.use_vulkan_compute = use_gpu;
+
+    // NCNN only uses the reduced-precision paths the CPU or GPU actually supports
+    const bool fp16 = precision == ModelPrecision::FP16;
+    opt.use_fp16_packed = fp16;
+    opt.use_fp16_storage = fp16;
+    opt.use_fp16_arithmetic = fp16;
+
+    const bool int8 = precision == ModelPrecision::INT8;
+    opt.use_int8_inference = int8;
+    opt.use_int8_storage = int8;
+    opt.use_int8_arithmetic = int8;
+    if (int8 && use_gpu)
+        fprintf(stderr, "INT8 layers have no Vulkan implementation and run on the CPU\n");
+
+    const std::string path = int8 ? modelpath + "-int8" : modelpath;
+
+#if NCNN_VULKAN
+    if (use_gpu)
+    {
+        if (!pipeline_cache_)
+            pipeline_cache_ = std::make_shared<ncnn::PipelineCache>(ncnn::get_gpu_device());
+        model->pipeline_cache = pipeline_cache_;
+        opt.pipeline_cache = pipeline_cache_.get();
+    }
+#endif
+
+    int ret = model->net.load_param((path + ".param").c_str());
+    if (ret != 0)
+    {
+        fprintf(stderr, "Failed to load param file: %s\n", (path + ".param").c_str());
+        return nullptr;
+    }
+
+    ret = loadWeights(*model, path + ".bin");
+    if (ret != 0)
+    {
+        fprintf(stderr, "Failed to load model file: %s\n", (path + ".bin").c_str());
+        return nullptr;
+    }
+
+    // Users see the network; the holder keeps its weights alive
+    return std::shared_ptr<const ncnn::Net>(model, &model->net);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file ModelRegistry.h
+ * @brief Loads NCNN networks once and shares them between their users
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <ncnn/net.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#if NCNN_VULKAN
+namespace ncnn { class PipelineCache; }
+#endif
+
+/**
+ * @brief Numeric precision the network runs in
+ */
+enum class ModelPrecision
+{
+    FP32,   ///< Full precision (default)
+    FP16,   ///< FP16 storage and arithmetic where the CPU (ARMv8.2) or GPU supports it
+    INT8    ///< Calibrated INT8 model loaded from "<model>-int8.param/.bin"
+};
+
+/**
+ * @brief Parse a precision name from the configuration
+ * @param name "fp32", "fp16" or "int8"
+ * @return Matching precision, FP32 for unknown names
+ */
+inline ModelPrecision parseModelPrecision(const std::string& name)
+{
+    if (name == "fp16") return ModelPrecision::FP16;
+    if (name == "int8") return ModelPrecision::INT8;
+    return ModelPrecision::FP32;
+}
+
+/**
+ * @brief Get the configuration name of a precision
+ * @param precision Model precision
+ * @return "fp32", "fp16" or "int8"
+ */
+inline const char* getPrecisionName(ModelPrecision precision)
+{
+    switch (precision)
+    {
+    case ModelPrecision::FP16: return "fp16";
+    case ModelPrecision::INT8: return "int8";
+    default: return "fp32";
+    }
+}
+
+/**
+ * @class ModelRegistry
+ * @brief Cache of loaded NCNN networks keyed by path, device and precision
+ *
+ * Every model the pipeline runs (the detector and any second-stage model) is
+ * loaded through the registry, so asking for the same files twice returns the
+ * network already in memory. A loaded ncnn::Net is only read by its users:
+ * each inference creates its own ncnn::Extractor, which is safe from several
+ * threads, so one copy of the weights serves every worker.
+ *
+ * The weights are memory-mapped rather than read into the heap, and on
+ * Vulkan the compiled pipelines are kept in a cache shared by all models of
+ * the registry, so loading a model again does not recompile the shaders.
+ * The networks stay loaded until the registry and the last user release them.
+ */
+class ModelRegistry
+{
+public:
+    ModelRegistry();
+    ~ModelRegistry();
+
+    /**
+     * @brief Get a network, loading it on first use
+     * @param modelpath Path to the model files without extension ("models/yolov4-tiny"
+     *                  loads models/yolov4-tiny.param and .bin)
+     * @param use_gpu Whether to run the network with Vulkan
+     * @param precision Numeric precision; INT8 loads "<modelpath>-int8.param/.bin"
+     * @return Shared network, nullptr if the files could not be loaded
+     */
+    std::shared_ptr<const ncnn::Net> acquire(const std::string& modelpath, bool use_gpu = false,
+                                             ModelPrecision precision = ModelPrecision::FP32);
+
+    /**
+     * @brief Get the number of networks loaded
+     * @return Model count
+     */
+    int getModelCount() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<const ncnn::Net>> models_;
+#if NCNN_VULKAN
+    std::shared_ptr<ncnn::PipelineCache> pipeline_cache_;  ///< Compiled shaders of all models
+#endif
+
+    std::shared_ptr<const ncnn::Net> load(const std::string& modelpath, bool use_gpu, ModelPrecision precision);
+};
+
+#endif // MODEL_REGISTRY_H
@@ -0,0 +1,94 @@
+/**
+ * @file MotionGate.cpp
+ * @brief Implementation of the motion pre-filter
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "MotionGate.h"
+#include "DetectionLayout.h"
+#include <iostream>
+#include <algorithm>
+
+namespace {
+// Background adaptation per compared frame: slow enough to catch gradual movement,
+// fast enough to absorb lighting changes within a few seconds
+const double kBackgroundRate = 0.05;
+}
+
+MotionGate::MotionGate()
+    : mask_area_(0), motion_level_(0.0f), skipped_count_(0) {
+}
+
+bool MotionGate::configure(const MotionGateSettings& settings, const std::string& roi) {
+    settings_ = settings;
+    settings_.width = std::max(16, settings_.width);
+    background_.release();
+
+    // Same format and validation as detection_roi
+    if (!DetectionLayout::parseAreas(roi, roi_)) {
+        std::cerr << "Invalid motion ROI, watching the whole frame" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MotionGate::reset(const cv::Size& size) {
+    background_.release();
+    mask_.release();
+    mask_area_ = size.area();
+
+    if (!roi_.empty()) {
+        mask_ = cv::Mat::zeros(size, CV_8UC1);
+        const cv::Rect bounds(0, 0, size.width, size.height);
+        for (const auto& region : roi_) {
+            cv::Rect rect(cvRound(region.x * size.width), cvRound(region.y * size.height),
+                          std::max(1, cvRound(region.width * size.width)), std::max(1, cvRound(region.height * size.height)));
+            mask_(rect & bounds).setTo(255);
+        }
+        mask_area_ = cv::countNonZero(mask_);
+    }
+}
+
+bool MotionGate::shouldDetect(const FrameContext& frame) {
+    if (!settings_.enabled || frame.image.empty()) return true;
+
+    // Small and blurred, so sensor noise and compression artefacts don't count as motion
+    const int height = std::max(1, frame.image.rows * settings_.width / frame.image.cols);
+    cv::resize(frame.image, resized_, cv::Size(settings_.width, height), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(resized_, small_, cv::COLOR_BGR2GRAY);
+    cv::GaussianBlur(small_, small_, cv::Size(5, 5), 0);
+
+    if (background_.empty() || background_.size() != small_.size()) {
+        reset(small_.size());
+        small_.convertTo(background_, CV_32F);
+        last_motion_ = frame.capture_time;
+        last_detection_ = frame.capture_time;
+        return true;
+    }
+
+    background_.convertTo(background_u8_, CV_8U);
+    cv::absdiff(small_, background_u8_, difference_);
+    cv::threshold(difference_, difference_, settings_.threshold, 255, cv::THRESH_BINARY);
+    if (!mask_.empty()) {
+        cv::bitwise_and(difference_, mask_, difference_);
+    }
+    cv::accumulateWeighted(small_, background_, kBackgroundRate);
+
+    const float level = mask_area_ > 0 ? (float)cv::countNonZero(difference_) / mask_area_ : 0.0f;
+    motion_level_ = level;
+    if (level >= settings_.min_area) {
+        last_motion_ = frame.capture_time;
+    }
+
+    const auto since_motion = std::chrono::duration_cast<std::chrono::milliseconds>(frame.capture_time - last_motion_);
+    const auto since_detection = std::chrono::duration_cast<std::chrono::milliseconds>(frame.capture_time - last_detection_);
+    if (since_motion.count() <= settings_.hold_ms ||
+        (settings_.idle_ms > 0 && since_detection.count() >= settings_.idle_ms)) {
+        last_detection_ = frame.capture_time;
+        return true;
+    }
+
+    skipped_count_++;
+    return false;
+}
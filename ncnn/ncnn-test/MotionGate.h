@@ -0,0 +1,91 @@
+/**
+ * @file MotionGate.h
+ * @brief Cheap motion pre-filter deciding which frames are worth a detection
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "FrameContext.h"
+
+/**
+ * @struct MotionGateSettings
+ * @brief Sensitivity of the motion gate, shared by all cameras
+ */
+struct MotionGateSettings {
+    bool enabled = false;      ///< Skip detection while nothing moves
+    int threshold = 25;        ///< Per-pixel grey level change counted as motion
+    float min_area = 0.002f;   ///< Fraction of the ROI that must change
+    int hold_ms = 1000;        ///< Keep detecting this long after the last motion
+    int idle_ms = 1000;        ///< Still detect this often on a static scene (0 = never)
+    int width = 160;           ///< Width of the grey image compared (height keeps the aspect ratio)
+};
+
+inline bool operator==(const MotionGateSettings& a, const MotionGateSettings& b) {
+    return a.enabled == b.enabled && a.threshold == b.threshold && a.min_area == b.min_area &&
+           a.hold_ms == b.hold_ms && a.idle_ms == b.idle_ms && a.width == b.width;
+}
+inline bool operator!=(const MotionGateSettings& a, const MotionGateSettings& b) { return !(a == b); }
+
+/**
+ * @class MotionGate
+ * @brief Per-camera frame-difference gate in front of the detector
+ *
+ * Each frame offered to the detector is shrunk to a small blurred grey image
+ * and compared with a running-average background; the detector only runs when
+ * enough of the ROI has changed, for hold_ms after that, and once per idle_ms
+ * otherwise. Skipped frames keep the previous detections. Not thread-safe:
+ * one camera stage calls shouldDetect().
+ */
+class MotionGate {
+public:
+    MotionGate();
+
+    /**
+     * @brief Set the sensitivity and the regions watched for motion
+     * @param settings Gate settings
+     * @param roi Regions as "x,y,w,h;..." fractions of the frame (empty = whole frame)
+     * @return false if the ROI could not be parsed (the whole frame is used)
+     */
+    bool configure(const MotionGateSettings& settings, const std::string& roi);
+
+    /**
+     * @brief Decide whether a frame should go to the detector
+     * @param frame Captured frame
+     * @return true to run detection, false to reuse the previous detections
+     */
+    bool shouldDetect(const FrameContext& frame);
+
+    float getMotionLevel() const { return motion_level_; }  ///< Changed fraction of the ROI in the last frame
+    int getSkippedCount() const { return skipped_count_; }  ///< Frames that did not go to the detector
+    void resetStatistics() { skipped_count_ = 0; }
+
+private:
+    MotionGateSettings settings_;
+    std::vector<cv::Rect2f> roi_;       ///< Watched regions, relative to the frame size
+
+    cv::Mat resized_;                   ///< Reused colour image of the current frame at the small size
+    cv::Mat small_;                     ///< Reused grey image of the current frame
+    cv::Mat background_;                ///< Running average, CV_32F
+    cv::Mat background_u8_;
+    cv::Mat difference_;                ///< Thresholded difference to the background, CV_8U
+    cv::Mat mask_;                      ///< ROI mask at the small size (empty = whole frame)
+    int mask_area_;
+
+    std::chrono::steady_clock::time_point last_motion_;
+    std::chrono::steady_clock::time_point last_detection_;
+    std::atomic<float> motion_level_;
+    std::atomic<int> skipped_count_;
+
+    void reset(const cv::Size& size);
+};
+
+#endif // MOTION_GATE_H
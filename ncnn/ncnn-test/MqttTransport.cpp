@@ -0,0 +1,149 @@
+/**
+ * @file MqttTransport.cpp
+ * @brief Implementation of the MQTT 3.1.1 publisher metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "MqttTransport.h"
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+enum PacketType {
+    kConnect = 0x10,
+    kConnAck = 0x20,
+    kPublish = 0x30,
+    kPubAck = 0x40
+};
+
+} // namespace
+
+MqttTransport::MqttTransport(const MetadataTransportSettings& settings)
+    : settings_(settings), fd_(-1), next_packet_id_(1) {
+    if (settings_.mqtt_qos != 0 && settings_.mqtt_qos != 1) {
+        std::cerr << "MQTT QoS " << settings_.mqtt_qos << " not supported, using 1" << std::endl;
+        settings_.mqtt_qos = 1;
+    }
+}
+
+MqttTransport::~MqttTransport() {
+    close();
+}
+
+std::string MqttTransport::getName() const {
+    return "mqtt://" + settings_.host + ":" + std::to_string(settings_.port) + "/" + settings_.mqtt_topic +
+           " (QoS " + std::to_string(settings_.mqtt_qos) + ")";
+}
+
+void MqttTransport::appendRemainingLength(std::string& packet, size_t length) {
+    do {
+        unsigned char byte = length % 128;
+        length /= 128;
+        if (length > 0) byte |= 0x80;
+        packet += (char)byte;
+    } while (length > 0);
+}
+
+void MqttTransport::appendString(std::string& packet, const std::string& text) {
+    packet += (char)((text.size() >> 8) & 0xff);
+    packet += (char)(text.size() & 0xff);
+    packet += text;
+}
+
+bool MqttTransport::connect() {
+    close();
+
+    fd_ = openTcpSocket(settings_.host, settings_.port, settings_.timeout_ms);
+    if (fd_ < 0) return false;
+
+    const std::string client_id = "ai-detection-" + std::to_string(getpid());
+
+    std::string body;
+    appendString(body, "MQTT");
+    body += (char)4;     // protocol level 3.1.1
+    body += (char)0x02;  // clean session
+    body += (char)0;     // keep-alive 0: broker never times the session out
+    body += (char)0;
+    appendString(body, client_id);
+
+    packet_.clear();
+    packet_ += (char)kConnect;
+    appendRemainingLength(packet_, body.size());
+    packet_ += body;
+
+    unsigned char type = 0;
+    std::string reply;
+    if (!sendAll(fd_, packet_.data(), packet_.size()) || !readPacket(type, reply) ||
+        type != kConnAck || reply.size() < 2 || reply[1] != 0) {
+        std::cerr << "MQTT broker " << settings_.host << ":" << settings_.port << " refused the connection" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MqttTransport::send(const std::string& data, bool binary) {
+    if (fd_ < 0) return false;
+
+    const uint16_t packet_id = next_packet_id_;
+    const size_t length = 2 + settings_.mqtt_topic.size() + (settings_.mqtt_qos > 0 ? 2 : 0) + data.size();
+
+    packet_.clear();
+    packet_ += (char)(kPublish | (settings_.mqtt_qos << 1));
+    appendRemainingLength(packet_, length);
+    appendString(packet_, settings_.mqtt_topic);
+    if (settings_.mqtt_qos > 0) {
+        packet_ += (char)(packet_id >> 8);
+        packet_ += (char)(packet_id & 0xff);
+        next_packet_id_ = (uint16_t)(next_packet_id_ % 0xffff + 1);  // ids are 1..65535
+    }
+    packet_ += data;
+
+    if (!sendAll(fd_, packet_.data(), packet_.size())) {
+        close();
+        return false;
+    }
+
+    if (settings_.mqtt_qos == 0) return true;
+
+    // QoS 1: the message counts as sent once the broker has acknowledged it
+    unsigned char type = 0;
+    std::string reply;
+    while (readPacket(type, reply)) {
+        if (type == kPubAck && reply.size() >= 2 &&
+            (((unsigned char)reply[0] << 8) | (unsigned char)reply[1]) == packet_id) {
+            return true;
+        }
+    }
+    close();
+    return false;
+}
+
+bool MqttTransport::readPacket(unsigned char& type, std::string& body) {
+    char header;
+    if (!recvAll(fd_, &header, 1)) return false;
+    type = (unsigned char)header & 0xf0;
+
+    size_t length = 0;
+    int shift = 0;
+    char byte;
+    do {
+        if (shift > 21 || !recvAll(fd_, &byte, 1)) return false;
+        length |= (size_t)((unsigned char)byte & 0x7f) << shift;
+        shift += 7;
+    } while ((unsigned char)byte & 0x80);
+
+    body.resize(length);
+    return length == 0 || recvAll(fd_, &body[0], length);
+}
+
+void MqttTransport::close() {
+    if (fd_ >= 0) {
+        const char disconnect[2] = {(char)0xe0, 0};
+        sendAll(fd_, disconnect, sizeof(disconnect));
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
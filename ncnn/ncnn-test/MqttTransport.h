@@ -0,0 +1,48 @@
+/**
+ * @file MqttTransport.h
+ * @brief MQTT 3.1.1 publisher metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <cstdint>
+#include <string>
+
+#include "MetadataTransport.h"
+
+/**
+ * @class MqttTransport
+ * @brief Publishes every message to one topic on an MQTT broker
+ *
+ * A minimal MQTT 3.1.1 client: CONNECT with a clean session, then PUBLISH
+ * with QoS 0 (fire-and-forget) or QoS 1 (waits for the broker's PUBACK).
+ * The broker fans messages out to any number of subscribers, so the device
+ * sends each message once. Keep-alive is handled by TCP keep-alive, so no
+ * PINGREQ timer is needed between sparse messages.
+ */
+class MqttTransport : public MetadataTransport {
+public:
+    explicit MqttTransport(const MetadataTransportSettings& settings);
+    ~MqttTransport() override;
+
+    bool connect() override;
+    bool isConnected() const override { return fd_ >= 0; }
+    bool send(const std::string& data, bool binary) override;
+    void close() override;
+    std::string getName() const override;
+
+private:
+    MetadataTransportSettings settings_;
+    int fd_;
+    uint16_t next_packet_id_;
+    std::string packet_;   ///< Reused outgoing packet buffer
+
+    static void appendRemainingLength(std::string& packet, size_t length);
+    static void appendString(std::string& packet, const std::string& text);
+    bool readPacket(unsigned char& type, std::string& body);
+};
+
+#endif // MQTT_TRANSPORT_H
@@ -0,0 +1,241 @@
+/**
+ * @file ObjectTracker.cpp
+ * @brief Implementation of the Kalman/IoU multi-object tracker
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "ObjectTracker.h"
+#include <algorithm>
+
+namespace {
+
+// Filter noise, in pixels and pixels per second; only the ratios really matter
+const float kMeasurementNoise = 10.0f;     ///< Detector box jitter (variance, px^2)
+const float kPositionNoise = 10.0f;        ///< Unmodelled box motion per second
+const float kVelocityNoise = 1000.0f;      ///< Acceleration per second
+const float kInitialVelocityVariance = 1e4f;
+
+/// One candidate match between a track and a detection
+struct Candidate {
+    float iou;
+    int track;
+    int detection;
+};
+
+float intersectionOverUnion(const cv::Rect_<float>& a, const cv::Rect_<float>& b) {
+    const float inter = (a & b).area();
+    const float total = a.area() + b.area() - inter;
+    return total > 0.0f ? inter / total : 0.0f;
+}
+
+double toSeconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+ObjectTracker::ObjectTracker() : next_id_(1) {
+}
+
+void ObjectTracker::configure(const TrackerSettings& settings) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    settings_ = settings;
+    settings_.min_hits = std::max(1, settings_.min_hits);
+    settings_.max_misses = std::max(0, settings_.max_misses);
+    tracks_.clear();
+}
+
+void ObjectTracker::initTrack(Track& track, const Object& detection, std::chrono::steady_clock::time_point time) const {
+    track.id = 0;
+    track.label = detection.label;
+    track.prob = detection.prob;
+    track.attribute = detection.attribute;
+    track.attribute_prob = detection.attribute_prob;
+    track.time = time;
+    track.hits = 1;
+    track.misses = 0;
+
+    // Constant velocity on (cx, cy, w, h); the dt terms are filled in by stepTrack()
+    cv::KalmanFilter& filter = track.filter;
+    filter.init(8, 4, 0, CV_32F);
+    cv::setIdentity(filter.measurementMatrix);
+    cv::setIdentity(filter.measurementNoiseCov, cv::Scalar(kMeasurementNoise));
+    cv::setIdentity(filter.errorCovPost, cv::Scalar(kMeasurementNoise));
+    for (int i = 4; i < 8; i++) {
+        filter.errorCovPost.at<float>(i, i) = kInitialVelocityVariance;
+    }
+
+    filter.statePost.at<float>(0, 0) = detection.rect.x + detection.rect.width * 0.5f;
+    filter.statePost.at<float>(1, 0) = detection.rect.y + detection.rect.height * 0.5f;
+    filter.statePost.at<float>(2, 0) = detection.rect.width;
+    filter.statePost.at<float>(3, 0) = detection.rect.height;
+}
+
+void ObjectTracker::stepTrack(Track& track, std::chrono::steady_clock::time_point time) {
+    // Detector runs are irregular (interval, motion gate, busy workers), so the step is in seconds
+    const float dt = (float)toSeconds(time - track.time);
+    if (dt <= 0.0f) return;
+
+    cv::KalmanFilter& filter = track.filter;
+    for (int i = 0; i < 4; i++) {
+        filter.transitionMatrix.at<float>(i, i + 4) = dt;
+        filter.processNoiseCov.at<float>(i, i) = kPositionNoise * dt;
+        filter.processNoiseCov.at<float>(i + 4, i + 4) = kVelocityNoise * dt;
+    }
+    filter.predict();  // also copies the prediction into statePost
+    track.time = time;
+}
+
+cv::Rect_<float> ObjectTracker::getRect(const cv::Mat& state, double dt) {
+    const float t = (float)dt;
+    const float cx = state.at<float>(0, 0) + state.at<float>(4, 0) * t;
+    const float cy = state.at<float>(1, 0) + state.at<float>(5, 0) * t;
+    const float w = std::max(1.0f, state.at<float>(2, 0) + state.at<float>(6, 0) * t);
+    const float h = std::max(1.0f, state.at<float>(3, 0) + state.at<float>(7, 0) * t);
+    return cv::Rect_<float>(cx - w * 0.5f, cy - h * 0.5f, w, h);
+}
+
+Object ObjectTracker::toObject(const Track& track, const cv::Rect_<float>& rect) {
+    Object object;
+    object.rect = rect;
+    object.label = track.label;
+    object.prob = track.prob;
+    object.track_id = track.id;
+    object.attribute = track.attribute;
+    object.attribute_prob = track.attribute_prob;
+    return object;
+}
+
+void ObjectTracker::associate(const std::vector<Object>& detections, bool confident) {
+    // Greedy by IoU; with the few objects per camera this matches the Hungarian result in practice
+    std::vector<Candidate> candidates;
+    for (size_t d = 0; d < detections.size(); d++) {
+        if (detection_match_[d] >= 0 || (detections[d].prob >= settings_.high_threshold) != confident) continue;
+
+        for (size_t t = 0; t < tracks_.size(); t++) {
+            if (track_match_[t] >= 0 || tracks_[t].label != detections[d].label) continue;
+
+            const float iou = intersectionOverUnion(getRect(tracks_[t].filter.statePost), detections[d].rect);
+            if (iou >= settings_.iou_threshold) {
+                candidates.push_back({iou, (int)t, (int)d});
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.iou > b.iou; });
+    for (const auto& candidate : candidates) {
+        if (track_match_[candidate.track] < 0 && detection_match_[candidate.detection] < 0) {
+            track_match_[candidate.track] = candidate.detection;
+            detection_match_[candidate.detection] = candidate.track;
+        }
+    }
+}
+
+void ObjectTracker::update(const std::vector<Object>& detections, std::chrono::steady_clock::time_point time,
+                           std::vector<TrackEvent>& events) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto& track : tracks_) {
+        stepTrack(track, time);
+    }
+
+    track_match_.assign(tracks_.size(), -1);
+    detection_match_.assign(detections.size(), -1);
+    associate(detections, true);
+    associate(detections, false);
+
+    cv::Mat measurement(4, 1, CV_32F);
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        Track& track = tracks_[t];
+        if (track_match_[t] < 0) {
+            track.misses++;
+            continue;
+        }
+
+        const Object& detection = detections[track_match_[t]];
+        measurement.at<float>(0, 0) = detection.rect.x + detection.rect.width * 0.5f;
+        measurement.at<float>(1, 0) = detection.rect.y + detection.rect.height * 0.5f;
+        measurement.at<float>(2, 0) = detection.rect.width;
+        measurement.at<float>(3, 0) = detection.rect.height;
+        track.filter.correct(measurement);
+        track.prob = detection.prob;
+        // Crops the classifier skipped keep the attribute seen earlier
+        if (detection.attribute) {
+            track.attribute = detection.attribute;
+            track.attribute_prob = detection.attribute_prob;
+        }
+        track.hits++;
+        track.misses = 0;
+
+        if (track.id == 0 && track.hits >= settings_.min_hits) {
+            track.id = next_id_++;
+            events.push_back({TrackEvent::Enter, toObject(track, getRect(track.filter.statePost))});
+        }
+    }
+
+    // Unconfirmed tracks get no second chance; confirmed ones coast for max_misses runs
+    size_t kept = 0;
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        Track& track = tracks_[t];
+        const bool ended = track.misses > 0 && (track.id == 0 || track.misses > settings_.max_misses);
+        if (ended) {
+            if (track.id != 0) {
+                events.push_back({TrackEvent::Exit, toObject(track, getRect(track.filter.statePost))});
+            }
+            continue;
+        }
+        if (kept != t) {
+            tracks_[kept] = tracks_[t];
+        }
+        kept++;
+    }
+    tracks_.resize(kept);
+
+    // Only confident detections start tracks
+    for (size_t d = 0; d < detections.size(); d++) {
+        if (detection_match_[d] >= 0 || detections[d].prob < settings_.high_threshold) continue;
+
+        Track track;
+        initTrack(track, detections[d], time);
+        if (settings_.min_hits <= 1) {
+            track.id = next_id_++;
+            events.push_back({TrackEvent::Enter, toObject(track, detections[d].rect)});
+        }
+        tracks_.push_back(track);
+    }
+}
+
+void ObjectTracker::getTracks(std::vector<Object>& objects) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    objects.clear();
+    for (const auto& track : tracks_) {
+        if (track.id != 0 && track.misses == 0) {
+            objects.push_back(toObject(track, getRect(track.filter.statePost)));
+        }
+    }
+}
+
+void ObjectTracker::predict(std::chrono::steady_clock::time_point time, std::vector<Object>& objects) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    objects.clear();
+
+    const double limit = settings_.max_predict_ms / 1000.0;
+    for (const auto& track : tracks_) {
+        if (track.id == 0) continue;
+
+        // Output frames may also be slightly older than the last analysed one
+        const double dt = std::max(-limit, std::min(limit, toSeconds(time - track.time)));
+        objects.push_back(toObject(track, getRect(track.filter.statePost, dt)));
+    }
+}
+
+int ObjectTracker::getActiveCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int count = 0;
+    for (const auto& track : tracks_) {
+        if (track.id != 0) count++;
+    }
+    return count;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file ObjectTracker.h
+ * @brief Kalman/IoU multi-object tracker giving detections stable ids
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef OBJECT_TRACKER_H
+#define OBJECT_TRACKER_H
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "YoloDetector.h"
+
+/**
+ * @struct TrackerSettings
+ * @brief Association and track lifetime parameters, shared by all cameras
+ */
+struct TrackerSettings {
+    bool enabled = false;         ///< Track detections between detector runs
+    float iou_threshold = 0.3f;   ///< Minimum IoU between a predicted track and a detection
+    float high_threshold = 0.5f;  ///< Detections at or above this confidence are matched first and may start tracks
+    int min_hits = 2;             ///< Matched detector runs before a track is reported (and "enter" is sent)
+    int max_misses = 3;           ///< Consecutive detector runs without a match before a track ends ("exit")
+    int max_predict_ms = 500;     ///< Longest extrapolation from the last matched detection
+};
+
+inline bool operator==(const TrackerSettings& a, const TrackerSettings& b) {
+    return a.enabled == b.enabled && a.iou_threshold == b.iou_threshold && a.high_threshold == b.high_threshold &&
+           a.min_hits == b.min_hits && a.max_misses == b.max_misses && a.max_predict_ms == b.max_predict_ms;
+}
+inline bool operator!=(const TrackerSettings& a, const TrackerSettings& b) { return !(a == b); }
+
+/**
+ * @struct TrackEvent
+ * @brief A track appearing or disappearing
+ */
+struct TrackEvent {
+    enum Type { Enter, Exit };
+    Type type;
+    Object object;  ///< Box, class and track id when confirmed (Enter) or last seen (Exit)
+};
+
+/**
+ * @class ObjectTracker
+ * @brief SORT-style tracker with ByteTrack's two-stage association, one per camera
+ *
+ * Every track runs a constant-velocity Kalman filter on its box centre and
+ * size. update() steps the filters to the time of the analysed frame and
+ * matches the detections by IoU within the same class: confident detections
+ * first, then the remaining ones against the tracks still unmatched, which
+ * keeps occluded or blurred objects alive without letting low-confidence
+ * noise start new tracks. predict() extrapolates the confirmed tracks to any
+ * later frame without touching the filters, so boxes keep moving on frames
+ * the detector skipped.
+ *
+ * update() and predict() may be called from different threads.
+ */
+class ObjectTracker {
+public:
+    ObjectTracker();
+
+    /**
+     * @brief Set the tracker parameters and drop all tracks
+     * @param settings Tracker settings
+     */
+    void configure(const TrackerSettings& settings);
+
+    /**
+     * @brief Associate the detections of one analysed frame with the tracks
+     * @param detections Detector output for the frame
+     * @param time Capture time of the frame
+     * @param events Receives the enter/exit events caused by this update (appended)
+     */
+    void update(const std::vector<Object>& detections, std::chrono::steady_clock::time_point time,
+                std::vector<TrackEvent>& events);
+
+    /**
+     * @brief Get the confirmed tracks as of the last update
+     * @param objects Output vector, track_id set on every object
+     */
+    void getTracks(std::vector<Object>& objects) const;
+
+    /**
+     * @brief Get the confirmed tracks extrapolated to a frame
+     * @param time Capture time of the frame
+     * @param objects Output vector, track_id set on every object
+     */
+    void predict(std::chrono::steady_clock::time_point time, std::vector<Object>& objects) const;
+
+    /**
+     * @brief Get number of confirmed tracks
+     * @return Active track count
+     */
+    int getActiveCount() const;
+
+private:
+    struct Track {
+        int id;                     ///< 0 until confirmed
+        int label;
+        float prob;
+        const char* attribute;      ///< Last attribute the classifier gave this object
+        float attribute_prob;
+        cv::KalmanFilter filter;    ///< State: cx, cy, w, h and their velocities per second
+        std::chrono::steady_clock::time_point time;  ///< Time of the filter state
+        int hits;
+        int misses;
+    };
+
+    TrackerSettings settings_;
+    std::vector<Track> tracks_;
+    int next_id_;
+    mutable std::mutex mutex_;
+
+    // Association scratch, reused between updates
+    std::vector<int> track_match_;
+    std::vector<int> detection_match_;
+
+    void initTrack(Track& track, const Object& detection, std::chrono::steady_clock::time_point time) const;
+    static void stepTrack(Track& track, std::chrono::steady_clock::time_point time);
+    static cv::Rect_<float> getRect(const cv::Mat& state, double dt = 0.0);
+    void associate(const std::vector<Object>& detections, bool confident);
+    static Object toObject(const Track& track, const cv::Rect_<float>& rect);
+};
+
+#endif // OBJECT_TRACKER_H
@@ -0,0 +1,31 @@
+/**
+ * @file OpenCvFrameSource.h
+ * @brief Capture backend based on cv::VideoCapture
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef OPENCV_FRAME_SOURCE_H
+#define OPENCV_FRAME_SOURCE_H
+
+#include "FrameSource.h"
+
+/**
+ * @class OpenCvFrameSource
+ * @brief Reads MJPG frames through V4L2 and decodes them in OpenCV
+ */
+class OpenCvFrameSource : public FrameSource {
+public:
+    OpenCvFrameSource();
+    ~OpenCvFrameSource() override;
+
+    bool open(const ConfigManager::CameraConfig& camera) override;
+    bool read(cv::Mat& frame) override;
+    void close() override;
+    std::string getName() const override { return "opencv"; }
+
+private:
+    cv::VideoCapture capture_;
+};
+
+#endif // OPENCV_FRAME_SOURCE_H
@@ -0,0 +1,118 @@
+/**
+ * @file PipelineMetrics.cpp
+ * @brief Implementation of the stage histograms and Prometheus rendering
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "PipelineMetrics.h"
+#include <cmath>
+#include <cstdio>
+
+const double LatencyHistogram::kBucketBounds[LatencyHistogram::kBucketCount] = {
+    0.5, 1, 2, 5, 10, 20, 33, 50, 100, 200, 500, 1000, 2000, 5000
+};
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_us_(0) {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(double ms) {
+    if (!(ms >= 0.0)) ms = 0.0;  // also catches NaN
+
+    int bucket = 0;
+    while (bucket < kBucketCount && ms > kBucketBounds[bucket]) {
+        bucket++;
+    }
+
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add((uint64_t)std::llround(ms * 1000.0), std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getCumulativeCount(int bucket) const {
+    uint64_t total = 0;
+    for (int i = 0; i <= bucket && i <= kBucketCount; i++) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+PipelineMetrics& PipelineMetrics::instance() {
+    static PipelineMetrics metrics;
+    return metrics;
+}
+
+const char* PipelineMetrics::getStageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::Capture: return "capture";
+        case PipelineStage::Preprocess: return "preprocess";
+        case PipelineStage::Forward: return "forward";
+        case PipelineStage::Postprocess: return "postprocess";
+        case PipelineStage::Classify: return "classify";
+        case PipelineStage::Draw: return "draw";
+        case PipelineStage::Push: return "push";
+        case PipelineStage::Encode: return "encode";
+        case PipelineStage::Publish: return "publish";
+        default: return "unknown";
+    }
+}
+
+void PipelineMetrics::writePrometheus(std::string& out) const {
+    static const char* name = "ai_stage_duration_milliseconds";
+    appendHeader(out, name, "histogram", "Duration of one pass through a pipeline stage");
+
+    const std::string bucket_name = std::string(name) + "_bucket";
+    const std::string sum_name = std::string(name) + "_sum";
+    const std::string count_name = std::string(name) + "_count";
+
+    char bound[32];
+    for (int s = 0; s < (int)PipelineStage::Count; s++) {
+        const LatencyHistogram& histogram = histograms_[s];
+        const std::string stage = std::string("stage=\"") + getStageName((PipelineStage)s) + "\"";
+
+        // Buckets are read one by one; +Inf and _count come from the same sum so they stay monotonic
+        for (int b = 0; b < LatencyHistogram::kBucketCount; b++) {
+            std::snprintf(bound, sizeof(bound), "%g", LatencyHistogram::kBucketBounds[b]);
+            appendSample(out, bucket_name.c_str(), stage + ",le=\"" + bound + "\"",
+                         (double)histogram.getCumulativeCount(b));
+        }
+        const uint64_t count = histogram.getCumulativeCount(LatencyHistogram::kBucketCount);
+        appendSample(out, bucket_name.c_str(), stage + ",le=\"+Inf\"", (double)count);
+        appendSample(out, sum_name.c_str(), stage, histogram.getSumMs());
+        appendSample(out, count_name.c_str(), stage, (double)count);
+    }
+}
+
+void PipelineMetrics::appendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void PipelineMetrics::appendSample(std::string& out, const char* name, const std::string& labels, double value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+
+    char text[32];
+    if (std::isnan(value)) {
+        std::snprintf(text, sizeof(text), " NaN\n");  // Prometheus spelling, printf would write "nan"
+    } else if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        std::snprintf(text, sizeof(text), " %.0f\n", value);
+    } else {
+        std::snprintf(text, sizeof(text), " %.6g\n", value);
+    }
+    out += text;
+}
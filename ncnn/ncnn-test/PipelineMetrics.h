@@ -0,0 +1,151 @@
+/**
+ * @file PipelineMetrics.h
+ * @brief Lock-free per-stage latency histograms and Prometheus text helpers
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @enum PipelineStage
+ * @brief Timed stages of the detection and streaming pipeline
+ */
+enum class PipelineStage {
+    Capture,      ///< FrameSource::read(), including the wait for the camera
+    Preprocess,   ///< Letterbox resize and normalization into the input blob
+    Forward,      ///< NCNN network forward pass
+    Postprocess,  ///< Proposal decoding and NMS
+    Classify,     ///< Second-stage classification of the detection crops of one batch
+    Draw,         ///< Drawing detections on the output frame
+    Push,         ///< Scaling/conversion into pooled buffers and appsrc push, all profiles
+    Encode,       ///< Encoder input to encoder output of one frame
+    Publish,      ///< Sending one metadata message
+    Count
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-bucket latency histogram updated with relaxed atomics only
+ */
+class LatencyHistogram {
+public:
+    static const int kBucketCount = 14;
+    static const double kBucketBounds[kBucketCount];  ///< Upper bucket bounds in ms (+Inf is implicit)
+
+    LatencyHistogram();
+
+    /**
+     * @brief Add one observation
+     * @param ms Duration in milliseconds
+     */
+    void record(double ms);
+
+    uint64_t getCount() const { return count_.load(std::memory_order_relaxed); }
+    double getSumMs() const { return sum_us_.load(std::memory_order_relaxed) / 1000.0; }
+
+    /**
+     * @brief Get the number of observations up to a bucket bound
+     * @param bucket Bucket index, kBucketCount for +Inf
+     * @return Cumulative count as used by Prometheus "le" buckets
+     */
+    uint64_t getCumulativeCount(int bucket) const;
+
+private:
+    std::atomic<uint64_t> buckets_[kBucketCount + 1];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_us_;
+};
+
+/**
+ * @class PipelineMetrics
+ * @brief Process-wide stage histograms, written from any thread
+ *
+ * Stages record into one histogram each through record() or ScopedStageTimer;
+ * nothing here takes a lock, so instrumented hot paths only pay for a few
+ * atomic increments. writePrometheus() renders them in the Prometheus text
+ * exposition format; the append helpers let callers add their own counters
+ * and gauges to the same page.
+ */
+class PipelineMetrics {
+public:
+    /**
+     * @brief Get the process-wide instance
+     * @return Metrics instance
+     */
+    static PipelineMetrics& instance();
+
+    /**
+     * @brief Record a stage duration
+     * @param stage Pipeline stage
+     * @param ms Duration in milliseconds
+     */
+    void record(PipelineStage stage, double ms) { histograms_[(int)stage].record(ms); }
+
+    const LatencyHistogram& getHistogram(PipelineStage stage) const { return histograms_[(int)stage]; }
+
+    /**
+     * @brief Get the label value of a stage
+     * @return Stage name, e.g. "forward"
+     */
+    static const char* getStageName(PipelineStage stage);
+
+    /**
+     * @brief Append all stage histograms as ai_stage_duration_milliseconds{stage="..."}
+     * @param out Output text
+     */
+    void writePrometheus(std::string& out) const;
+
+    /**
+     * @brief Append the HELP and TYPE lines of a metric
+     * @param out Output text
+     * @param name Metric name
+     * @param type "counter", "gauge" or "histogram"
+     * @param help Description
+     */
+    static void appendHeader(std::string& out, const char* name, const char* type, const char* help);
+
+    /**
+     * @brief Append one sample line
+     * @param out Output text
+     * @param name Metric name
+     * @param labels Label set without braces, e.g. camera="camera_2" (empty for none)
+     * @param value Sample value
+     */
+    static void appendSample(std::string& out, const char* name, const std::string& labels, double value);
+
+private:
+    PipelineMetrics() {}
+
+    LatencyHistogram histograms_[(int)PipelineStage::Count];
+};
+
+/**
+ * @class ScopedStageTimer
+ * @brief Records the lifetime of the object as one observation of a stage
+ */
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(PipelineStage stage)
+        : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+
+    ~ScopedStageTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        PipelineMetrics::instance().record(stage_, std::chrono::duration<double, std::milli>(elapsed).count());
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    PipelineStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // PIPELINE_METRICS_H
@@ -0,0 +1,235 @@
+/**
+ * @file PrecisionReport.cpp
+ * @brief Accuracy and latency report of the fp32, fp16 and int8 model modes
+ * @author AI Detection System
+ * @date 2025-10-14
+ *
+ * Usage: ./precision_report <model_prefix> <imagelist.txt> [use_gpu]
+ *        ./precision_report --letterbox <imagelist.txt> <output_dir>
+ *
+ * Every mode whose model files exist runs over the same frames (e.g. the
+ * list written by calibrate_int8.sh). Latency is measured per detect()
+ * call; accuracy is reported as recall and precision against the fp32
+ * detections (same label, IoU >= 0.5).
+ *
+ * --letterbox writes every frame as the detector's network input (PNG) with
+ * an imagelist.txt, and prints the input shape for ncnn2table, so INT8
+ * calibration sees the letterboxed input inference sees.
+ */
+
+#include "YoloDetector.h"
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief Result of one precision mode
+ */
+struct ModeReport {
+    ModelPrecision precision;
+    bool loaded = false;
+    double mean_ms = 0.0;
+    double p95_ms = 0.0;
+    int detections = 0;
+    std::vector<std::vector<Object>> objects;   ///< Detections per frame
+};
+
+/**
+ * @brief Count detections of a mode that match a reference detection
+ * @param reference Reference detections of one frame
+ * @param candidate Detections of the mode under test
+ * @return Number of one-to-one matches with the same label and IoU >= 0.5
+ */
+static int countMatches(const std::vector<Object>& reference, const std::vector<Object>& candidate) {
+    std::vector<bool> used(reference.size(), false);
+    int matches = 0;
+
+    for (const auto& obj : candidate) {
+        int best = -1;
+        float best_iou = 0.5f;
+        for (size_t i = 0; i < reference.size(); i++) {
+            if (used[i] || reference[i].label != obj.label) continue;
+
+            float inter = (reference[i].rect & obj.rect).area();
+            float iou = inter / (reference[i].rect.area() + obj.rect.area() - inter);
+            if (iou >= best_iou) {
+                best_iou = iou;
+                best = (int)i;
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            matches++;
+        }
+    }
+
+    return matches;
+}
+
+/**
+ * @brief Write the letterboxed network input of every listed frame
+ * @param list_path Frame list, one path per line
+ * @param output_dir Existing directory receiving the PNGs and imagelist.txt
+ * @return 0 on success, -1 if no frame could be written
+ */
+static int writeLetterboxed(const std::string& list_path, const std::string& output_dir) {
+    YoloDetector detector;
+    std::ifstream list(list_path);
+    std::ofstream output_list(output_dir + "/imagelist.txt");
+    cv::Size shape;
+    int written = 0;
+
+    std::string path;
+    while (std::getline(list, path)) {
+        if (path.empty()) continue;
+        cv::Mat frame = cv::imread(path);
+        if (frame.empty()) {
+            std::cerr << "Skipping unreadable frame: " << path << std::endl;
+            continue;
+        }
+
+        cv::Mat letterboxed;
+        detector.letterbox(frame, letterboxed);
+
+        // ncnn2table takes one input shape for all frames
+        if (written == 0) {
+            shape = letterboxed.size();
+        } else if (letterboxed.size() != shape) {
+            std::cerr << "Skipping frame of another size: " << path << std::endl;
+            continue;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "/input_%05d.png", written);
+        if (!cv::imwrite(output_dir + name, letterboxed)) {
+            std::cerr << "Failed to write " << output_dir + name << std::endl;
+            continue;
+        }
+        output_list << output_dir + name << "\n";
+        written++;
+    }
+
+    if (written == 0) {
+        std::cerr << "No frames in " << list_path << std::endl;
+        return -1;
+    }
+    std::cerr << written << " letterboxed frames written to " << output_dir << std::endl;
+    std::cout << "shape=[" << shape.width << "," << shape.height << ",3]" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "--letterbox") {
+        return writeLetterboxed(argv[2], argv[3]);
+    }
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <model_prefix> <imagelist.txt> [use_gpu]" << std::endl;
+        std::cerr << "       " << argv[0] << " --letterbox <imagelist.txt> <output_dir>" << std::endl;
+        return -1;
+    }
+
+    const std::string model_prefix = argv[1];
+    const bool use_gpu = argc > 3 && std::string(argv[3]) == "1";
+
+    std::vector<cv::Mat> frames;
+    std::ifstream list(argv[2]);
+    std::string path;
+    while (std::getline(list, path)) {
+        if (path.empty()) continue;
+        cv::Mat frame = cv::imread(path);
+        if (frame.empty()) {
+            std::cerr << "Skipping unreadable frame: " << path << std::endl;
+            continue;
+        }
+        frames.push_back(frame);
+    }
+
+    if (frames.empty()) {
+        std::cerr << "No frames in " << argv[2] << std::endl;
+        return -1;
+    }
+    std::cout << "Frames: " << frames.size() << ", GPU: " << (use_gpu ? "Yes" : "No") << std::endl;
+
+    std::vector<ModeReport> reports;
+    for (ModelPrecision precision : { ModelPrecision::FP32, ModelPrecision::FP16, ModelPrecision::INT8 }) {
+        ModeReport report;
+        report.precision = precision;
+
+        YoloDetector detector;
+        if (detector.load(model_prefix, use_gpu, precision) != 0) {
+            std::cout << getPrecisionName(precision) << ": model not available, skipped" << std::endl;
+            reports.push_back(report);
+            continue;
+        }
+        report.loaded = true;
+
+        // Warm up so pipeline creation and first-touch allocations are not measured
+        std::vector<Object> objects;
+        for (int i = 0; i < 3; i++) {
+            detector.detect(frames[0], objects);
+        }
+
+        std::vector<double> latencies;
+        for (const auto& frame : frames) {
+            auto start = std::chrono::steady_clock::now();
+            detector.detect(frame, objects);
+            auto end = std::chrono::steady_clock::now();
+
+            latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            report.detections += (int)objects.size();
+            report.objects.push_back(objects);
+        }
+
+        double total = 0.0;
+        for (double latency : latencies) total += latency;
+        report.mean_ms = total / latencies.size();
+
+        std::sort(latencies.begin(), latencies.end());
+        report.p95_ms = latencies[std::min(latencies.size() - 1, latencies.size() * 95 / 100)];
+
+        reports.push_back(report);
+    }
+
+    const ModeReport& reference = reports[0];
+
+    std::cout << std::endl;
+    std::cout << "=== Precision Report ===" << std::endl;
+    std::cout << std::left << std::setw(6) << "mode" << std::right
+              << std::setw(10) << "mean ms" << std::setw(10) << "p95 ms" << std::setw(8) << "fps"
+              << std::setw(12) << "detections" << std::setw(10) << "recall" << std::setw(11) << "precision" << std::endl;
+
+    for (const auto& report : reports) {
+        if (!report.loaded) continue;
+
+        std::cout << std::left << std::setw(6) << getPrecisionName(report.precision) << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << report.mean_ms
+                  << std::setw(10) << report.p95_ms
+                  << std::setw(8) << std::setprecision(1) << 1000.0 / report.mean_ms
+                  << std::setw(12) << report.detections;
+
+        if (reference.loaded) {
+            int ref_count = 0;
+            int count = 0;
+            int matches = 0;
+            for (size_t i = 0; i < frames.size(); i++) {
+                ref_count += (int)reference.objects[i].size();
+                count += (int)report.objects[i].size();
+                matches += countMatches(reference.objects[i], report.objects[i]);
+            }
+            std::cout << std::setprecision(3)
+                      << std::setw(10) << (ref_count > 0 ? (double)matches / ref_count : 1.0)
+                      << std::setw(11) << (count > 0 ? (double)matches / count : 1.0);
+        } else {
+            std::cout << std::setw(10) << "-" << std::setw(11) << "-";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "(recall/precision against fp32 detections, same label and IoU >= 0.5)" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file QosController.cpp
+ * @brief Implementation of the load shedding controller
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "QosController.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace {
+// Value of each step; step 0 is the configured value
+const float kInputScales[QosController::kMaxSteps + 1] = {1.f, 0.85f, 0.7f, 0.55f};
+const float kBitrateScales[QosController::kMaxSteps + 1] = {1.f, 0.75f, 0.55f, 0.4f};
+
+// Recovery needs clear headroom, otherwise undoing a step would overload again
+const double kRecoverLatencyFraction = 0.7;
+const double kRecoverDropFraction = 0.01;
+
+// An occasional drop is normal for drop-oldest queues; a steady share is not
+const double kOverloadDropFraction = 0.05;
+}
+
+QosController::QosController()
+    : adjustment_count_(0), latency_ms_(0.0), calm_periods_(0), saturated_(false),
+      next_update_(std::chrono::steady_clock::now()) {
+    for (auto& step : steps_) {
+        step = 0;
+    }
+}
+
+bool QosController::configure(const QosSettings& settings) {
+    settings_ = settings;
+    settings_.target_latency_ms = std::max(1, settings.target_latency_ms);
+    settings_.interval_ms = std::max(100, settings.interval_ms);
+    settings_.recover_periods = std::max(1, settings.recover_periods);
+
+    bool valid = true;
+    order_.clear();
+    std::stringstream list(settings.order);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (name.empty()) continue;
+
+        bool found = false;
+        for (int k = 0; k < (int)QosKnob::Count && !found; k++) {
+            const QosKnob knob = (QosKnob)k;
+            if (name == getKnobName(knob)) {
+                if (std::find(order_.begin(), order_.end(), knob) == order_.end()) order_.push_back(knob);
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "Ignoring unknown QoS knob '" << name << "'" << std::endl;
+            valid = false;
+        }
+    }
+
+    for (auto& step : steps_) {
+        step = 0;
+    }
+    calm_periods_ = 0;
+    saturated_ = false;
+    next_update_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings_.interval_ms);
+    return valid;
+}
+
+bool QosController::update(const QosSample& sample, std::chrono::steady_clock::time_point now) {
+    next_update_ = now + std::chrono::milliseconds(settings_.interval_ms);
+    if (!sample.valid) return false;
+    latency_ms_ = sample.latency_ms;
+
+    const bool overloaded = sample.latency_ms > settings_.target_latency_ms ||
+                            sample.drop_fraction > kOverloadDropFraction || sample.backpressured;
+    const bool calm = sample.latency_ms < settings_.target_latency_ms * kRecoverLatencyFraction &&
+                      sample.drop_fraction <= kRecoverDropFraction && !sample.backpressured;
+
+    if (overloaded) {
+        calm_periods_ = 0;
+        for (QosKnob knob : order_) {
+            if (steps_[(int)knob] < kMaxSteps) {
+                steps_[(int)knob]++;
+                adjustment_count_++;
+                logStep(knob, sample, "behind");
+                return true;
+            }
+        }
+        if (!saturated_ && !order_.empty()) {
+            std::cerr << "QoS: still behind (" << (int)sample.latency_ms << " ms) with every knob at its lowest step" << std::endl;
+            saturated_ = true;
+        }
+        return false;
+    }
+
+    saturated_ = false;
+    if (!calm) {
+        calm_periods_ = 0;
+        return false;
+    }
+    if (++calm_periods_ < settings_.recover_periods) return false;
+    calm_periods_ = 0;
+
+    // Undo in reverse order: the knob turned down last comes back first
+    for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        if (steps_[(int)*it] > 0) {
+            steps_[(int)*it]--;
+            adjustment_count_++;
+            logStep(*it, sample, "recovered");
+            return true;
+        }
+    }
+    return false;
+}
+
+QosAdjustment QosController::getAdjustment() const {
+    QosAdjustment adjustment;
+    adjustment.detection_interval_factor = 1 + steps_[(int)QosKnob::DetectionInterval];
+    adjustment.input_scale = kInputScales[steps_[(int)QosKnob::TargetSize]];
+    adjustment.bitrate_scale = kBitrateScales[steps_[(int)QosKnob::Bitrate]];
+    adjustment.frame_stride = 1 + steps_[(int)QosKnob::FrameRate];
+    return adjustment;
+}
+
+const char* QosController::getKnobName(QosKnob knob) {
+    switch (knob) {
+        case QosKnob::DetectionInterval: return "detection_interval";
+        case QosKnob::TargetSize: return "target_size";
+        case QosKnob::Bitrate: return "bitrate";
+        case QosKnob::FrameRate: return "frame_rate";
+        default: return "unknown";
+    }
+}
+
+void QosController::logStep(QosKnob knob, const QosSample& sample, const char* reason) const {
+    const QosAdjustment adjustment = getAdjustment();
+    std::cout << "QoS: " << reason << " (latency " << (int)sample.latency_ms << " ms, target " << settings_.target_latency_ms
+              << " ms, " << (int)(sample.drop_fraction * 100) << "% of frames dropped"
+              << (sample.backpressured ? ", metadata rejected" : "") << "), " << getKnobName(knob) << " step "
+              << steps_[(int)knob] << "/" << kMaxSteps << " -> detection interval x" << adjustment.detection_interval_factor
+              << ", input " << (int)(adjustment.input_scale * 100) << "%, bitrate " << (int)(adjustment.bitrate_scale * 100)
+              << "%, every " << adjustment.frame_stride << " frame(s) streamed" << std::endl;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file QosController.h
+ * @brief Feedback controller that sheds load step by step to hold a latency target
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef QOS_CONTROLLER_H
+#define QOS_CONTROLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @brief What the controller can turn down, each in a few fixed steps
+ */
+enum class QosKnob {
+    DetectionInterval,  ///< Run the detector on fewer frames
+    TargetSize,         ///< Smaller detector input
+    Bitrate,            ///< Lower encoder bitrate
+    FrameRate,          ///< Push fewer frames to RTSP
+    Count
+};
+
+/**
+ * @struct QosSettings
+ * @brief Latency target and the order in which load is shed
+ */
+struct QosSettings {
+    int target_latency_ms = 300;   ///< Capture-to-output latency to hold
+    int interval_ms = 1000;        ///< Length of one measurement window
+    int recover_periods = 5;       ///< Calm windows before a step is undone
+    std::string order = "detection_interval,target_size,bitrate,frame_rate"; ///< Knobs, first turned down first
+};
+
+/**
+ * @struct QosSample
+ * @brief Load measured over one window
+ */
+struct QosSample {
+    double latency_ms = 0.0;   ///< Worst average capture-to-result or capture-to-push latency of the cameras
+    double drop_fraction = 0.0; ///< Largest share of a camera's captured frames dropped by the pipeline queues
+    bool backpressured = false; ///< The metadata publisher rejected records
+    bool valid = false;        ///< false if no frame went through during the window
+};
+
+/**
+ * @struct QosAdjustment
+ * @brief What the current steps mean for the pipeline
+ */
+struct QosAdjustment {
+    int detection_interval_factor = 1;  ///< Multiplies detection_interval
+    float input_scale = 1.f;            ///< Scales the detector input size
+    float bitrate_scale = 1.f;          ///< Scales the encoder bitrate
+    int frame_stride = 1;               ///< Only every Nth frame is pushed to RTSP
+};
+
+/**
+ * @class QosController
+ * @brief Turns the knobs down in priority order while the pipeline is behind
+ *
+ * update() is fed one QosSample per window. A window over the latency
+ * target, with more than 5% of a camera's frames dropped or with metadata
+ * rejected turns the first knob in the configured order that has a step left
+ * down by one step. The queues drop the oldest frame by design, so a full
+ * queue alone is not overload; their drop counters are. Once the latency stays
+ * below 70% of the target with at most 1% dropped for recover_periods windows,
+ * the knob turned down last is turned back up by one step. Only one step
+ * changes per window, so the effect of a change is measured before the next
+ * one, and recovery is slower than degradation so the pipeline does not
+ * oscillate around the target.
+ *
+ * Every change is logged. The steps are atomics, so the metrics page may read
+ * them while the main loop updates them.
+ */
+class QosController {
+public:
+    static const int kMaxSteps = 3;  ///< Steps per knob
+
+    QosController();
+
+    /**
+     * @brief Set the target and the knob order, and reset all steps
+     * @param settings Controller settings
+     * @return false if the order names an unknown knob (it is skipped)
+     */
+    bool configure(const QosSettings& settings);
+
+    /**
+     * @brief Check if a window has ended
+     * @param now Current time
+     * @return true if update() is due
+     */
+    bool isDue(std::chrono::steady_clock::time_point now) const { return now >= next_update_; }
+
+    /**
+     * @brief Feed the load of the window that just ended
+     * @param sample Measured load
+     * @param now Current time, starts the next window
+     * @return true if a step changed, i.e. the adjustment must be applied again
+     */
+    bool update(const QosSample& sample, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Get the pipeline changes for the current steps
+     * @return Adjustment to apply on top of the configured values
+     */
+    QosAdjustment getAdjustment() const;
+
+    int getStep(QosKnob knob) const { return steps_[(int)knob]; }
+    int getAdjustmentCount() const { return adjustment_count_; }    ///< Steps taken in either direction
+    double getLatencyMs() const { return latency_ms_; }             ///< Latency of the last window
+    int getTargetLatencyMs() const { return settings_.target_latency_ms; }
+
+    static const char* getKnobName(QosKnob knob);
+
+private:
+    QosSettings settings_;
+    std::vector<QosKnob> order_;
+    std::atomic<int> steps_[(int)QosKnob::Count];
+    std::atomic<int> adjustment_count_;
+    std::atomic<double> latency_ms_;
+    int calm_periods_;
+    bool saturated_;           ///< Every knob is at its last step (logged once)
+    std::chrono::steady_clock::time_point next_update_;
+
+    void logStep(QosKnob knob, const QosSample& sample, const char* reason) const;
+};
+
+#endif // QOS_CONTROLLER_H
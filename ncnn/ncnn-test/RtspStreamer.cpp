@@ -6,41 +6,213 @@
  */
 
 #include "RtspStreamer.h"
+#include "ThreadUtils.h"
+#include "PipelineMetrics.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cstring>
 #include <gst/app/gstappsrc.h>
-#include <gst/video/video.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Encoder elements probed in order when the encoder is "auto"
+ */
+struct EncoderProfile {
+    const char* codec;
+    const char* element;
+    const char* helper;       ///< Additional element the encoder needs, or nullptr
+    GstVideoFormat format;    ///< Raw format fed to appsrc
+};
+
+static const EncoderProfile encoder_profiles[] = {
+    { "h264", "nvv4l2h264enc", "nvvidconv", GST_VIDEO_FORMAT_I420 },
+    { "h264", "vaapih264enc",  nullptr,     GST_VIDEO_FORMAT_NV12 },
+    { "h264", "v4l2h264enc",   nullptr,     GST_VIDEO_FORMAT_NV12 },
+    { "h264", "x264enc",       nullptr,     GST_VIDEO_FORMAT_I420 },
+    { "h265", "nvv4l2h265enc", "nvvidconv", GST_VIDEO_FORMAT_I420 },
+    { "h265", "vaapih265enc",  nullptr,     GST_VIDEO_FORMAT_NV12 },
+    { "h265", "v4l2h265enc",   nullptr,     GST_VIDEO_FORMAT_NV12 },
+    { "h265", "x265enc",       nullptr,     GST_VIDEO_FORMAT_I420 },
+};
+
+const unsigned char RtspStreamer::kSeiUuid[16] = {
+    'a', 'i', '-', 'd', 'e', 't', 'e', 'c', 't', 'i', 'o', 'n', '-', 's', 'e', 'i'
+};
+
+/// Pending SEI payloads kept per stream; older ones belong to frames that were dropped
+static const size_t kMaxPendingSei = 64;
+
+/**
+ * @brief Build an Annex B SEI NAL unit with a user_data_unregistered message
+ * @param payload Message body (follows the UUID)
+ * @param h265 true for an H.265 prefix SEI, false for H.264
+ * @param nal Output NAL unit including its start code
+ */
+static void buildSeiNal(const std::string& payload, bool h265, std::string& nal) {
+    std::string rbsp;
+    rbsp += (char)5;  // payload type: user_data_unregistered
+    size_t size = sizeof(RtspStreamer::kSeiUuid) + payload.size();
+    for (; size >= 255; size -= 255) {
+        rbsp += (char)0xff;
+    }
+    rbsp += (char)size;
+    rbsp.append((const char*)RtspStreamer::kSeiUuid, sizeof(RtspStreamer::kSeiUuid));
+    rbsp += payload;
+    rbsp += (char)0x80;  // rbsp_trailing_bits
+
+    nal.assign("\0\0\0\1", 4);
+    if (h265) {
+        nal += (char)(39 << 1);  // PREFIX_SEI_NUT
+        nal += (char)1;
+    } else {
+        nal += (char)6;
+    }
+
+    // Emulation prevention: no 00 00 0x (x <= 3) inside the NAL unit
+    int zeros = 0;
+    for (char c : rbsp) {
+        if (zeros >= 2 && (unsigned char)c <= 3) {
+            nal += (char)3;
+            zeros = 0;
+        }
+        nal += c;
+        zeros = (c == 0) ? zeros + 1 : 0;
+    }
+}
+
+/**
+ * @brief Find the first slice NAL unit of an Annex B access unit
+ * @return Offset of its start code, or size if there is none
+ */
+static size_t findFirstSlice(const guint8* data, size_t size, bool h265) {
+    for (size_t i = 0; i + 3 < size; i++) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) continue;
+
+        const guint8 header = data[i + 3];
+        const int type = h265 ? (header >> 1) & 0x3f : header & 0x1f;
+        const bool slice = h265 ? type < 32 : (type >= 1 && type <= 5);
+        if (slice) {
+            return (i > 0 && data[i - 1] == 0) ? i - 1 : i;
+        }
+        i += 2;
+    }
+    return size;
+}
+
+/**
+ * @brief Convert a BGR image into I420 or NV12 buffer memory
+ * @param bgr Source image, already at the stream size
+ * @param info Video info describing the buffer layout
+ * @param format GST_VIDEO_FORMAT_I420 or GST_VIDEO_FORMAT_NV12
+ * @param data Mapped buffer memory
+ */
+static void writeYuvFrame(const cv::Mat& bgr, const GstVideoInfo& info, GstVideoFormat format, guint8* data) {
+    const int width = bgr.cols;
+    const int height = bgr.rows;
+    const int chroma_width = width / 2;
+    const int chroma_height = height / 2;
+    
+    // Tightly packed I420 is exactly OpenCV's layout, so convert in place
+    if (format == GST_VIDEO_FORMAT_I420 &&
+        GST_VIDEO_INFO_PLANE_STRIDE(&info, 0) == width &&
+        GST_VIDEO_INFO_PLANE_STRIDE(&info, 1) == chroma_width &&
+        GST_VIDEO_INFO_PLANE_STRIDE(&info, 2) == chroma_width &&
+        GST_VIDEO_INFO_PLANE_OFFSET(&info, 1) == GST_VIDEO_INFO_PLANE_OFFSET(&info, 0) + (gsize)width * height &&
+        GST_VIDEO_INFO_PLANE_OFFSET(&info, 2) == GST_VIDEO_INFO_PLANE_OFFSET(&info, 1) + (gsize)chroma_width * chroma_height) {
+        cv::Mat yuv(height * 3 / 2, width, CV_8UC1, data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 0));
+        cv::cvtColor(bgr, yuv, cv::COLOR_BGR2YUV_I420);
+        return;
+    }
+    
+    thread_local cv::Mat yuv;
+    cv::cvtColor(bgr, yuv, cv::COLOR_BGR2YUV_I420);
+    
+    const guint8* src_y = yuv.data;
+    const guint8* src_u = src_y + width * height;
+    const guint8* src_v = src_u + chroma_width * chroma_height;
+    
+    guint8* dst_y = data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 0);
+    for (int row = 0; row < height; row++) {
+        memcpy(dst_y + row * GST_VIDEO_INFO_PLANE_STRIDE(&info, 0), src_y + row * width, width);
+    }
+    
+    if (format == GST_VIDEO_FORMAT_NV12) {
+        guint8* dst_uv = data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 1);
+        for (int row = 0; row < chroma_height; row++) {
+            guint8* uv = dst_uv + row * GST_VIDEO_INFO_PLANE_STRIDE(&info, 1);
+            const guint8* u = src_u + row * chroma_width;
+            const guint8* v = src_v + row * chroma_width;
+            for (int col = 0; col < chroma_width; col++) {
+                uv[2 * col] = u[col];
+                uv[2 * col + 1] = v[col];
+            }
+        }
+    } else {
+        guint8* dst_u = data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 1);
+        guint8* dst_v = data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 2);
+        for (int row = 0; row < chroma_height; row++) {
+            memcpy(dst_u + row * GST_VIDEO_INFO_PLANE_STRIDE(&info, 1), src_u + row * chroma_width, chroma_width);
+            memcpy(dst_v + row * GST_VIDEO_INFO_PLANE_STRIDE(&info, 2), src_v + row * chroma_width, chroma_width);
+        }
+    }
+}
 
 RtspStreamer::RtspStreamer() 
-    : port_(8554), width_(640), height_(480), fps_(30),
-      server_(nullptr), loop_(nullptr),
-      factory_(nullptr),
+    : port_(8554), bitrate_scale_(1.f),
+      raw_format_(GST_VIDEO_FORMAT_I420), clock_(nullptr), clock_offset_(0),
+      protocols_(GST_RTSP_LOWER_TRANS_TCP), address_pool_(nullptr), client_count_(0),
+      server_(nullptr), loop_(nullptr), pin_stopping_(false),
       server_running_(false), initialized_(false) {
     // Default values will be overridden in initialize() method with config values
 }
 
 RtspStreamer::~RtspStreamer() {
     stop();
+    
+    for (auto& stream : streams_) {
+        if (stream->buffer_pool) {
+            gst_buffer_pool_set_active(stream->buffer_pool, FALSE);
+            gst_object_unref(stream->buffer_pool);
+            stream->buffer_pool = nullptr;
+        }
+    }
+    
+    if (address_pool_) {
+        g_object_unref(address_pool_);
+        address_pool_ = nullptr;
+    }
+    
+    if (clock_) {
+        gst_object_unref(clock_);
+        clock_ = nullptr;
+    }
 }
 
-bool RtspStreamer::initialize(const std::string& rtsp_url, int width, int height, int fps, int port) {
-    width_ = width;
-    height_ = height;
-    fps_ = fps;
+bool RtspStreamer::initialize(int port, const VideoEncoderSettings& encoder, const RtspTransportSettings& transport) {
     port_ = port;
     
     // Initialize GStreamer
     gst_init(nullptr, nullptr);
     
-    if (!setupRtspServer()) {
+    // Capture timestamps and the media pipelines share the system clock
+    if (!clock_) {
+        clock_ = gst_system_clock_obtain();
+        const auto steady_now = std::chrono::steady_clock::now().time_since_epoch();
+        clock_offset_ = (GstClockTimeDiff)gst_clock_get_time(clock_) -
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(steady_now).count();
+    }
+    
+    if (!selectEncoder(encoder)) {
+        return false;
+    }
+    
+    if (!setupTransports(transport) || !setupRtspServer()) {
         return false;
     }
     
     initialized_ = true;
-    std::cout << "Direct RTSP Server initialized" << std::endl;
-    std::cout << "Resolution: " << width_ << "x" << height_ << " @ " << fps_ << "fps" << std::endl;
-    std::cout << "RTSP URL: " << getStreamUrl() << std::endl;
+    std::cout << "Direct RTSP Server initialized on port " << port_ << std::endl;
     
     return true;
 }
@@ -57,37 +229,346 @@ bool RtspStreamer::setupRtspServer() {
     gst_rtsp_server_set_address(server_, "0.0.0.0");  // Bind to all interfaces like simple_rtsp_test
     gst_rtsp_server_set_service(server_, std::to_string(port_).c_str());
     
+    if (transport_settings_.max_clients > 0) {
+        GstRTSPSessionPool* sessions = gst_rtsp_server_get_session_pool(server_);
+        gst_rtsp_session_pool_set_max_sessions(sessions, transport_settings_.max_clients);
+        g_object_unref(sessions);
+    }
+    
+    g_signal_connect(server_, "client-connected", G_CALLBACK(onClientConnected), this);
+    
+    return true;
+}
+
+bool RtspStreamer::setupTransports(const RtspTransportSettings& settings) {
+    transport_settings_ = settings;
+    
+    int protocols = 0;
+    std::stringstream list(settings.protocols);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (name == "tcp") {
+            protocols |= GST_RTSP_LOWER_TRANS_TCP;
+        } else if (name == "udp") {
+            protocols |= GST_RTSP_LOWER_TRANS_UDP;
+        } else if (name == "udp-mcast" || name == "multicast") {
+            protocols |= GST_RTSP_LOWER_TRANS_UDP_MCAST;
+        } else if (!name.empty()) {
+            std::cerr << "Unknown RTSP transport '" << name << "' ignored" << std::endl;
+        }
+    }
+    if (protocols == 0) {
+        std::cerr << "No valid RTSP transport in '" << settings.protocols << "', using tcp" << std::endl;
+        protocols = GST_RTSP_LOWER_TRANS_TCP;
+    }
+    protocols_ = (GstRTSPLowerTrans)protocols;
+    
+    if (protocols_ & GST_RTSP_LOWER_TRANS_UDP_MCAST) {
+        // "first-last", or a single group
+        const size_t dash = settings.multicast_range.find('-');
+        const std::string first = settings.multicast_range.substr(0, dash);
+        const std::string last = (dash == std::string::npos) ? first : settings.multicast_range.substr(dash + 1);
+        
+        address_pool_ = gst_rtsp_address_pool_new();
+        if (!gst_rtsp_address_pool_add_range(address_pool_, first.c_str(), last.c_str(),
+                                             (guint16)settings.multicast_port_min, (guint16)settings.multicast_port_max,
+                                             (guint8)std::max(1, settings.multicast_ttl))) {
+            std::cerr << "Invalid RTSP multicast range " << settings.multicast_range << " ports "
+                      << settings.multicast_port_min << "-" << settings.multicast_port_max << std::endl;
+            g_object_unref(address_pool_);
+            address_pool_ = nullptr;
+            return false;
+        }
+    }
+    
+    std::cout << "RTSP transports: " << settings.protocols;
+    if (address_pool_) {
+        std::cout << " (multicast " << settings.multicast_range << ", ttl " << settings.multicast_ttl << ")";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+void RtspStreamer::onClientConnected(GstRTSPServer* server, GstRTSPClient* client, gpointer user_data) {
+    RtspStreamer* streamer = static_cast<RtspStreamer*>(user_data);
+    
+    streamer->client_count_++;
+    g_signal_connect(client, "closed", G_CALLBACK(onClientClosed), user_data);
+    
+    // Bounds the data queued in the kernel for one TCP client, so a slow viewer backs up sooner
+    // instead of buffering seconds of video
+    if (streamer->transport_settings_.client_send_buffer_kb > 0) {
+        GstRTSPConnection* connection = gst_rtsp_client_get_connection(client);
+        GSocket* socket = connection ? gst_rtsp_connection_get_write_socket(connection) : nullptr;
+        if (socket) {
+            g_socket_set_option(socket, SOL_SOCKET, SO_SNDBUF, streamer->transport_settings_.client_send_buffer_kb * 1024, NULL);
+        }
+    }
+}
+
+void RtspStreamer::onClientClosed(GstRTSPClient* client, gpointer user_data) {
+    static_cast<RtspStreamer*>(user_data)->client_count_--;
+}
+
+bool RtspStreamer::isElementAvailable(const std::string& name) {
+    GstElementFactory* factory = gst_element_factory_find(name.c_str());
+    if (!factory) {
+        return false;
+    }
+    gst_object_unref(factory);
+    return true;
+}
+
+bool RtspStreamer::selectEncoder(const VideoEncoderSettings& settings) {
+    encoder_settings_ = settings;
+    codec_ = (settings.codec == "h265" || settings.codec == "hevc") ? "h265" : "h264";
+    
+    // An explicitly configured encoder wins if it is installed
+    if (!settings.encoder.empty() && settings.encoder != "auto") {
+        if (isElementAvailable(settings.encoder)) {
+            encoder_element_ = settings.encoder;
+            raw_format_ = GST_VIDEO_FORMAT_I420;
+            for (const auto& profile : encoder_profiles) {
+                if (settings.encoder == profile.element) {
+                    codec_ = profile.codec;
+                    raw_format_ = profile.format;
+                }
+            }
+            std::cout << "Using configured encoder: " << encoder_element_ << std::endl;
+            return true;
+        }
+        std::cerr << "Encoder " << settings.encoder << " not available, probing for another " << codec_ << " encoder" << std::endl;
+    }
+    
+    for (const auto& profile : encoder_profiles) {
+        if (codec_ != profile.codec) continue;
+        if (!isElementAvailable(profile.element)) continue;
+        if (profile.helper && !isElementAvailable(profile.helper)) continue;
+        
+        encoder_element_ = profile.element;
+        raw_format_ = profile.format;
+        std::cout << "Selected encoder: " << encoder_element_ << " (" << gst_video_format_to_string(raw_format_) << " input)" << std::endl;
+        return true;
+    }
+    
+    std::cerr << "No " << codec_ << " encoder available" << std::endl;
+    return false;
+}
+
+std::string RtspStreamer::buildEncoderLaunch(int stream_bitrate_kbps) const {
+    const int bitrate_kbps = std::max(1, stream_bitrate_kbps);
+    const int keyframe_interval = std::max(1, encoder_settings_.keyframe_interval);
+    const std::string& element = encoder_element_;
+    
+    std::ostringstream launch;
+    if (element == "x264enc" || element == "x265enc") {
+        launch << element << " name=enc tune=zerolatency speed-preset=ultrafast bitrate=" << bitrate_kbps
+               << " key-int-max=" << keyframe_interval;
+    } else if (element.compare(0, 5, "vaapi") == 0) {
+        launch << element << " name=enc rate-control=cbr bitrate=" << bitrate_kbps << " keyframe-period=" << keyframe_interval;
+    } else if (element.compare(0, 6, "nvv4l2") == 0) {
+        launch << "nvvidconv ! video/x-raw(memory:NVMM),format=NV12 ! "
+               << element << " name=enc bitrate=" << bitrate_kbps * 1000 << " iframeinterval=" << keyframe_interval
+               << " insert-sps-pps=true";
+    } else if (element == "v4l2h264enc") {
+        launch << element << " name=enc extra-controls=\"controls,video_bitrate=" << bitrate_kbps * 1000
+               << ",h264_i_frame_period=" << keyframe_interval << "\" ! video/x-h264,level=(string)4";
+    } else if (element == "v4l2h265enc") {
+        launch << element << " name=enc extra-controls=\"controls,video_bitrate=" << bitrate_kbps * 1000 << "\"";
+    } else {
+        // Unknown element configured by the user: run it with its defaults
+        launch << element << " name=enc";
+    }
+    
+    // SEI insertion parses Annex B start codes, one access unit per buffer
+    if (encoder_settings_.sei_metadata) {
+        launch << " ! video/x-" << codec_ << ",stream-format=byte-stream,alignment=au";
+    }
+    
+    launch << " ! " << (codec_ == "h265" ? "rtph265pay" : "rtph264pay") << " name=pay0 pt=96 config-interval=-1";
+    return launch.str();
+}
+
+void RtspStreamer::applyBitrate(GstElement* encoder, int stream_bitrate_kbps) const {
+    const int bitrate_kbps = std::max(1, stream_bitrate_kbps);
+    const std::string& element = encoder_element_;
+    
+    // Same units as buildEncoderLaunch(); the encoders pick these up between frames
+    if (element == "x264enc" || element == "x265enc" || element.compare(0, 5, "vaapi") == 0) {
+        g_object_set(G_OBJECT(encoder), "bitrate", (guint)bitrate_kbps, NULL);
+    } else if (element.compare(0, 6, "nvv4l2") == 0) {
+        g_object_set(G_OBJECT(encoder), "bitrate", (guint)(bitrate_kbps * 1000), NULL);
+    } else if (element.compare(0, 4, "v4l2") == 0) {
+        GstStructure* controls = gst_structure_new("controls", "video_bitrate", G_TYPE_INT, bitrate_kbps * 1000, NULL);
+        g_object_set(G_OBJECT(encoder), "extra-controls", controls, NULL);
+        gst_structure_free(controls);
+    }
+}
+
+void RtspStreamer::setBitrate(int bitrate_kbps) {
+    if (bitrate_kbps <= 0 || bitrate_kbps == encoder_settings_.bitrate_kbps) {
+        return;
+    }
+    encoder_settings_.bitrate_kbps = bitrate_kbps;
+    
+    for (auto& stream : streams_) {
+        if (stream->default_bitrate) {
+            stream->base_bitrate_kbps = bitrate_kbps;
+        }
+    }
+    updateBitrates();
+    std::cout << "RTSP bitrate set to " << bitrate_kbps << " kbit/s" << std::endl;
+}
+
+void RtspStreamer::setBitrateScale(float scale) {
+    scale = std::max(0.f, std::min(1.f, scale));
+    if (scale == bitrate_scale_) {
+        return;
+    }
+    bitrate_scale_ = scale;
+    updateBitrates();
+}
+
+void RtspStreamer::updateBitrates() {
+    for (auto& stream : streams_) {
+        const int base = stream->base_bitrate_kbps;
+        const int bitrate_kbps = bitrate_scale_ < 1.f ? std::max(std::min(base, 200), (int)(base * bitrate_scale_)) : base;
+        if (bitrate_kbps == stream->bitrate_kbps) {
+            continue;
+        }
+        stream->bitrate_kbps = bitrate_kbps;
+        
+        // The next pipeline of the factory starts at the new rate
+        const std::string pipeline_description = stream->source_launch + buildEncoderLaunch(bitrate_kbps) + " )";
+        gst_rtsp_media_factory_set_launch(stream->factory, pipeline_description.c_str());
+        
+        std::lock_guard<std::mutex> lock(stream->appsrc_mutex);
+        if (stream->encoder) {
+            applyBitrate(stream->encoder, bitrate_kbps);
+        }
+    }
+}
+
+int RtspStreamer::addStream(const std::string& mount, int width, int height, int fps, int bitrate_kbps) {
+    if (!server_) {
+        std::cerr << "RTSP server not initialized" << std::endl;
+        return -1;
+    }
+    
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->mount = mount;
+    stream->width = width;
+    stream->height = height;
+    stream->fps = fps;
+    stream->base_bitrate_kbps = bitrate_kbps > 0 ? bitrate_kbps : encoder_settings_.bitrate_kbps;
+    stream->bitrate_kbps = stream->base_bitrate_kbps;
+    stream->default_bitrate = bitrate_kbps <= 0;
+    stream->encoder = nullptr;
+    stream->pinned_media = nullptr;
+    stream->frame_count = 0;
+    stream->waiting_for_client = false;
+    stream->last_flow = GST_FLOW_OK;
+    stream->successful_pushes = 0;
+    stream->last_pts = GST_CLOCK_TIME_NONE;
+    stream->last_base_time = GST_CLOCK_TIME_NONE;
+    stream->sequence = 0;
+    stream->accepting = false;
+    stream->dropped_frames = 0;
+    stream->clock = clock_;
+    stream->base_time = 0;
+    stream->last_measured_pts = GST_CLOCK_TIME_NONE;
+    stream->latency_sum_ns = 0;
+    stream->latency_max_ns = 0;
+    stream->latency_count = 0;
+    stream->h265 = (codec_ == "h265");
+    stream->queue_frames = std::max(1, encoder_settings_.queue_frames);
+    stream->buffer_pool = nullptr;
+    
+    // 4:2:0 formats need even dimensions; fall back to BGR and videoconvert otherwise
+    stream->format = raw_format_;
+    if (stream->format != GST_VIDEO_FORMAT_BGR && (width % 2 != 0 || height % 2 != 0)) {
+        std::cout << "Odd frame size " << width << "x" << height << " for " << mount << ", streaming BGR" << std::endl;
+        stream->format = GST_VIDEO_FORMAT_BGR;
+    }
+    
+    if (!setupBufferPool(*stream)) {
+        return -1;
+    }
+    
     // Get mount points
     GstRTSPMountPoints* mounts = gst_rtsp_server_get_mount_points(server_);
     
     // Create media factory for appsrc input
-    factory_ = gst_rtsp_media_factory_new();
+    stream->factory = gst_rtsp_media_factory_new();
     
     // Pipeline similar to simple_rtsp_test but with appsrc instead of videotestsrc
-    std::string pipeline_description = 
+    stream->source_launch =
         "( appsrc name=mysrc is-live=true "
-        "caps=video/x-raw,format=BGR,width=" + std::to_string(width_) + 
-        ",height=" + std::to_string(height_) + 
-        ",framerate=" + std::to_string(fps_) + "/1 ! "
-        "videoconvert ! "
-        "x264enc tune=zerolatency speed-preset=ultrafast bitrate=1000 ! "
-        "rtph264pay name=pay0 pt=96 )";
+        "caps=video/x-raw,format=" + std::string(gst_video_format_to_string(stream->format)) +
+        ",width=" + std::to_string(width) + 
+        ",height=" + std::to_string(height) + 
+        ",framerate=" + std::to_string(fps) + "/1 ! " +
+        (stream->format == GST_VIDEO_FORMAT_BGR ? "videoconvert ! " : "");
+    std::string pipeline_description = stream->source_launch + buildEncoderLaunch(stream->bitrate_kbps) + " )";
     
-    std::cout << "RTSP Pipeline: " << pipeline_description << std::endl;
+    std::cout << "RTSP Pipeline [" << mount << "]: " << pipeline_description << std::endl;
     
-    gst_rtsp_media_factory_set_launch(factory_, pipeline_description.c_str());
+    gst_rtsp_media_factory_set_launch(stream->factory, pipeline_description.c_str());
     
     // Match simple_rtsp_test settings exactly
-    gst_rtsp_media_factory_set_shared(factory_, TRUE);  // Share pipeline like simple_rtsp_test
-    gst_rtsp_media_factory_set_protocols(factory_, GST_RTSP_LOWER_TRANS_TCP);  // TCP only like simple_rtsp_test
+    gst_rtsp_media_factory_set_shared(stream->factory, TRUE);  // Share pipeline like simple_rtsp_test
+    gst_rtsp_media_factory_set_protocols(stream->factory, protocols_);
+    if (address_pool_) {
+        gst_rtsp_media_factory_set_address_pool(stream->factory, address_pool_);
+    }
+    if (transport_settings_.client_send_buffer_kb > 0) {
+        gst_rtsp_media_factory_set_buffer_size(stream->factory, transport_settings_.client_send_buffer_kb * 1024);  // UDP sinks
+    }
     
     // Connect media constructed signal to get appsrc element
-    g_signal_connect(factory_, "media-constructed", G_CALLBACK(onMediaConstructed), this);
+    g_signal_connect(stream->factory, "media-constructed", G_CALLBACK(onMediaConstructed), stream.get());
     
-    // Mount the stream
-    gst_rtsp_mount_points_add_factory(mounts, "/stream", factory_);
+    // Mount the stream (the mount points take ownership of the factory)
+    gst_rtsp_mount_points_add_factory(mounts, mount.c_str(), stream->factory);
     g_object_unref(mounts);
     
+    streams_.push_back(std::move(stream));
+    
+    std::cout << "RTSP stream added: " << getStreamUrl((int)streams_.size() - 1)
+              << " (" << width << "x" << height << " @ " << fps << "fps, " << streams_.back()->bitrate_kbps << " kbps)" << std::endl;
+    
+    return (int)streams_.size() - 1;
+}
+
+bool RtspStreamer::setupBufferPool(Stream& stream) {
+    gst_video_info_init(&stream.video_info);
+    if (!gst_video_info_set_format(&stream.video_info, stream.format, stream.width, stream.height)) {
+        std::cerr << "Invalid frame size for " << stream.mount << ": " << stream.width << "x" << stream.height << std::endl;
+        return false;
+    }
+    
+    stream.buffer_pool = gst_video_buffer_pool_new();
+    if (!stream.buffer_pool) {
+        std::cerr << "Failed to create buffer pool for " << stream.mount << std::endl;
+        return false;
+    }
+    
+    // Keep a few buffers preallocated; the pool grows if appsrc holds on to more
+    GstCaps* caps = gst_video_info_to_caps(&stream.video_info);
+    GstStructure* config = gst_buffer_pool_get_config(stream.buffer_pool);
+    gst_buffer_pool_config_set_params(config, caps, GST_VIDEO_INFO_SIZE(&stream.video_info), 4, 0);
+    gst_caps_unref(caps);
+    
+    if (!gst_buffer_pool_set_config(stream.buffer_pool, config) ||
+        !gst_buffer_pool_set_active(stream.buffer_pool, TRUE)) {
+        std::cerr << "Failed to activate buffer pool for " << stream.mount << std::endl;
+        gst_object_unref(stream.buffer_pool);
+        stream.buffer_pool = nullptr;
+        return false;
+    }
+    
     return true;
 }
 
@@ -105,23 +586,129 @@ bool RtspStreamer::start() {
     }
     
     // Start server thread BEFORE attaching
+    std::promise<bool> started;
+    std::future<bool> started_result = started.get_future();
     server_running_ = true;
-    server_thread_ = std::thread(&RtspStreamer::serverLoop, this);
+    server_thread_ = std::thread(&RtspStreamer::serverLoop, this, std::move(started));
     
-    // Give server thread time to start
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Returns as soon as the loop dispatches instead of after a fixed delay
+    if (!started_result.get()) {
+        server_thread_.join();
+        server_running_ = false;
+        g_main_loop_unref(loop_);
+        loop_ = nullptr;
+        return false;
+    }
     
     std::cout << "RTSP server thread started" << std::endl;
     
     std::cout << "Direct RTSP Server started successfully" << std::endl;
-    std::cout << "Stream URL: " << getStreamUrl() << std::endl;
-    std::cout << "VLC: Media > Open Network Stream > " << getStreamUrl() << std::endl;
+    for (size_t i = 0; i < streams_.size(); i++) {
+        std::cout << "Stream URL: " << getStreamUrl((int)i) << std::endl;
+    }
+    if (!streams_.empty()) {
+        std::cout << "VLC: Media > Open Network Stream > " << getStreamUrl() << std::endl;
+    }
+    
+    for (const auto& stream : streams_) {
+        if (stream->recorder) {
+            std::promise<void> done;
+            pin_done_ = done.get_future();
+            pin_stopping_ = false;
+            pin_thread_ = std::thread(&RtspStreamer::pinRecordedMedia, this, std::move(done));
+            break;
+        }
+    }
     
     return true;
 }
 
+ClipRecorder* RtspStreamer::enableClipRecording(int stream_index, const ClipRecorderSettings& settings, const std::string& name) {
+    if (stream_index < 0 || stream_index >= (int)streams_.size() || server_running_) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<ClipRecorder> recorder(new ClipRecorder());
+    if (!recorder->start(settings, name)) {
+        return nullptr;
+    }
+    streams_[stream_index]->recorder = std::move(recorder);
+    return streams_[stream_index]->recorder.get();
+}
+
+void RtspStreamer::pinRecordedMedia(std::promise<void> done) {
+    setCurrentThreadName("rtsp-pin");
+    
+    for (auto& stream : streams_) {
+        if (!stream->recorder) continue;
+        
+        // Same URL key as the clients, so they join this media instead of building their own
+        const std::string url_text = "rtsp://127.0.0.1:" + std::to_string(port_) + stream->mount;
+        GstRTSPUrl* url = nullptr;
+        if (gst_rtsp_url_parse(url_text.c_str(), &url) != GST_RTSP_OK) {
+            continue;
+        }
+        GstRTSPMedia* media = gst_rtsp_media_factory_construct(stream->factory, url);
+        gst_rtsp_url_free(url);
+        if (!media) {
+            std::cerr << "Failed to construct the recording pipeline of " << stream->mount << std::endl;
+            continue;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(pin_mutex_);
+            if (pin_stopping_) {
+                g_object_unref(media);
+                break;
+            }
+            stream->pinned_media = media;
+        }
+        
+        // Holds a prepare count on the shared media: it keeps running when the last client leaves
+        GstRTSPThreadPool* pool = gst_rtsp_server_get_thread_pool(server_);
+        GstRTSPThread* thread = gst_rtsp_thread_pool_get_thread(pool, GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+        g_object_unref(pool);
+        if (gst_rtsp_media_prepare(media, thread)) {
+            std::cout << "Recording pipeline running for " << stream->mount << std::endl;
+        } else {
+            std::cerr << "Failed to start the recording pipeline of " << stream->mount << std::endl;
+        }
+    }
+    done.set_value();
+}
+
+void RtspStreamer::unpinRecordedMedia() {
+    if (!pin_thread_.joinable()) return;
+    
+    // A prepare still waiting for its first frame only returns once the media is unprepared
+    {
+        std::lock_guard<std::mutex> lock(pin_mutex_);
+        pin_stopping_ = true;
+    }
+    while (pin_done_.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+        std::lock_guard<std::mutex> lock(pin_mutex_);
+        for (auto& stream : streams_) {
+            if (stream->pinned_media) gst_rtsp_media_unprepare(stream->pinned_media);
+        }
+    }
+    pin_thread_.join();
+    
+    for (auto& stream : streams_) {
+        if (stream->pinned_media) {
+            gst_rtsp_media_unprepare(stream->pinned_media);
+            g_object_unref(stream->pinned_media);
+            stream->pinned_media = nullptr;
+        }
+        if (stream->recorder) {
+            stream->recorder->stop();
+        }
+    }
+}
+
 void RtspStreamer::stop() {
     if (server_running_) {
+        // Recorded pipelines go down while the loop still runs, then the recorders write what they have
+        unpinRecordedMedia();
         server_running_ = false;
         
         // Stop main loop
@@ -133,15 +720,19 @@ void RtspStreamer::stop() {
             server_thread_.join();
         }
         
-        // Cleanup appsrc list
-        {
-            std::lock_guard<std::mutex> lock(appsrc_mutex_);
-            for (auto appsrc : appsrc_list_) {
+        // Cleanup appsrc lists
+        for (auto& stream : streams_) {
+            std::lock_guard<std::mutex> lock(stream->appsrc_mutex);
+            for (auto appsrc : stream->appsrc_list) {
                 if (appsrc) {
                     gst_object_unref(appsrc);
                 }
             }
-            appsrc_list_.clear();
+            stream->appsrc_list.clear();
+            if (stream->encoder) {
+                gst_object_unref(stream->encoder);
+                stream->encoder = nullptr;
+            }
         }
         
         if (loop_) {
@@ -158,9 +749,17 @@ void RtspStreamer::stop() {
     }
 }
 
-void RtspStreamer::serverLoop() {
+gboolean RtspStreamer::onLoopStarted(gpointer user_data) {
+    static_cast<std::promise<bool>*>(user_data)->set_value(true);
+    return G_SOURCE_REMOVE;
+}
+
+void RtspStreamer::serverLoop(std::promise<bool> started) {
+    setCurrentThreadName("rtsp-server");
+
     if (!loop_) {
         std::cerr << "No main loop available" << std::endl;
+        started.set_value(false);
         return;
     }
     
@@ -171,6 +770,7 @@ void RtspStreamer::serverLoop() {
     guint server_id = gst_rtsp_server_attach(server_, context);
     if (server_id == 0) {
         std::cerr << "Failed to attach RTSP server in thread" << std::endl;
+        started.set_value(false);
         return;
     }
     
@@ -178,118 +778,227 @@ void RtspStreamer::serverLoop() {
     std::cout << "RTSP server loop started" << std::endl;
     server_running_ = true;
     
+    // Reported from inside the loop, so stop() never quits a loop that has not started running
+    g_idle_add(&RtspStreamer::onLoopStarted, &started);
+    
     // Run the main loop (this will block until quit)
     g_main_loop_run(loop_);
     
     std::cout << "RTSP server loop ended" << std::endl;
 }
 
-bool RtspStreamer::pushFrame(const cv::Mat& frame) {
-    static int frame_count = 0;
-    static int last_log_count = 0;
-    static int successful_pushes = 0;
+bool RtspStreamer::acquireFrame(int stream_index, OutputFrame& frame, const cv::Mat& source) {
+    releaseFrame(frame);
     
-    if (!server_running_) {
+    if (stream_index < 0 || stream_index >= (int)streams_.size() || !streams_[stream_index]->buffer_pool) {
         return false;
     }
     
-    // Get the shared appsrc
-    GstElement* current_appsrc = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(appsrc_mutex_);
-        if (appsrc_list_.empty()) {
-            if (frame_count % 100 == 0) { // Log every 100 frames when no clients
-                std::cout << "[RTSP DEBUG] Waiting for RTSP client connection (frames queued: " << frame_count << ")" << std::endl;
-            }
-            frame_count++;
-            return true; // No clients connected
+    Stream& stream = *streams_[stream_index];
+    
+    GstBuffer* buffer = nullptr;
+    if (gst_buffer_pool_acquire_buffer(stream.buffer_pool, &buffer, NULL) != GST_FLOW_OK || !buffer) {
+        std::cerr << "Failed to acquire pooled GstBuffer for " << stream.mount << std::endl;
+        return false;
+    }
+    
+    if (!gst_buffer_map(buffer, &frame.map, GST_MAP_WRITE)) {
+        gst_buffer_unref(buffer);
+        std::cerr << "Failed to map GstBuffer" << std::endl;
+        return false;
+    }
+    
+    frame.buffer = buffer;
+    if (stream.format == GST_VIDEO_FORMAT_BGR) {
+        frame.image = cv::Mat(stream.height, stream.width, CV_8UC3,
+                              frame.map.data + GST_VIDEO_INFO_PLANE_OFFSET(&stream.video_info, 0),
+                              GST_VIDEO_INFO_PLANE_STRIDE(&stream.video_info, 0));
+    }
+    
+    if (!source.empty()) {
+        // Ensure BGR format (OpenCV default)
+        cv::Mat bgr_source;
+        if (source.channels() == 4) {
+            cv::cvtColor(source, bgr_source, cv::COLOR_BGRA2BGR);
+        } else if (source.channels() == 1) {
+            cv::cvtColor(source, bgr_source, cv::COLOR_GRAY2BGR);
+        } else {
+            bgr_source = source;
         }
         
-        current_appsrc = appsrc_list_[0];  // Use first (and only) appsrc
-        gst_object_ref(current_appsrc);
+        // Downscaled substreams average source pixels instead of skipping them
+        const cv::Size stream_size(stream.width, stream.height);
+        const int interpolation = (stream_size.width < bgr_source.cols) ? cv::INTER_AREA : cv::INTER_LINEAR;
+        if (stream.format == GST_VIDEO_FORMAT_BGR) {
+            // Both write straight into the mapped buffer since size and type already match
+            if (bgr_source.size() == stream_size) {
+                bgr_source.copyTo(frame.image);
+            } else {
+                cv::resize(bgr_source, frame.image, stream_size, 0, 0, interpolation);
+            }
+        } else {
+            cv::Mat sized_source = bgr_source;
+            if (bgr_source.size() != stream_size) {
+                cv::resize(bgr_source, stream.scaled, stream_size, 0, 0, interpolation);
+                sized_source = stream.scaled;
+            }
+            writeYuvFrame(sized_source, stream.video_info, stream.format, frame.map.data);
+        }
     }
     
-    // Resize frame if necessary (outside of mutex for better performance)
-    cv::Mat resized_frame;
-    if (frame.cols != width_ || frame.rows != height_) {
-        cv::resize(frame, resized_frame, cv::Size(width_, height_));
-    } else {
-        resized_frame = frame;
+    return true;
+}
+
+void RtspStreamer::releaseFrame(OutputFrame& frame) {
+    frame.image.release();
+    if (frame.buffer) {
+        gst_buffer_unmap(frame.buffer, &frame.map);
+        gst_buffer_unref(frame.buffer);
+        frame.buffer = nullptr;
+    }
+}
+
+bool RtspStreamer::pushFrame(OutputFrame& frame, int stream_index, const std::string& metadata,
+                             GstClockTime capture_time) {
+    if (!frame.buffer) {
+        return false;
     }
     
-    // Ensure BGR format (OpenCV default)
-    cv::Mat bgr_frame;
-    if (resized_frame.channels() == 4) {
-        cv::cvtColor(resized_frame, bgr_frame, cv::COLOR_BGRA2BGR);
-    } else if (resized_frame.channels() == 1) {
-        cv::cvtColor(resized_frame, bgr_frame, cv::COLOR_GRAY2BGR);
-    } else {
-        bgr_frame = resized_frame;
+    // Hand the buffer over; the Mat view must not outlive the mapping
+    frame.image.release();
+    gst_buffer_unmap(frame.buffer, &frame.map);
+    GstBuffer* buffer = frame.buffer;
+    frame.buffer = nullptr;
+    
+    if (!server_running_ || stream_index < 0 || stream_index >= (int)streams_.size()) {
+        gst_buffer_unref(buffer);
+        return false;
+    }
+    
+    return pushBuffer(*streams_[stream_index], buffer, metadata, capture_time);
+}
+
+bool RtspStreamer::pushFrame(const cv::Mat& frame, int stream_index, const std::string& metadata,
+                             GstClockTime capture_time) {
+    if (!server_running_ || stream_index < 0 || stream_index >= (int)streams_.size()) {
+        return false;
     }
     
     // Validate frame data
-    if (bgr_frame.empty() || bgr_frame.data == nullptr) {
+    if (frame.empty() || frame.data == nullptr) {
         std::cerr << "[RTSP ERROR] Invalid frame data" << std::endl;
-        gst_object_unref(current_appsrc);
         return false;
     }
     
-    // Create GstBuffer from OpenCV Mat
-    gsize buffer_size = bgr_frame.total() * bgr_frame.elemSize();
-    GstBuffer* buffer = gst_buffer_new_allocate(NULL, buffer_size, NULL);
+    // Skip the conversion of a frame nobody will take
+    if (!admitFrame(*streams_[stream_index])) {
+        return false;
+    }
     
-    if (!buffer) {
-        std::cerr << "Failed to allocate GstBuffer" << std::endl;
-        gst_object_unref(current_appsrc);
+    OutputFrame output;
+    if (!acquireFrame(stream_index, output, frame)) {
         return false;
     }
     
-    // Copy OpenCV data to GstBuffer
-    GstMapInfo map;
-    if (gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
-        memcpy(map.data, bgr_frame.data, buffer_size);
-        gst_buffer_unmap(buffer, &map);
-    } else {
+    return pushFrame(output, stream_index, metadata, capture_time);
+}
+
+bool RtspStreamer::admitFrame(int stream_index) {
+    if (!server_running_ || stream_index < 0 || stream_index >= (int)streams_.size()) {
+        return false;
+    }
+    return admitFrame(*streams_[stream_index]);
+}
+
+bool RtspStreamer::admitFrame(Stream& stream) {
+    if (stream.accepting) {
+        return true;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(stream.appsrc_mutex);
+        if (stream.appsrc_list.empty()) {
+            if (!stream.waiting_for_client) {
+                std::cout << "RTSP " << stream.mount << ": waiting for a client, frames are skipped" << std::endl;
+                stream.waiting_for_client = true;
+            }
+            stream.frame_count++;
+            return false;
+        }
+    }
+    
+    // enough-data: the encoder is behind, so drop the newest frame rather than queue it
+    stream.dropped_frames++;
+    stream.frame_count++;
+    return false;
+}
+
+bool RtspStreamer::pushBuffer(Stream& stream, GstBuffer* buffer, const std::string& metadata, GstClockTime capture_time) {
+    if (!admitFrame(stream)) {
         gst_buffer_unref(buffer);
-        std::cerr << "Failed to map GstBuffer" << std::endl;
-        gst_object_unref(current_appsrc);
         return false;
     }
     
-    // Set buffer timestamp
-    static GstClockTime timestamp = 0;
-    GST_BUFFER_PTS(buffer) = timestamp;
-    GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale_int(1, GST_SECOND, fps_);
-    timestamp += GST_BUFFER_DURATION(buffer);
+    // Get the shared appsrc
+    GstElement* current_appsrc = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(stream.appsrc_mutex);
+        if (stream.appsrc_list.empty()) {
+            gst_buffer_unref(buffer);
+            return false;  // Client left meanwhile
+        }
+        
+        current_appsrc = stream.appsrc_list[0];  // Use first (and only) appsrc
+        gst_object_ref(current_appsrc);
+    }
+    
+    // PTS = capture time in the running time of the (current) media pipeline
+    const GstClockTime base_time = gst_element_get_base_time(current_appsrc);
+    if (base_time != stream.last_base_time) {
+        stream.last_base_time = base_time;
+        stream.last_pts = GST_CLOCK_TIME_NONE;
+        stream.base_time = base_time;
+    }
+    if (!GST_CLOCK_TIME_IS_VALID(capture_time)) {
+        capture_time = gst_clock_get_time(clock_);
+    }
+    GstClockTime pts = (capture_time > base_time) ? capture_time - base_time : 0;
+    if (GST_CLOCK_TIME_IS_VALID(stream.last_pts) && pts <= stream.last_pts) {
+        pts = stream.last_pts + 1;  // keep PTS strictly increasing
+    }
+    stream.last_pts = pts;
+    GST_BUFFER_PTS(buffer) = pts;
+    GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale_int(1, GST_SECOND, stream.fps);
     
-    // Push buffer to shared appsrc
+    // The sequence number survives videoconvert; the encoder input probe maps it to the final PTS
+    GST_BUFFER_OFFSET(buffer) = stream.sequence++;
+    if (encoder_settings_.sei_metadata && !metadata.empty()) {
+        std::lock_guard<std::mutex> lock(stream.sei_mutex);
+        stream.sei_by_sequence[GST_BUFFER_OFFSET(buffer)] = metadata;
+        if (stream.sei_by_sequence.size() > kMaxPendingSei) {
+            stream.sei_by_sequence.erase(stream.sei_by_sequence.begin());
+        }
+    }
+    
+    // Push buffer to shared appsrc (takes ownership, returns it to the pool when done)
     GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(current_appsrc), buffer);
     
-    frame_count++;
+    stream.frame_count++;
     
     if (ret == GST_FLOW_OK) {
-        successful_pushes++;
+        stream.successful_pushes++;
     }
     
-    // Log frame push status periodically
-    if (frame_count - last_log_count >= 30) { // Log every 30 frames
-        std::cout << "[RTSP DEBUG] Pushed " << frame_count << " frames (" << successful_pushes << " successful) (flow: ";
-        switch (ret) {
-            case GST_FLOW_OK:
-                std::cout << "OK)";
-                break;
-            case GST_FLOW_NOT_LINKED:
-                std::cout << "NOT_LINKED)";
-                break;
-            case GST_FLOW_FLUSHING:
-                std::cout << "FLUSHING)";
-                break;
-            default:
-                std::cout << "ERROR " << ret << ")";
-                break;
-        }
-        std::cout << std::endl;
-        last_log_count = frame_count;
+    // Log only state changes, the push path runs for every frame
+    if (stream.waiting_for_client) {
+        std::cout << "RTSP " << stream.mount << ": client connected, pushing frames" << std::endl;
+        stream.waiting_for_client = false;
+    }
+    if (ret != stream.last_flow) {
+        std::cout << "RTSP " << stream.mount << ": push flow " << gst_flow_get_name(ret)
+                  << " (was " << gst_flow_get_name(stream.last_flow) << ", "
+                  << stream.successful_pushes << "/" << stream.frame_count << " pushes successful)" << std::endl;
+        stream.last_flow = ret;
     }
     
     // Release appsrc reference
@@ -298,15 +1007,63 @@ bool RtspStreamer::pushFrame(const cv::Mat& frame) {
     return (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED);
 }
 
-std::string RtspStreamer::getStreamUrl() const {
-    return "rtsp://localhost:" + std::to_string(port_) + "/stream";
+bool RtspStreamer::isBgrStream(int stream_index) const {
+    if (stream_index < 0 || stream_index >= (int)streams_.size()) {
+        return false;
+    }
+    return streams_[stream_index]->format == GST_VIDEO_FORMAT_BGR;
+}
+
+GstClockTime RtspStreamer::getClockTime() const {
+    return clock_ ? gst_clock_get_time(clock_) : GST_CLOCK_TIME_NONE;
+}
+
+GstClockTime RtspStreamer::toClockTime(std::chrono::steady_clock::time_point time) const {
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    return (GstClockTime)(since_epoch + clock_offset_);
+}
+
+bool RtspStreamer::getLatency(int stream_index, double& average_ms, double& max_ms) const {
+    if (stream_index < 0 || stream_index >= (int)streams_.size()) {
+        return false;
+    }
+    const Stream& stream = *streams_[stream_index];
+    const guint64 count = stream.latency_count;
+    if (count == 0) {
+        return false;
+    }
+    average_ms = (double)stream.latency_sum_ns / count / 1e6;
+    max_ms = (double)stream.latency_max_ns / 1e6;
+    return true;
+}
+
+int RtspStreamer::getDroppedFrames(int stream_index) const {
+    if (stream_index < 0 || stream_index >= (int)streams_.size()) {
+        return 0;
+    }
+    return streams_[stream_index]->dropped_frames;
+}
+
+cv::Size RtspStreamer::getStreamSize(int stream_index) const {
+    if (stream_index < 0 || stream_index >= (int)streams_.size()) {
+        return cv::Size();
+    }
+    return cv::Size(streams_[stream_index]->width, streams_[stream_index]->height);
+}
+
+std::string RtspStreamer::getStreamUrl(int stream) const {
+    std::string mount = "/stream";
+    if (stream >= 0 && stream < (int)streams_.size()) {
+        mount = streams_[stream]->mount;
+    }
+    return "rtsp://localhost:" + std::to_string(port_) + mount;
 }
 
 // Static callback functions
 void RtspStreamer::onMediaConstructed(GstRTSPMediaFactory* factory, GstRTSPMedia* media, gpointer user_data) {
-    RtspStreamer* streamer = static_cast<RtspStreamer*>(user_data);
+    Stream* stream = static_cast<Stream*>(user_data);
     
-    std::cout << "[RTSP DEBUG] Client connected, constructing media pipeline..." << std::endl;
+    std::cout << "[RTSP DEBUG] Client connected to " << stream->mount << ", constructing media pipeline..." << std::endl;
     
     // Get the pipeline element
     GstElement* element = gst_rtsp_media_get_element(media);
@@ -325,9 +1082,9 @@ void RtspStreamer::onMediaConstructed(GstRTSPMediaFactory* factory, GstRTSPMedia
     
     // For shared pipeline, we only need one appsrc
     {
-        std::lock_guard<std::mutex> lock(streamer->appsrc_mutex_);
-        if (streamer->appsrc_list_.empty()) {
-            streamer->appsrc_list_.push_back(new_appsrc);
+        std::lock_guard<std::mutex> lock(stream->appsrc_mutex);
+        if (stream->appsrc_list.empty()) {
+            stream->appsrc_list.push_back(new_appsrc);
             std::cout << "[RTSP DEBUG] First appsrc added to shared pipeline" << std::endl;
         } else {
             gst_object_unref(new_appsrc);  // Release extra reference
@@ -337,17 +1094,59 @@ void RtspStreamer::onMediaConstructed(GstRTSPMediaFactory* factory, GstRTSPMedia
     
     std::cout << "[RTSP DEBUG] appsrc element found successfully" << std::endl;
     
-    // Simple appsrc configuration
+    // Bounded, non-blocking queue; buffers carry their own capture-clock PTS.
+    // enough-data fires once max-bytes (queue_frames frames) are queued.
+    const guint64 max_bytes = (guint64)GST_VIDEO_INFO_SIZE(&stream->video_info) * stream->queue_frames;
     g_object_set(G_OBJECT(new_appsrc),
                  "is-live", TRUE,
                  "format", GST_FORMAT_TIME,
-                 "do-timestamp", TRUE,
+                 "do-timestamp", FALSE,
+                 "block", FALSE,
+                 "max-bytes", max_bytes,
                  NULL);
     
-    // Connect need-data signal (optional, for flow control)
+    // GStreamer >= 1.20: drop the oldest queued frame should the queue still overflow
+    if (g_object_class_find_property(G_OBJECT_GET_CLASS(new_appsrc), "leaky-type")) {
+        g_object_set(G_OBJECT(new_appsrc), "leaky-type", 2 /* GST_APP_LEAKY_TYPE_DOWNSTREAM */, NULL);
+    }
+    
+    // Flow control: frames are only pushed between need-data and enough-data
     g_signal_connect(new_appsrc, "need-data", G_CALLBACK(onNeedData), user_data);
     g_signal_connect(new_appsrc, "enough-data", G_CALLBACK(onEnoughData), user_data);
     
+    // Move each frame's SEI payload along with it through the encoder
+    GstElement* encoder = gst_bin_get_by_name_recurse_up(GST_BIN(element), "enc");
+    if (encoder) {
+        // Keep the shared pipeline's encoder for setBitrate()
+        {
+            std::lock_guard<std::mutex> lock(stream->appsrc_mutex);
+            if (!stream->encoder) {
+                stream->encoder = GST_ELEMENT(gst_object_ref(encoder));
+            }
+        }
+
+        GstPad* sink = gst_element_get_static_pad(encoder, "sink");
+        GstPad* src = gst_element_get_static_pad(encoder, "src");
+        if (sink && src) {
+            gst_pad_add_probe(sink, GST_PAD_PROBE_TYPE_BUFFER, onEncoderInput, user_data, NULL);
+            gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_BUFFER, onEncoderOutput, user_data, NULL);
+        }
+        if (sink) gst_object_unref(sink);
+        if (src) gst_object_unref(src);
+        gst_object_unref(encoder);
+    }
+    
+    // Capture-to-encoded latency, measured once per frame before packetization
+    GstElement* payloader = gst_bin_get_by_name_recurse_up(GST_BIN(element), "pay0");
+    if (payloader) {
+        GstPad* sink = gst_element_get_static_pad(payloader, "sink");
+        if (sink) {
+            gst_pad_add_probe(sink, GST_PAD_PROBE_TYPE_BUFFER, onPayloaderInput, user_data, NULL);
+            gst_object_unref(sink);
+        }
+        gst_object_unref(payloader);
+    }
+    
     // Connect media signals for better debugging
     g_signal_connect(media, "prepared", G_CALLBACK(onMediaPrepared), user_data);
     g_signal_connect(media, "unprepared", G_CALLBACK(onMediaUnprepared), user_data);
@@ -358,13 +1157,11 @@ void RtspStreamer::onMediaConstructed(GstRTSPMediaFactory* factory, GstRTSPMedia
 }
 
 void RtspStreamer::onNeedData(GstElement* appsrc, guint unused_size, gpointer user_data) {
-    // This callback is called when the appsrc needs more data
-    std::cout << "[RTSP DEBUG] Client requesting data (need-data signal)" << std::endl;
+    static_cast<Stream*>(user_data)->accepting = true;
 }
 
 void RtspStreamer::onEnoughData(GstElement* appsrc, gpointer user_data) {
-    // This callback is called when the appsrc has enough data
-    std::cout << "[RTSP DEBUG] Client has enough data (enough-data signal)" << std::endl;
+    static_cast<Stream*>(user_data)->accepting = false;
 }
 
 void RtspStreamer::onMediaPrepared(GstRTSPMedia* media, gpointer user_data) {
@@ -372,23 +1169,135 @@ void RtspStreamer::onMediaPrepared(GstRTSPMedia* media, gpointer user_data) {
 }
 
 void RtspStreamer::onMediaUnprepared(GstRTSPMedia* media, gpointer user_data) {
-    RtspStreamer* streamer = static_cast<RtspStreamer*>(user_data);
-    std::cout << "[RTSP DEBUG] Media pipeline unprepared (client disconnected)" << std::endl;
+    Stream* stream = static_cast<Stream*>(user_data);
+    std::cout << "[RTSP DEBUG] Media pipeline unprepared for " << stream->mount << " (client disconnected)" << std::endl;
     
     // Remove disconnected appsrc elements from list
     GstElement* element = gst_rtsp_media_get_element(media);
     if (element) {
         GstElement* appsrc = gst_bin_get_by_name_recurse_up(GST_BIN(element), "mysrc");
         if (appsrc) {
-            std::lock_guard<std::mutex> lock(streamer->appsrc_mutex_);
-            auto it = std::find(streamer->appsrc_list_.begin(), streamer->appsrc_list_.end(), appsrc);
-            if (it != streamer->appsrc_list_.end()) {
+            std::lock_guard<std::mutex> lock(stream->appsrc_mutex);
+            auto it = std::find(stream->appsrc_list.begin(), stream->appsrc_list.end(), appsrc);
+            if (it != stream->appsrc_list.end()) {
                 gst_object_unref(*it);
-                streamer->appsrc_list_.erase(it);
-                std::cout << "[RTSP DEBUG] Removed appsrc from list, " << streamer->appsrc_list_.size() << " clients remaining" << std::endl;
+                stream->appsrc_list.erase(it);
+                std::cout << "[RTSP DEBUG] Removed appsrc from list, " << stream->appsrc_list.size() << " clients remaining" << std::endl;
+                if (stream->appsrc_list.empty()) {
+                    stream->accepting = false;
+                    if (stream->encoder) {
+                        gst_object_unref(stream->encoder);
+                        stream->encoder = nullptr;
+                    }
+                }
             }
             gst_object_unref(appsrc);
         }
         gst_object_unref(element);
     }
-}
\ No newline at end of file
+}
+
+GstPadProbeReturn RtspStreamer::onEncoderInput(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    Stream* stream = static_cast<Stream*>(user_data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    
+    std::lock_guard<std::mutex> lock(stream->sei_mutex);
+    
+    // Start of the encode, matched by PTS at the encoder output
+    stream->encode_start_by_pts[GST_BUFFER_PTS(buffer)] = gst_clock_get_time(stream->clock);
+    if (stream->encode_start_by_pts.size() > kMaxPendingSei) {
+        stream->encode_start_by_pts.erase(stream->encode_start_by_pts.begin());
+    }
+    
+    auto it = stream->sei_by_sequence.find(GST_BUFFER_OFFSET(buffer));
+    if (it == stream->sei_by_sequence.end()) return GST_PAD_PROBE_OK;
+    
+    stream->sei_by_pts[GST_BUFFER_PTS(buffer)] = std::move(it->second);
+    stream->sei_by_sequence.erase(stream->sei_by_sequence.begin(), ++it);
+    if (stream->sei_by_pts.size() > kMaxPendingSei) {
+        stream->sei_by_pts.erase(stream->sei_by_pts.begin());
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn RtspStreamer::onEncoderOutput(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    Stream* stream = static_cast<Stream*>(user_data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    
+    std::string payload;
+    {
+        std::lock_guard<std::mutex> lock(stream->sei_mutex);
+        
+        // NAL-aligned encoders emit several buffers per frame; the first one ends the encode
+        auto start = stream->encode_start_by_pts.find(GST_BUFFER_PTS(buffer));
+        if (start != stream->encode_start_by_pts.end()) {
+            const GstClockTime now = gst_clock_get_time(stream->clock);
+            PipelineMetrics::instance().record(PipelineStage::Encode, (double)(now - start->second) / GST_MSECOND);
+            stream->encode_start_by_pts.erase(start);
+        }
+        
+        auto it = stream->sei_by_pts.find(GST_BUFFER_PTS(buffer));
+        if (it == stream->sei_by_pts.end()) return GST_PAD_PROBE_OK;
+        payload = std::move(it->second);
+        stream->sei_by_pts.erase(it);
+    }
+    
+    GstMapInfo in;
+    if (!gst_buffer_map(buffer, &in, GST_MAP_READ)) return GST_PAD_PROBE_OK;
+    
+    // The SEI must precede the first slice but follow any AUD/SPS/PPS
+    thread_local std::string sei;
+    buildSeiNal(payload, stream->h265, sei);
+    const size_t split = findFirstSlice(in.data, in.size, stream->h265);
+    
+    GstBuffer* output = gst_buffer_new_allocate(NULL, in.size + sei.size(), NULL);
+    GstMapInfo out;
+    if (!output || !gst_buffer_map(output, &out, GST_MAP_WRITE)) {
+        if (output) gst_buffer_unref(output);
+        gst_buffer_unmap(buffer, &in);
+        return GST_PAD_PROBE_OK;
+    }
+    std::memcpy(out.data, in.data, split);
+    std::memcpy(out.data + split, sei.data(), sei.size());
+    std::memcpy(out.data + split + sei.size(), in.data + split, in.size - split);
+    gst_buffer_unmap(output, &out);
+    gst_buffer_unmap(buffer, &in);
+    
+    gst_buffer_copy_into(output, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+    gst_buffer_unref(buffer);
+    GST_PAD_PROBE_INFO_DATA(info) = output;
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn RtspStreamer::onPayloaderInput(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    Stream* stream = static_cast<Stream*>(user_data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    
+    const GstClockTime pts = GST_BUFFER_PTS(buffer);
+    
+    // The clip ring takes a reference to every encoded buffer, parameter sets included
+    if (stream->recorder && GST_CLOCK_TIME_IS_VALID(pts)) {
+        GstCaps* caps = gst_pad_get_current_caps(pad);
+        stream->recorder->addBuffer(buffer, caps, stream->base_time + pts);
+        if (caps) gst_caps_unref(caps);
+    }
+    
+    // NAL-aligned encoders send several buffers per frame; count the first one
+    if (!GST_CLOCK_TIME_IS_VALID(pts) || pts == stream->last_measured_pts) {
+        return GST_PAD_PROBE_OK;
+    }
+    stream->last_measured_pts = pts;
+    
+    const GstClockTime running_time = gst_clock_get_time(stream->clock) - stream->base_time;
+    if (running_time < pts) {
+        return GST_PAD_PROBE_OK;  // base time changed under us
+    }
+    
+    const guint64 latency = running_time - pts;
+    stream->latency_sum_ns += latency;
+    stream->latency_count++;
+    guint64 max = stream->latency_max_ns;
+    while (latency > max && !stream->latency_max_ns.compare_exchange_weak(max, latency)) {
+    }
+    return GST_PAD_PROBE_OK;
+}
@@ -15,20 +15,89 @@
 #include <memory>
 #include <mutex>
 #include <chrono>
+#include <future>
+#include "ClipRecorder.h"
+#include <map>
 #include <vector>
 #include <gst/gst.h>
 #include <gst/rtsp-server/rtsp-server.h>
+#include <gst/video/video.h>
+
+/**
+ * @struct VideoEncoderSettings
+ * @brief Encoder selection shared by all RTSP streams
+ */
+struct VideoEncoderSettings {
+    std::string encoder = "auto";   ///< GStreamer encoder element, or "auto" to probe hardware encoders first
+    std::string codec = "h264";     ///< Video codec: "h264" or "h265"
+    int bitrate_kbps = 1000;        ///< Target bitrate in kbit/s
+    int keyframe_interval = 30;     ///< Frames between key frames
+    bool sei_metadata = false;      ///< Carry per-frame metadata in SEI user-data NAL units
+    int queue_frames = 2;           ///< Frames appsrc may queue ahead of the encoder
+};
+
+/**
+ * @struct RtspTransportSettings
+ * @brief How RTP reaches the clients of all RTSP streams
+ */
+struct RtspTransportSettings {
+    std::string protocols = "tcp";  ///< Allowed lower transports, comma-separated: "udp", "udp-mcast", "tcp"
+    std::string multicast_range = "239.255.42.0-239.255.42.255";  ///< Multicast group pool, "first-last"
+    int multicast_port_min = 5000;  ///< First RTP/RTCP port of multicast groups
+    int multicast_port_max = 5999;  ///< Last RTP/RTCP port of multicast groups
+    int multicast_ttl = 1;          ///< Multicast TTL (1 = local network only)
+    int client_send_buffer_kb = 0;  ///< Kernel send buffer per client socket (0 = system default)
+    int max_clients = 0;            ///< Max concurrent RTSP sessions (0 = unlimited)
+};
 
 /**
  * @class RtspStreamer
  * @brief Simple RTSP Server using GStreamer MediaFactory
  * 
- * Creates RTSP streams using UDP sink -> RTSP server pattern
- * - rtsp://localhost:8554/stream - Video stream
- * - rtsp://localhost:8554/metadata - Metadata stream (optional)
+ * One server serves several appsrc-fed streams, each on its own mount point:
+ * - rtsp://localhost:8554/cam0 - Video stream of the first camera
+ * - rtsp://localhost:8554/cam1 - Video stream of the second camera
+ *
+ * A camera may feed several streams (e.g. clean, annotated, low-res substream).
+ * Every mount has one shared pipeline, so each stream is scaled and encoded
+ * once however many clients watch it.
+ *
+ * Clients may receive RTP over TCP (interleaved), unicast UDP or multicast UDP
+ * as allowed by RtspTransportSettings. Multicast clients of one stream share a
+ * group from the address pool, so the device sends each packet only once.
+ *
+ * Every stream owns a GstBufferPool. Callers acquire a pooled buffer, draw
+ * into it through a cv::Mat view and push it, so frames reach appsrc without
+ * a per-frame allocation or an extra copy.
+ *
+ * The encoder is probed once at initialization (nvv4l2, vaapi, v4l2, then
+ * x264/x265). Streams are fed in the raw format the encoder takes (I420 or
+ * NV12), converted straight into the pooled buffer, so no videoconvert runs
+ * in the pipeline.
+ *
+ * Frames are only pushed while appsrc asks for data (need-data/enough-data);
+ * while the encoder is behind they are dropped before conversion, and the
+ * appsrc queue is capped at queue_frames frames. PTS is the frame's capture
+ * time on the GStreamer system clock relative to the pipeline base time, and
+ * the capture-to-encoded latency is measured as each frame reaches the
+ * payloader.
+ *
+ * With sei_metadata enabled, the metadata passed with a frame is inserted into
+ * that frame's access unit as an H.264/H.265 "user data unregistered" SEI
+ * message (UUID kSeiUuid), so clients can match detections to the exact frame.
  */
 class RtspStreamer {
 public:
+    /**
+     * @struct OutputFrame
+     * @brief Writable frame backed by a pooled GstBuffer of one stream
+     */
+    struct OutputFrame {
+        cv::Mat image;                ///< BGR view over the mapped buffer memory (BGR streams only)
+        GstBuffer* buffer = nullptr;  ///< Pooled buffer, owned until pushed or released
+        GstMapInfo map;               ///< Mapping backing image
+    };
+    
     /**
      * @brief Default constructor
      */
@@ -40,15 +109,57 @@ public:
     ~RtspStreamer();
     
     /**
-     * @brief Initialize RTSP server with parameters
-     * @param rtsp_url Not used (legacy compatibility)
+     * @brief Initialize RTSP server and select the video encoder
+     * @param port RTSP server port (optional, default 8554)
+     * @param encoder Encoder settings (optional, default auto-probed H.264 at 1000 kbit/s)
+     * @param transport RTP transport settings (optional, default TCP only)
+     * @return true if initialization successful, false otherwise
+     */
+    bool initialize(int port = 8554, const VideoEncoderSettings& encoder = VideoEncoderSettings(),
+                    const RtspTransportSettings& transport = RtspTransportSettings());
+    
+    /**
+     * @brief Add a video stream on its own mount point
+     * @param mount Mount point path (e.g. "/cam0")
      * @param width Frame width in pixels
      * @param height Frame height in pixels
      * @param fps Frames per second
-     * @param port RTSP server port (optional, default 8554)
-     * @return true if initialization successful, false otherwise
+     * @param bitrate_kbps Encoder bitrate of this stream (0 = VideoEncoderSettings::bitrate_kbps)
+     * @return Stream index for pushFrame(), -1 on failure
+     */
+    int addStream(const std::string& mount, int width, int height, int fps, int bitrate_kbps = 0);
+    
+    /**
+     * @brief Change the default encoder bitrate while streaming
+     *
+     * Applies to the streams added without their own bitrate: the running
+     * encoder is retuned in place and new pipelines are built with it.
+     * @param bitrate_kbps New bitrate in kbit/s
+     */
+    void setBitrate(int bitrate_kbps);
+    
+    /**
+     * @brief Scale the bitrate of every stream while streaming
+     *
+     * Each stream runs at its own configured bitrate (or the default) times
+     * the scale, with a floor of 200 kbit/s, so streams with their own
+     * bitrate are reduced as well. Used by the QoS controller.
+     * @param scale Factor on the configured bitrates (1 = as configured)
      */
-    bool initialize(const std::string& rtsp_url, int width, int height, int fps, int port = 8554);
+    void setBitrateScale(float scale);
+    
+    /**
+     * @brief Keep the recent encoded video of a stream for event clips
+     *
+     * The stream's shared pipeline then runs from start() on, with or
+     * without clients, and every buffer leaving its encoder also goes to
+     * the returned recorder. Call before start().
+     * @param stream_index Stream index returned by addStream()
+     * @param settings History and clip lengths
+     * @param name Prefix of the clip file names
+     * @return Recorder to trigger clips on (owned by the streamer), nullptr on failure
+     */
+    ClipRecorder* enableClipRecording(int stream_index, const ClipRecorderSettings& settings, const std::string& name);
     
     /**
      * @brief Start the RTSP server
@@ -68,48 +179,250 @@ public:
     bool isRunning() const { return server_running_; }
     
     /**
-     * @brief Push a video frame (uses UDP sink to GStreamer pipeline)
-     * @param frame OpenCV Mat frame to stream
-     * @return true if frame pushed successfully, false otherwise
+     * @brief Acquire a writable pooled buffer for a stream
+     * @param stream_index Stream index returned by addStream()
+     * @param frame Output frame; any buffer it still holds is released first
+     * @param source Optional image copied into the buffer (scaled and converted to the stream format in one pass)
+     * @return true if a buffer was acquired, false otherwise
+     */
+    bool acquireFrame(int stream_index, OutputFrame& frame, const cv::Mat& source = cv::Mat());
+    
+    /**
+     * @brief Check whether a stream takes a frame now, before paying for acquiring and drawing it
+     * @param stream_index Stream index returned by addStream()
+     * @return true if a client is connected and appsrc wants data; a false result counts as the dropped frame
+     */
+    bool admitFrame(int stream_index);
+    
+    /**
+     * @brief Push a pooled frame to a stream's appsrc without copying it
+     * @param frame Frame from acquireFrame(); its buffer is handed over and image is reset
+     * @param stream_index Stream index returned by addStream()
+     * @param metadata Per-frame metadata for the SEI message (ignored unless sei_metadata is enabled)
+     * @param capture_time Capture time on the GStreamer system clock (GST_CLOCK_TIME_NONE = now)
+     * @return true if frame pushed successfully, false if dropped (no client, encoder behind) or on error
+     */
+    bool pushFrame(OutputFrame& frame, int stream_index = 0, const std::string& metadata = std::string(),
+                   GstClockTime capture_time = GST_CLOCK_TIME_NONE);
+    
+    /**
+     * @brief Return an unpushed pooled frame to its pool
+     * @param frame Frame from acquireFrame()
+     */
+    static void releaseFrame(OutputFrame& frame);
+    
+    /**
+     * @brief Push a video frame to a stream's appsrc
+     * @param frame OpenCV Mat frame to stream (copied into a pooled buffer)
+     * @param stream_index Stream index returned by addStream()
+     * @param metadata Per-frame metadata for the SEI message (ignored unless sei_metadata is enabled)
+     * @param capture_time Capture time on the GStreamer system clock (GST_CLOCK_TIME_NONE = now)
+     * @return true if frame pushed successfully, false if dropped (no client, encoder behind) or on error
      */
-    bool pushFrame(const cv::Mat& frame);
+    bool pushFrame(const cv::Mat& frame, int stream_index = 0, const std::string& metadata = std::string(),
+                   GstClockTime capture_time = GST_CLOCK_TIME_NONE);
     
     /**
      * @brief Get the video stream URL
+     * @param stream Stream index returned by addStream()
      * @return Video RTSP URL string
      */
-    std::string getStreamUrl() const;
+    std::string getStreamUrl(int stream = 0) const;
+    
+    /**
+     * @brief Check whether a stream takes BGR frames, so OutputFrame::image can be drawn on
+     * @param stream_index Stream index returned by addStream()
+     * @return true for BGR streams, false for YUV streams or invalid indices
+     */
+    bool isBgrStream(int stream_index) const;
+    
+    /**
+     * @brief Get the frame size of a stream
+     * @param stream_index Stream index returned by addStream()
+     * @return Stream resolution, empty for invalid indices
+     */
+    cv::Size getStreamSize(int stream_index) const;
+    
+    /**
+     * @brief Get the selected encoder element
+     * @return Encoder element name, e.g. "v4l2h264enc"
+     */
+    const std::string& getEncoderName() const { return encoder_element_; }
+    
+    /**
+     * @brief Get number of configured streams
+     * @return Stream count
+     */
+    int getStreamCount() const { return (int)streams_.size(); }
+    
+    /**
+     * @brief Get the current time of the clock used for capture timestamps
+     * @return GStreamer system clock time
+     */
+    GstClockTime getClockTime() const;
+    
+    /**
+     * @brief Convert a steady_clock time (e.g. FrameContext::capture_time) to the GStreamer clock
+     * @param time Monotonic time point
+     * @return Equivalent time on the GStreamer system clock
+     */
+    GstClockTime toClockTime(std::chrono::steady_clock::time_point time) const;
+    
+    /**
+     * @brief Get capture-to-encoded latency of a stream since startup
+     * @param stream_index Stream index returned by addStream()
+     * @param average_ms Average latency in milliseconds
+     * @param max_ms Maximum latency in milliseconds
+     * @return true if at least one frame was measured
+     */
+    bool getLatency(int stream_index, double& average_ms, double& max_ms) const;
+    
+    /**
+     * @brief Get number of frames dropped because the encoder was behind
+     * @param stream_index Stream index returned by addStream()
+     * @return Dropped frame count
+     */
+    int getDroppedFrames(int stream_index) const;
+    
+    /**
+     * @brief Get number of connected RTSP clients, over all mount points
+     * @return Client count
+     */
+    int getClientCount() const { return client_count_; }
+    
+    /**
+     * @brief Check whether frames carry SEI metadata
+     * @return true if pushFrame() metadata reaches the clients
+     */
+    bool hasSeiMetadata() const { return encoder_settings_.sei_metadata; }
+    
+    /// UUID of the SEI user-data messages carrying the detections
+    static const unsigned char kSeiUuid[16];
 
 private:
+    /**
+     * @struct Stream
+     * @brief One mount point with its media factory and shared appsrc
+     */
+    struct Stream {
+        std::string mount;
+        int width;
+        int height;
+        int fps;
+        int bitrate_kbps;            ///< Current rate, base_bitrate_kbps scaled by setBitrateScale()
+        int base_bitrate_kbps;       ///< Configured rate of this stream
+        bool default_bitrate;        ///< Follows VideoEncoderSettings::bitrate_kbps
+        int queue_frames;
+        bool h265;
+        
+        GstRTSPMediaFactory* factory;
+        std::string source_launch;   ///< Launch description up to the encoder
+        
+        // Pool of frame buffers matching the appsrc caps
+        GstVideoFormat format;
+        GstVideoInfo video_info;
+        GstBufferPool* buffer_pool;
+        cv::Mat scaled;  ///< Resize scratch for YUV streams, reused by the (single) producer thread
+        
+        // App source for frame injection - support multiple clients
+        std::vector<GstElement*> appsrc_list;
+        GstElement* encoder;         ///< Encoder of the shared pipeline while it exists
+        std::mutex appsrc_mutex;     ///< Guards appsrc_list and encoder
+        
+        // Event clips: encoder output tap and the media kept prepared for it (under pin_mutex_)
+        std::unique_ptr<ClipRecorder> recorder;
+        GstRTSPMedia* pinned_media;
+        
+        // Push statistics and timestamps, owned by the pushing thread
+        int frame_count;
+        int successful_pushes;
+        bool waiting_for_client;    ///< No client was connected at the last push, logged once
+        GstFlowReturn last_flow;    ///< Result of the last push, logged when it changes
+        GstClockTime last_pts;
+        GstClockTime last_base_time;
+        guint64 sequence;
+        
+        // Flow control, set by need-data and cleared by enough-data on the streaming thread
+        std::atomic<bool> accepting;
+        std::atomic<int> dropped_frames;
+        
+        // Latency measurement at the payloader input
+        GstClock* clock;
+        std::atomic<GstClockTime> base_time;
+        GstClockTime last_measured_pts;  ///< Streaming thread only
+        std::atomic<guint64> latency_sum_ns;
+        std::atomic<guint64> latency_max_ns;
+        std::atomic<guint64> latency_count;
+        
+        // SEI payloads on their way to the encoder output, guarded by sei_mutex.
+        // Keyed by frame sequence (GST_BUFFER_OFFSET) up to the encoder input,
+        // then by PTS, which the encoder keeps on the matching output.
+        std::map<guint64, std::string> sei_by_sequence;
+        std::map<GstClockTime, std::string> sei_by_pts;
+        std::map<GstClockTime, GstClockTime> encode_start_by_pts;  ///< Encoder input clock time per PTS
+        std::mutex sei_mutex;
+    };
+    
     int port_;
-    int width_;
-    int height_;
-    int fps_;
+    
+    // Encoder selected at initialization
+    VideoEncoderSettings encoder_settings_;
+    float bitrate_scale_;            ///< Set by setBitrateScale()
+    std::string encoder_element_;
+    std::string codec_;
+    GstVideoFormat raw_format_;
+    GstClock* clock_;
+    GstClockTimeDiff clock_offset_;  ///< GStreamer clock minus steady_clock, in ns
+    
+    // Transports offered to clients
+    RtspTransportSettings transport_settings_;
+    GstRTSPLowerTrans protocols_;
+    GstRTSPAddressPool* address_pool_;
+    std::atomic<int> client_count_;
     
     // GStreamer RTSP Server components
     GstRTSPServer* server_;
     GMainLoop* loop_;
     std::thread server_thread_;
     
-    // App source for frame injection - support multiple clients
-    std::vector<GstElement*> appsrc_list_;
-    GstRTSPMediaFactory* factory_;
+    std::vector<std::unique_ptr<Stream>> streams_;
+    
+    // Media of recorded streams, prepared on pin_thread_ since that waits for the first frame
+    std::thread pin_thread_;
+    std::future<void> pin_done_;
+    std::mutex pin_mutex_;
+    bool pin_stopping_;
     
     std::atomic<bool> server_running_;
     std::atomic<bool> initialized_;
-    std::mutex frame_mutex_;
-    std::mutex appsrc_mutex_;
     
     // Private methods
     bool setupRtspServer();
-    void serverLoop();
+    bool setupTransports(const RtspTransportSettings& settings);
+    bool selectEncoder(const VideoEncoderSettings& settings);
+    std::string buildEncoderLaunch(int bitrate_kbps) const;
+    void applyBitrate(GstElement* encoder, int bitrate_kbps) const;
+    void updateBitrates();
+    static bool isElementAvailable(const std::string& name);
+    bool setupBufferPool(Stream& stream);
+    void serverLoop(std::promise<bool> started);
+    static gboolean onLoopStarted(gpointer user_data);
+    void pinRecordedMedia(std::promise<void> done);
+    void unpinRecordedMedia();
+    bool admitFrame(Stream& stream);
+    bool pushBuffer(Stream& stream, GstBuffer* buffer, const std::string& metadata, GstClockTime capture_time);
     
     // GStreamer callback functions
+    static void onClientConnected(GstRTSPServer* server, GstRTSPClient* client, gpointer user_data);
+    static void onClientClosed(GstRTSPClient* client, gpointer user_data);
     static void onMediaConstructed(GstRTSPMediaFactory* factory, GstRTSPMedia* media, gpointer user_data);
     static void onNeedData(GstElement* appsrc, guint unused_size, gpointer user_data);
     static void onEnoughData(GstElement* appsrc, gpointer user_data);
     static void onMediaPrepared(GstRTSPMedia* media, gpointer user_data);
     static void onMediaUnprepared(GstRTSPMedia* media, gpointer user_data);
+    static GstPadProbeReturn onEncoderInput(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static GstPadProbeReturn onEncoderOutput(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static GstPadProbeReturn onPayloaderInput(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
 };
 
 #endif // RTSP_STREAMER_H
\ No newline at end of file
@@ -0,0 +1,56 @@
+/**
+ * @file RuntimeSettings.cpp
+ * @brief Mapping between the configuration and the runtime settings snapshot
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "RuntimeSettings.h"
+
+RuntimeSettings RuntimeSettings::fromConfig(const ConfigManager::Config& config) {
+    RuntimeSettings settings;
+    settings.detection_threshold = config.detection_threshold;
+    settings.nms_threshold = config.nms_threshold;
+    settings.detection_interval = config.detection_interval;
+    settings.draw_detections = config.draw_detections;
+    settings.metadata_publish_interval_ms = config.metadata_publish_interval_ms;
+    settings.metadata_mode = config.metadata_mode;
+    settings.max_frame_age_ms = config.max_frame_age_ms;
+
+    settings.motion.enabled = config.motion_gating;
+    settings.motion.threshold = config.motion_threshold;
+    settings.motion.min_area = config.motion_min_area;
+    settings.motion.hold_ms = config.motion_hold_ms;
+    settings.motion.idle_ms = config.motion_idle_ms;
+
+    settings.tracking.enabled = config.tracking;
+    settings.tracking.iou_threshold = config.tracker_iou_threshold;
+    settings.tracking.high_threshold = config.tracker_high_threshold;
+    settings.tracking.min_hits = config.tracker_min_hits;
+    settings.tracking.max_misses = config.tracker_max_misses;
+    settings.tracking.max_predict_ms = config.tracker_max_predict_ms;
+    return settings;
+}
+
+void RuntimeSettings::applyTo(ConfigManager::Config& config) const {
+    config.detection_threshold = detection_threshold;
+    config.nms_threshold = nms_threshold;
+    config.detection_interval = detection_interval;
+    config.draw_detections = draw_detections;
+    config.metadata_publish_interval_ms = metadata_publish_interval_ms;
+    config.metadata_mode = metadata_mode;
+    config.max_frame_age_ms = max_frame_age_ms;
+
+    config.motion_gating = motion.enabled;
+    config.motion_threshold = motion.threshold;
+    config.motion_min_area = motion.min_area;
+    config.motion_hold_ms = motion.hold_ms;
+    config.motion_idle_ms = motion.idle_ms;
+
+    config.tracking = tracking.enabled;
+    config.tracker_iou_threshold = tracking.iou_threshold;
+    config.tracker_high_threshold = tracking.high_threshold;
+    config.tracker_min_hits = tracking.min_hits;
+    config.tracker_max_misses = tracking.max_misses;
+    config.tracker_max_predict_ms = tracking.max_predict_ms;
+}
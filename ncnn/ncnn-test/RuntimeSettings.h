@@ -0,0 +1,114 @@
+/**
+ * @file RuntimeSettings.h
+ * @brief Settings that can change while the pipeline runs, published as immutable snapshots
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef RUNTIME_SETTINGS_H
+#define RUNTIME_SETTINGS_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "ConfigManager.h"
+#include "MotionGate.h"
+#include "ObjectTracker.h"
+
+/**
+ * @struct RuntimeSettings
+ * @brief The part of the configuration applied on reload without restarting anything
+ *
+ * The capture stage attaches the snapshot in effect to every FrameContext, so
+ * all later stages of a frame (inference, tracking, metadata, output) see the
+ * same values even while a reload is published.
+ */
+struct RuntimeSettings {
+    float detection_threshold = 0.25f;     ///< Confidence threshold for classes without their own
+    float nms_threshold = 0.45f;           ///< NMS IoU threshold
+    int detection_interval = 1;            ///< Run the detector on every Nth frame
+    bool draw_detections = true;           ///< Draw boxes on the annotated streams
+    int metadata_publish_interval_ms = 100; ///< Minimum time between metadata records per camera
+    std::string metadata_mode = "detections"; ///< "detections" (every interval) or "events" (track changes only)
+    int max_frame_age_ms = 0;              ///< Drop frames older than this before output (0 = never)
+    MotionGateSettings motion;             ///< Motion gate sensitivity; the gate is rebuilt when it changes
+    TrackerSettings tracking;              ///< Tracker parameters; the tracker is rebuilt when they change
+
+    // Set by the QoS controller only, never from the configuration
+    float detection_input_scale = 1.f;     ///< Scale of the detector input size (1 = configured size)
+    int output_frame_stride = 1;           ///< Only frames whose sequence is a multiple of this are output
+
+    /**
+     * @brief Take the runtime settings from a configuration
+     * @param config Parsed configuration
+     * @return Runtime settings
+     */
+    static RuntimeSettings fromConfig(const ConfigManager::Config& config);
+
+    /**
+     * @brief Write these settings back into a configuration
+     * @param config Configuration to update; the other fields are left alone
+     */
+    void applyTo(ConfigManager::Config& config) const;
+};
+
+/**
+ * @class RuntimeSettingsStore
+ * @brief Single writer, many readers holder of the current RuntimeSettings
+ *
+ * publish() swaps in a new immutable snapshot and bumps a version counter.
+ * Readers go through a RuntimeSettingsReader, which only compares the
+ * version (one atomic load) per call and fetches the snapshot when it
+ * changed, so the per-frame path takes no lock.
+ */
+class RuntimeSettingsStore {
+public:
+    RuntimeSettingsStore() : current_(std::make_shared<const RuntimeSettings>()), version_(0) {}
+
+    /**
+     * @brief Replace the current settings
+     * @param settings New settings
+     */
+    void publish(const RuntimeSettings& settings) {
+        std::atomic_store(&current_, std::shared_ptr<const RuntimeSettings>(std::make_shared<const RuntimeSettings>(settings)));
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    std::shared_ptr<const RuntimeSettings> load() const { return std::atomic_load(&current_); }
+    unsigned getVersion() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<const RuntimeSettings> current_;
+    std::atomic<unsigned> version_;
+};
+
+/**
+ * @class RuntimeSettingsReader
+ * @brief Per-thread cached view of a RuntimeSettingsStore
+ */
+class RuntimeSettingsReader {
+public:
+    explicit RuntimeSettingsReader(const RuntimeSettingsStore& store)
+        : store_(store), version_(store.getVersion()), snapshot_(store.load()) {}
+
+    /**
+     * @brief Get the current snapshot
+     * @return Snapshot, valid until the next call on this reader (copy the pointer to keep it)
+     */
+    const std::shared_ptr<const RuntimeSettings>& get() {
+        const unsigned version = store_.getVersion();
+        if (version != version_) {
+            snapshot_ = store_.load();
+            version_ = version;
+        }
+        return snapshot_;
+    }
+
+private:
+    const RuntimeSettingsStore& store_;
+    unsigned version_;
+    std::shared_ptr<const RuntimeSettings> snapshot_;
+};
+
+#endif // RUNTIME_SETTINGS_H
@@ -0,0 +1,229 @@
+/**
+ * @file ThreadUtils.cpp
+ * @brief Implementation of CPU core discovery and thread affinity helpers
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "ThreadUtils.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <unistd.h>
+
+int getCpuCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+std::vector<int> parseCoreList(const std::string& spec) {
+    std::vector<int> cores;
+    std::stringstream ss(spec);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+
+        try {
+            size_t dash = item.find('-');
+            if (dash == std::string::npos) {
+                cores.push_back(std::stoi(item));
+            } else {
+                int first = std::stoi(item.substr(0, dash));
+                int last = std::stoi(item.substr(dash + 1));
+                for (int core = first; core <= last; core++) {
+                    cores.push_back(core);
+                }
+            }
+        } catch (...) {
+            std::cerr << "Invalid core list entry: " << item << std::endl;
+            return std::vector<int>();
+        }
+    }
+
+    return cores;
+}
+
+std::vector<int> getClusterCores(const std::string& cluster) {
+    if (cluster != "big" && cluster != "little") {
+        return std::vector<int>();
+    }
+
+    // Cluster membership follows the maximum frequency, as NCNN's own powersave modes do
+    const int count = getCpuCount();
+    std::vector<long> max_freq(count, 0);
+    for (int core = 0; core < count; core++) {
+        std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(core) + "/cpufreq/cpuinfo_max_freq");
+        file >> max_freq[core];
+    }
+
+    const long fastest = *std::max_element(max_freq.begin(), max_freq.end());
+    std::vector<int> big;
+    std::vector<int> little;
+    for (int core = 0; core < count; core++) {
+        (max_freq[core] == fastest ? big : little).push_back(core);
+    }
+
+    if (little.empty()) {
+        return std::vector<int>();
+    }
+    return cluster == "big" ? big : little;
+}
+
+std::vector<int> getOtherCores(const std::vector<int>& cores) {
+    std::vector<int> others;
+    if (cores.empty()) return others;
+
+    for (int core = 0; core < getCpuCount(); core++) {
+        if (std::find(cores.begin(), cores.end(), core) == cores.end()) {
+            others.push_back(core);
+        }
+    }
+    return others;
+}
+
+bool setCurrentThreadAffinity(const std::vector<int>& cores) {
+    if (cores.empty()) return true;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core : cores) {
+        if (core >= 0 && core < CPU_SETSIZE) {
+            CPU_SET(core, &set);
+        }
+    }
+
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        std::cerr << "Failed to set thread affinity (error " << ret << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void setCurrentThreadName(const std::string& name) {
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+namespace {
+thread_local WorkerGroup* current_group = nullptr;
+}
+
+WorkerGroup::WorkerGroup()
+    : generation_(0), stopping_(false), active_(0), pending_(0), count_(0), next_(0), func_(nullptr) {
+}
+
+WorkerGroup::~WorkerGroup() {
+    stop();
+}
+
+void WorkerGroup::start(int helpers, const std::vector<int>& cores, const std::string& name) {
+    stop();
+    stopping_ = false;
+    for (int i = 0; i < helpers; i++) {
+        threads_.emplace_back(&WorkerGroup::helperLoop, this, i, cores, name + "-" + std::to_string(i + 1));
+    }
+}
+
+void WorkerGroup::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+void WorkerGroup::run(int count, int groups, const std::function<void(int)>& func) {
+    groups = std::max(1, std::min(std::min(groups, count), getSize()));
+    if (groups == 1) {
+        for (int i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        func_ = &func;
+        count_ = count;
+        next_ = 0;
+        active_ = groups - 1;
+        pending_ = active_;
+        generation_++;
+    }
+    work_cv_.notify_all();
+
+    drain();
+
+    // func and the items it writes must outlive every helper's share
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return pending_ == 0; });
+    func_ = nullptr;
+}
+
+void WorkerGroup::drain() {
+    while (true) {
+        int i;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (next_ >= count_) return;
+            i = next_++;
+        }
+        (*func_)(i);
+    }
+}
+
+void WorkerGroup::helperLoop(int index, std::vector<int> cores, std::string name) {
+    setCurrentThreadName(name);
+    setCurrentThreadAffinity(cores);
+
+    unsigned seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+            if (index >= active_) continue;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void WorkerGroup::setCurrent(WorkerGroup* group) {
+    current_group = group;
+}
+
+WorkerGroup* WorkerGroup::getCurrent() {
+    return current_group;
+}
+
+int getParallelism() {
+    return current_group ? current_group->getSize() : 1;
+}
+
+void parallelFor(int count, int groups, const std::function<void(int)>& func) {
+    if (current_group) {
+        current_group->run(count, groups, func);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        func(i);
+    }
+}
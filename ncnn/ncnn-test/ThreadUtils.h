@@ -0,0 +1,140 @@
+/**
+ * @file ThreadUtils.h
+ * @brief CPU core discovery and thread affinity helpers
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef THREAD_UTILS_H
+#define THREAD_UTILS_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Get the number of online CPU cores
+ * @return Core count (at least 1)
+ */
+int getCpuCount();
+
+/**
+ * @brief Parse a core list such as "0-3,6"
+ * @param spec Comma separated core ids and ranges
+ * @return Parsed core ids (empty if spec is empty or invalid)
+ */
+std::vector<int> parseCoreList(const std::string& spec);
+
+/**
+ * @brief Get the cores of one CPU cluster on big.LITTLE systems
+ * @param cluster "big" (fastest cores), "little" (the other cores) or "all"
+ * @return Core ids of the cluster (empty for "all", or if all cores run at the same maximum frequency)
+ */
+std::vector<int> getClusterCores(const std::string& cluster);
+
+/**
+ * @brief Get the online cores not in a set
+ * @param cores Cores to exclude
+ * @return Remaining core ids (empty if cores is empty or covers every core)
+ */
+std::vector<int> getOtherCores(const std::vector<int>& cores);
+
+/**
+ * @brief Pin the calling thread to a set of cores
+ * @param cores Core ids the thread may run on (empty = no restriction)
+ * @return true if the affinity was applied, false otherwise
+ */
+bool setCurrentThreadAffinity(const std::vector<int>& cores);
+
+/**
+ * @brief Give the calling thread a name visible in top/htop/gdb
+ * @param name Thread name (truncated to 15 characters)
+ */
+void setCurrentThreadName(const std::string& name);
+
+/**
+ * @class WorkerGroup
+ * @brief Persistent helper threads a pipeline thread spreads its work items over
+ *
+ * The helpers are started once, pinned to the owner's cores and sleep between
+ * run() calls, so splitting a batch costs a wake-up instead of creating
+ * threads, and the helpers' thread_local buffers and allocators survive from
+ * one batch to the next. The owning thread installs the group with
+ * setCurrent(); parallelFor() on that thread then uses it.
+ */
+class WorkerGroup {
+public:
+    WorkerGroup();
+    ~WorkerGroup();
+
+    /**
+     * @brief Start the helper threads
+     * @param helpers Number of helpers, not counting the owning thread
+     * @param cores Cores the helpers are pinned to (empty = no restriction)
+     * @param name Thread name prefix
+     */
+    void start(int helpers, const std::vector<int>& cores, const std::string& name);
+
+    /**
+     * @brief Stop and join the helper threads
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of threads run() uses, including the calling thread
+     * @return Helpers + 1
+     */
+    int getSize() const { return (int)threads_.size() + 1; }
+
+    /**
+     * @brief Run func(0) .. func(count - 1) on the calling thread and up to groups - 1 helpers
+     * @param count Number of work items
+     * @param groups Number of threads, including the calling thread
+     * @param func Work item function
+     */
+    void run(int count, int groups, const std::function<void(int)>& func);
+
+    /**
+     * @brief Make a group the one parallelFor() uses on the calling thread
+     * @param group Group owned by the calling thread (nullptr = run work items inline)
+     */
+    static void setCurrent(WorkerGroup* group);
+    static WorkerGroup* getCurrent();
+
+private:
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    unsigned generation_;                         ///< Bumped by every run()
+    bool stopping_;
+    int active_;                                  ///< Helpers taking part in the current run()
+    int pending_;                                 ///< Active helpers not finished yet
+    int count_;
+    int next_;                                    ///< Next work item, taken under mutex_
+    const std::function<void(int)>* func_;
+
+    void helperLoop(int index, std::vector<int> cores, std::string name);
+    void drain();
+};
+
+/**
+ * @brief Get the number of threads parallelFor() can use on the calling thread
+ * @return Size of the current WorkerGroup, 1 if there is none
+ */
+int getParallelism();
+
+/**
+ * @brief Run func(0) .. func(count - 1) on up to groups threads of the current WorkerGroup
+ * @param count Number of work items
+ * @param groups Number of threads, including the calling thread (limited to getParallelism())
+ * @param func Work item function
+ *
+ * Without a current group the items run one after the other on the calling thread.
+ */
+void parallelFor(int count, int groups, const std::function<void(int)>& func);
+
+#endif // THREAD_UTILS_H
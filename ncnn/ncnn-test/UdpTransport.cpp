@@ -0,0 +1,80 @@
+/**
+ * @file UdpTransport.cpp
+ * @brief Implementation of the UDP (multicast) metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "UdpTransport.h"
+#include <iostream>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+/// Largest UDP payload over IPv4
+static const size_t kMaxDatagramSize = 65507;
+
+UdpTransport::UdpTransport(const MetadataTransportSettings& settings)
+    : settings_(settings), fd_(-1), destination_length_(0) {
+    std::memset(&destination_, 0, sizeof(destination_));
+}
+
+UdpTransport::~UdpTransport() {
+    close();
+}
+
+std::string UdpTransport::getName() const {
+    return "udp://" + settings_.host + ":" + std::to_string(settings_.port);
+}
+
+bool UdpTransport::connect() {
+    close();
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(settings_.host.c_str(), std::to_string(settings_.port).c_str(), &hints, &result) != 0 || !result) {
+        std::cerr << "Cannot resolve UDP metadata destination " << settings_.host << std::endl;
+        return false;
+    }
+
+    fd_ = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd_ >= 0) {
+        std::memcpy(&destination_, result->ai_addr, result->ai_addrlen);
+        destination_length_ = result->ai_addrlen;
+
+        // Only takes effect for multicast destinations
+        int ttl = settings_.udp_ttl;
+        if (result->ai_family == AF_INET6) {
+            setsockopt(fd_, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof(ttl));
+        } else {
+            unsigned char ttl_byte = (unsigned char)ttl;
+            setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl_byte, sizeof(ttl_byte));
+        }
+    }
+    freeaddrinfo(result);
+    return fd_ >= 0;
+}
+
+bool UdpTransport::send(const std::string& data, bool binary) {
+    if (fd_ < 0) return false;
+
+    if (data.size() > kMaxDatagramSize) {
+        std::cerr << "Metadata message of " << data.size() << " bytes exceeds the UDP datagram limit" << std::endl;
+        return false;
+    }
+
+    ssize_t sent = ::sendto(fd_, data.data(), data.size(), 0, (const struct sockaddr*)&destination_, destination_length_);
+    return sent == (ssize_t)data.size();
+}
+
+void UdpTransport::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * @file UdpTransport.h
+ * @brief Fire-and-forget UDP (multicast) metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include <string>
+#include <sys/socket.h>
+
+#include "MetadataTransport.h"
+
+/**
+ * @class UdpTransport
+ * @brief Sends every message as one UDP datagram
+ *
+ * With a multicast group as host (e.g. 239.0.0.1) any number of receivers on
+ * the network can join the group at no extra cost to the device. Delivery is
+ * not confirmed; messages above the datagram limit are rejected.
+ */
+class UdpTransport : public MetadataTransport {
+public:
+    explicit UdpTransport(const MetadataTransportSettings& settings);
+    ~UdpTransport() override;
+
+    bool connect() override;
+    bool isConnected() const override { return fd_ >= 0; }
+    bool send(const std::string& data, bool binary) override;
+    void close() override;
+    std::string getName() const override;
+
+private:
+    MetadataTransportSettings settings_;
+    int fd_;
+    struct sockaddr_storage destination_;
+    socklen_t destination_length_;
+};
+
+#endif // UDP_TRANSPORT_H
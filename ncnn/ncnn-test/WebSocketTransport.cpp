@@ -0,0 +1,193 @@
+/**
+ * @file WebSocketTransport.cpp
+ * @brief Implementation of the WebSocket client metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#include "WebSocketTransport.h"
+#include <iostream>
+#include <cerrno>
+#include <cstdint>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+enum Opcode {
+    kText = 0x1,
+    kBinary = 0x2,
+    kClose = 0x8,
+    kPing = 0x9,
+    kPong = 0xA
+};
+
+std::string base64Encode(const unsigned char* data, size_t size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < size) chunk |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < size) chunk |= data[i + 2];
+
+        out += alphabet[(chunk >> 18) & 0x3f];
+        out += alphabet[(chunk >> 12) & 0x3f];
+        out += (i + 1 < size) ? alphabet[(chunk >> 6) & 0x3f] : '=';
+        out += (i + 2 < size) ? alphabet[chunk & 0x3f] : '=';
+    }
+    return out;
+}
+
+} // namespace
+
+WebSocketTransport::WebSocketTransport(const MetadataTransportSettings& settings)
+    : settings_(settings), fd_(-1), random_(std::random_device()()) {
+}
+
+WebSocketTransport::~WebSocketTransport() {
+    close();
+}
+
+std::string WebSocketTransport::getName() const {
+    return "ws://" + settings_.host + ":" + std::to_string(settings_.port) + settings_.endpoint;
+}
+
+bool WebSocketTransport::connect() {
+    close();
+
+    fd_ = openTcpSocket(settings_.host, settings_.port, settings_.timeout_ms);
+    if (fd_ < 0) return false;
+
+    if (!handshake()) {
+        std::cerr << "WebSocket handshake with " << getName() << " failed" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketTransport::handshake() {
+    unsigned char nonce[16];
+    for (auto& byte : nonce) {
+        byte = (unsigned char)(random_() & 0xff);
+    }
+
+    std::string request =
+        "GET " + settings_.endpoint + " HTTP/1.1\r\n"
+        "Host: " + settings_.host + ":" + std::to_string(settings_.port) + "\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: " + base64Encode(nonce, sizeof(nonce)) + "\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    if (!sendAll(fd_, request.data(), request.size())) return false;
+
+    // Read the response header; anything after it already belongs to the frame stream
+    std::string response;
+    char buffer[512];
+    size_t header_end;
+    while ((header_end = response.find("\r\n\r\n")) == std::string::npos) {
+        if (response.size() > 8192) return false;
+        ssize_t received = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        response.append(buffer, (size_t)received);
+    }
+    incoming_ = response.substr(header_end + 4);
+
+    // Sec-WebSocket-Accept is not verified: the server is a trusted, configured endpoint
+    return response.compare(0, 12, "HTTP/1.1 101") == 0;
+}
+
+bool WebSocketTransport::send(const std::string& data, bool binary) {
+    if (fd_ < 0) return false;
+
+    if (!handleIncoming() || !sendFrame(binary ? kBinary : kText, data.data(), data.size())) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketTransport::sendFrame(int opcode, const char* payload, size_t size) {
+    frame_.clear();
+    frame_ += (char)(0x80 | opcode);  // FIN, no fragmentation
+
+    // Client frames must be masked
+    if (size < 126) {
+        frame_ += (char)(0x80 | size);
+    } else if (size <= 0xffff) {
+        frame_ += (char)(0x80 | 126);
+        frame_ += (char)((size >> 8) & 0xff);
+        frame_ += (char)(size & 0xff);
+    } else {
+        frame_ += (char)(0x80 | 127);
+        for (int i = 7; i >= 0; i--) {
+            frame_ += (char)(((uint64_t)size >> (i * 8)) & 0xff);
+        }
+    }
+
+    uint32_t mask_bits = random_();
+    char mask[4];
+    for (int i = 0; i < 4; i++) {
+        mask[i] = (char)((mask_bits >> (i * 8)) & 0xff);
+        frame_ += mask[i];
+    }
+
+    const size_t offset = frame_.size();
+    frame_.append(payload, size);
+    for (size_t i = 0; i < size; i++) {
+        frame_[offset + i] ^= mask[i & 3];
+    }
+
+    return sendAll(fd_, frame_.data(), frame_.size());
+}
+
+bool WebSocketTransport::handleIncoming() {
+    char buffer[512];
+    while (true) {
+        ssize_t received = ::recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0) {
+            incoming_.append(buffer, (size_t)received);
+            continue;
+        }
+        if (received == 0) return false;  // server closed the connection
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    while (incoming_.size() >= 2) {
+        const unsigned char b0 = (unsigned char)incoming_[0];
+        const unsigned char b1 = (unsigned char)incoming_[1];
+
+        size_t header = 2;
+        uint64_t length = b1 & 0x7f;
+        if (length == 126) header += 2;
+        if (length == 127) header += 8;
+        if (b1 & 0x80) header += 4;
+        if (incoming_.size() < header) break;
+
+        if (length >= 126) {
+            const size_t bytes = (length == 126) ? 2 : 8;
+            length = 0;
+            for (size_t i = 0; i < bytes; i++) {
+                length = (length << 8) | (unsigned char)incoming_[2 + i];
+            }
+        }
+        if (incoming_.size() - header < length) break;
+
+        const int opcode = b0 & 0x0f;
+        if (opcode == kClose) return false;
+        if (opcode == kPing && !sendFrame(kPong, incoming_.data() + header, (size_t)length)) return false;
+
+        incoming_.erase(0, header + (size_t)length);
+    }
+    return true;
+}
+
+void WebSocketTransport::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    incoming_.clear();
+}
@@ -0,0 +1,48 @@
+/**
+ * @file WebSocketTransport.h
+ * @brief Persistent WebSocket client metadata transport
+ * @author AI Detection System
+ * @date 2025-10-14
+ */
+
+#ifndef WEBSOCKET_TRANSPORT_H
+#define WEBSOCKET_TRANSPORT_H
+
+#include <random>
+#include <string>
+
+#include "MetadataTransport.h"
+
+/**
+ * @class WebSocketTransport
+ * @brief Sends every message as one WebSocket frame (RFC 6455)
+ *
+ * Connects to ws://host:port/endpoint once and keeps the connection open.
+ * JSON goes out as text frames, CBOR as binary frames. Pings from the server
+ * are answered before each send; a close frame or socket error drops the
+ * connection so the publisher reconnects.
+ */
+class WebSocketTransport : public MetadataTransport {
+public:
+    explicit WebSocketTransport(const MetadataTransportSettings& settings);
+    ~WebSocketTransport() override;
+
+    bool connect() override;
+    bool isConnected() const override { return fd_ >= 0; }
+    bool send(const std::string& data, bool binary) override;
+    void close() override;
+    std::string getName() const override;
+
+private:
+    MetadataTransportSettings settings_;
+    int fd_;
+    std::mt19937 random_;
+    std::string frame_;      ///< Reused outgoing frame buffer
+    std::string incoming_;   ///< Bytes received from the server, not yet parsed
+
+    bool handshake();
+    bool sendFrame(int opcode, const char* payload, size_t size);
+    bool handleIncoming();
+};
+
+#endif // WEBSOCKET_TRANSPORT_H
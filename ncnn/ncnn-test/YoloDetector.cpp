@@ -6,7 +6,23 @@
  */
 
 #include "YoloDetector.h"
+#include "PipelineMetrics.h"
+#include "ThreadUtils.h"
 #include <iostream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+#if NCNN_VULKAN
+#include <ncnn/gpu.h>
+#include <ncnn/command.h>
+#endif
 
 /**
  * @brief COCO dataset class names for YOLOv4-tiny model
@@ -25,12 +41,6 @@ const char* YoloDetector::class_names_[] = {
 
 YoloDetector::YoloDetector()
 {
-    yolov4.opt.use_vulkan_compute = false;
-    yolov4.opt.use_fp16_packed = false;
-    yolov4.opt.use_fp16_storage = false;
-    yolov4.opt.use_fp16_arithmetic = false;
-    yolov4.opt.use_int8_storage = false;
-    yolov4.opt.use_int8_arithmetic = false;
 }
 
 YoloDetector::~YoloDetector()
@@ -41,31 +51,36 @@ YoloDetector::~YoloDetector()
  * @brief Load YOLOv4-tiny model from disk
  * @param modelpath Path to model files (without extension)
  * @param use_gpu Whether to use GPU acceleration via Vulkan
+ * @param precision Numeric precision to run the network in
+ * @param registry Registry sharing the network with other users (nullptr = one owned by this detector)
  * @return 0 on success, non-zero on failure
  * 
  * This method loads both .param and .bin files from the specified path.
  * For example, if modelpath is "models/yolov4-tiny", it will load:
  * - models/yolov4-tiny.param (network structure)
  * - models/yolov4-tiny.bin (model weights)
+ *
+ * With INT8 precision the calibrated pair models/yolov4-tiny-int8.param/.bin
+ * is loaded instead (see calibrate_int8.sh).
+ *
+ * A model the registry already holds is not loaded again. The registry maps
+ * the weights instead of reading them into the heap and keeps the compiled
+ * Vulkan pipelines (see ModelRegistry).
  */
-int YoloDetector::load(const std::string& modelpath, bool use_gpu)
+int YoloDetector::load(const std::string& modelpath, bool use_gpu, ModelPrecision precision, ModelRegistry* registry)
 {
-    yolov4.opt.use_vulkan_compute = use_gpu;
-
-    int ret = yolov4.load_param((modelpath + ".param").c_str());
-    if (ret != 0)
+    if (!registry)
     {
-        fprintf(stderr, "Failed to load param file: %s\\n", (modelpath + ".param").c_str());
-        return ret;
+        if (!own_models_)
+            own_models_.reset(new ModelRegistry());
+        registry = own_models_.get();
     }
 
-    ret = yolov4.load_model((modelpath + ".bin").c_str());
-    if (ret != 0)
-    {
-        fprintf(stderr, "Failed to load model file: %s\\n", (modelpath + ".bin").c_str());
-        return ret;
-    }
+    net_ = registry->acquire(modelpath, use_gpu, precision);
+    if (!net_)
+        return -1;
 
+    precision_ = precision;
     return 0;
 }
 
@@ -75,6 +90,7 @@ int YoloDetector::load(const std::string& modelpath, bool use_gpu)
  * @param objects Output vector to store detected objects
  * @param prob_threshold Minimum confidence threshold for detections
  * @param nms_threshold Non-maximum suppression threshold
+ * @param layout Regions and input size to analyse the image with (nullptr = whole image at the model size)
  * @return 0 on success, non-zero on failure
  * 
  * This method performs the following steps:
@@ -83,8 +99,236 @@ int YoloDetector::load(const std::string& modelpath, bool use_gpu)
  * 3. Post-process results (apply thresholds, NMS)
  * 4. Convert coordinates back to original image space
  */
-int YoloDetector::detect(const cv::Mat& bgr, std::vector<Object>& objects, float prob_threshold, float nms_threshold)
+int YoloDetector::detect(const cv::Mat& bgr, std::vector<Object>& objects, float prob_threshold, float nms_threshold,
+                         const DetectionLayout* layout)
+{
+    if (layout && !layout->regions.empty())
+    {
+        std::vector<std::vector<Object>> results;
+        const int ret = detectBatch(std::vector<cv::Mat>(1, bgr), results, prob_threshold, nms_threshold,
+                                    std::vector<const DetectionLayout*>(1, layout));
+        objects.swap(results[0]);
+        return ret;
+    }
+
+    if (!net_)
+    {
+        objects.clear();
+        return -1;
+    }
+
+    return detectWithThreads(bgr, objects, prob_threshold, nms_threshold, getTargetSize(layout), getNumThreads());
+}
+
+/**
+ * @brief Perform object detection on several images at once
+ * @param images Input images in BGR format (may differ in size)
+ * @param objects Output vector receiving one result vector per image, in input order
+ * @param prob_threshold Minimum confidence threshold for detections
+ * @param nms_threshold Non-maximum suppression threshold
+ * @param layouts Layout per image (missing or nullptr = whole image at the model size)
+ * @return 0 on success, non-zero on failure
+ *
+ * Every image is first split into the crops of its layout; the crops are
+ * views into the frame, so nothing is copied before the letterbox. All crops
+ * of the batch then go through the network together, and the boxes of an
+ * image analysed in several crops are moved to frame coordinates and merged
+ * with one NMS pass across the crops.
+ */
+int YoloDetector::detectBatch(const std::vector<cv::Mat>& images, std::vector<std::vector<Object>>& objects,
+                              float prob_threshold, float nms_threshold,
+                              const std::vector<const DetectionLayout*>& layouts)
+{
+    const int count = (int)images.size();
+    objects.assign(count, std::vector<Object>());
+
+    if (count == 0)
+        return 0;
+
+    std::vector<Crop> crops;
+    std::vector<int> crop_counts(count, 0);
+    for (int i = 0; i < count; i++)
+    {
+        const DetectionLayout* layout = i < (int)layouts.size() ? layouts[i] : nullptr;
+        const int size = getTargetSize(layout);
+        if (!layout || layout->regions.empty())
+        {
+            crops.push_back({images[i], i, cv::Point(0, 0), size, 0});
+            crop_counts[i]++;
+            continue;
+        }
+
+        // Layouts are built for the configured frame size; clip in case the camera delivers less
+        const cv::Rect bounds(0, 0, images[i].cols, images[i].rows);
+        for (const auto& region : layout->regions)
+        {
+            const cv::Rect rect = region.rect & bounds;
+            if (rect.width <= 0 || rect.height <= 0)
+                continue;
+            crops.push_back({images[i](rect), i, rect.tl(), size, region.inner_edges});
+            crop_counts[i]++;
+        }
+    }
+
+    std::vector<std::vector<Object>> crop_objects;
+    const int ret = detectCrops(crops, crop_objects, prob_threshold, nms_threshold);
+
+    for (size_t c = 0; c < crops.size(); c++)
+    {
+        const Crop& crop = crops[c];
+        const float right = crop.image.cols - 2.f;
+        const float bottom = crop.image.rows - 2.f;
+        std::vector<Object>& owner = objects[crop.owner];
+
+        for (Object& obj : crop_objects[c])
+        {
+            // Cut by a tile edge: the overlapping neighbour (or the full pass) has this object whole
+            if (((crop.inner_edges & DetectionRegion::Left) && obj.rect.x <= 1.f) ||
+                ((crop.inner_edges & DetectionRegion::Top) && obj.rect.y <= 1.f) ||
+                ((crop.inner_edges & DetectionRegion::Right) && obj.rect.x + obj.rect.width >= right) ||
+                ((crop.inner_edges & DetectionRegion::Bottom) && obj.rect.y + obj.rect.height >= bottom))
+                continue;
+
+            obj.rect.x += crop.offset.x;
+            obj.rect.y += crop.offset.y;
+            owner.push_back(obj);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (crop_counts[i] > 1)
+            mergeDetections(objects[i], nms_threshold);
+    }
+    return ret;
+}
+
+/**
+ * @brief Run a list of crops through the network
+ * @param crops Crops to analyse
+ * @param objects Output vector receiving one result vector per crop, in crop coordinates
+ * @param prob_threshold Minimum confidence threshold for detections
+ * @param nms_threshold Non-maximum suppression threshold
+ * @return 0 on success, non-zero on failure
+ *
+ * With Vulkan enabled all inputs are uploaded to the GPU in a single command
+ * submission and share one set of GPU allocators. On CPU the crops are spread
+ * over threads, each extractor getting its share of the configured NCNN threads.
+ */
+int YoloDetector::detectCrops(const std::vector<Crop>& crops, std::vector<std::vector<Object>>& objects,
+                              float prob_threshold, float nms_threshold)
+{
+    const int count = (int)crops.size();
+    objects.assign(count, std::vector<Object>());
+
+    if (count == 0)
+        return 0;
+    if (!net_)
+        return -1;
+    if (count == 1)
+        return detectWithThreads(crops[0].image, objects[0], prob_threshold, nms_threshold, crops[0].target_size,
+                                 getNumThreads());
+
+#if NCNN_VULKAN
+    if (net_->opt.use_vulkan_compute && net_->vulkan_device())
+        return detectBatchVulkan(crops, objects, prob_threshold, nms_threshold);
+#endif
+
+    // Crops share the calling worker's helpers; without any, NCNN's own threads do the fan-out
+    const int total_threads = std::max(1, getNumThreads());
+    const int groups = std::min(count, std::min(total_threads, getParallelism()));
+    const int threads_per_group = std::max(1, total_threads / groups);
+
+    std::vector<int> results(count, 0);
+    parallelFor(count, groups, [&](int i) {
+        results[i] = detectWithThreads(crops[i].image, objects[i], prob_threshold, nms_threshold, crops[i].target_size,
+                                       threads_per_group);
+    });
+
+    for (int ret : results)
+    {
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+/**
+ * @brief Per-thread scratch buffers of the letterbox kernel
+ *
+ * The vectors only grow, so after the first frame of a given size the
+ * preprocessing path does not allocate.
+ */
+struct LetterboxArena
+{
+    std::vector<int> x0;        ///< Left source byte offset per output column
+    std::vector<int> x1;        ///< Right source byte offset per output column
+    std::vector<float> fx;      ///< Horizontal interpolation weight per output column
+    std::vector<float> rows;    ///< Two horizontally resized source rows, planar RGB [2][3][w]
+    int cached_y[2];            ///< Source row held by each slot of rows
+};
+
+static thread_local LetterboxArena letterbox_arena;
+
+/**
+ * @brief Blend two planar rows vertically, then scale and offset them
+ * @param r0 Upper row
+ * @param r1 Lower row
+ * @param fy Weight of the lower row
+ * @param scale Normalization factor
+ * @param bias Offset added after scaling
+ * @param out Output row
+ * @param n Row length
+ */
+static void blendRows(const float* r0, const float* r1, float fy, float scale, float bias, float* out, int n)
 {
+    const float w0 = (1.f - fy) * scale;
+    const float w1 = fy * scale;
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    const float32x4_t vw0 = vdupq_n_f32(w0);
+    const float32x4_t vw1 = vdupq_n_f32(w1);
+    const float32x4_t vbias = vdupq_n_f32(bias);
+    for (; i + 3 < n; i += 4)
+    {
+        float32x4_t v = vmlaq_f32(vbias, vld1q_f32(r0 + i), vw0);
+        v = vmlaq_f32(v, vld1q_f32(r1 + i), vw1);
+        vst1q_f32(out + i, v);
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    const __m256 vw0 = _mm256_set1_ps(w0);
+    const __m256 vw1 = _mm256_set1_ps(w1);
+    const __m256 vbias = _mm256_set1_ps(bias);
+    for (; i + 7 < n; i += 8)
+    {
+        __m256 v = _mm256_fmadd_ps(_mm256_loadu_ps(r0 + i), vw0, vbias);
+        v = _mm256_fmadd_ps(_mm256_loadu_ps(r1 + i), vw1, v);
+        _mm256_storeu_ps(out + i, v);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        out[i] = r0[i] * w0 + r1[i] * w1 + bias;
+    }
+}
+
+/**
+ * @brief Letterbox an image into the network input blob
+ * @param bgr Input image in BGR format
+ * @param size Network input size of the longer side
+ * @param in_pad Output blob, resized to size, padded to a multiple of 32 and normalized.
+ *               Its memory is reused when the blob already has the right shape.
+ *
+ * BGR to RGB conversion, bilinear resize, border fill and normalization run
+ * in one pass straight into in_pad. Each source row is resized horizontally
+ * once into a planar scratch row; the vertical blend with the scale is the
+ * vectorized inner loop.
+ */
+void YoloDetector::preprocess(const cv::Mat& bgr, int size, ncnn::Mat& in_pad) const
+{
+    ScopedStageTimer timer(PipelineStage::Preprocess);
+
     int img_w = bgr.cols;
     int img_h = bgr.rows;
 
@@ -94,71 +338,377 @@ int YoloDetector::detect(const cv::Mat& bgr, std::vector<Object>& objects, float
     float scale = 1.f;
     if (w > h)
     {
-        scale = (float)target_size / w;
-        w = target_size;
+        scale = (float)size / w;
+        w = size;
         h = h * scale;
     }
     else
     {
-        scale = (float)target_size / h;
-        h = target_size;
+        scale = (float)size / h;
+        h = size;
         w = w * scale;
     }
 
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, img_w, img_h, w, h);
-
-    // pad to target_size rectangle
+    // pad to size rectangle
     int wpad = (w + 31) / 32 * 32 - w;
     int hpad = (h + 31) / 32 * 32 - h;
+    const int left = wpad / 2;
+    const int top = hpad / 2;
+    const int out_w = w + wpad;
+    const int out_h = h + hpad;
+
+    in_pad.create(out_w, out_h, 3);
+
+    LetterboxArena& arena = letterbox_arena;
+    arena.x0.resize(w);
+    arena.x1.resize(w);
+    arena.fx.resize(w);
+    arena.rows.resize(2 * 3 * w);
+    arena.cached_y[0] = -1;
+    arena.cached_y[1] = -1;
+
+    // Center-aligned source coordinates, as in ncnn::resize_bilinear
+    const float scale_x = (float)img_w / w;
+    for (int x = 0; x < w; x++)
+    {
+        float fx = (x + 0.5f) * scale_x - 0.5f;
+        int sx = (int)floorf(fx);
+        fx -= sx;
+        if (sx < 0)
+        {
+            sx = 0;
+            fx = 0.f;
+        }
+        if (sx >= img_w - 1)
+        {
+            sx = img_w - 1;
+            fx = 0.f;
+        }
+        arena.x0[x] = sx * 3;
+        arena.x1[x] = std::min(sx + 1, img_w - 1) * 3;
+        arena.fx[x] = fx;
+    }
+
+    // Resize one source row horizontally into a slot, keeping the slot in use by the other row
+    auto acquireRow = [&](int sy, int keep_slot) -> int {
+        for (int slot = 0; slot < 2; slot++)
+        {
+            if (arena.cached_y[slot] == sy)
+                return slot;
+        }
+
+        const int slot = keep_slot == 0 ? 1 : 0;
+        const unsigned char* src = bgr.ptr<unsigned char>(sy);
+        float* r = &arena.rows[(slot * 3 + 0) * w];
+        float* g = &arena.rows[(slot * 3 + 1) * w];
+        float* b = &arena.rows[(slot * 3 + 2) * w];
+        for (int x = 0; x < w; x++)
+        {
+            const unsigned char* p0 = src + arena.x0[x];
+            const unsigned char* p1 = src + arena.x1[x];
+            const float a = arena.fx[x];
+            b[x] = p0[0] + (p1[0] - p0[0]) * a;
+            g[x] = p0[1] + (p1[1] - p0[1]) * a;
+            r[x] = p0[2] + (p1[2] - p0[2]) * a;
+        }
+        arena.cached_y[slot] = sy;
+        return slot;
+    };
+
+    const float scale_y = (float)img_h / h;
+    for (int c = 0; c < 3; c++)
+    {
+        const float pad_value = (114.f - mean_vals[c]) * norm_vals[c];
+        ncnn::Mat channel = in_pad.channel(c);
+
+        for (int y = 0; y < top; y++)
+            std::fill(channel.row(y), channel.row(y) + out_w, pad_value);
+        for (int y = top + h; y < out_h; y++)
+            std::fill(channel.row(y), channel.row(y) + out_w, pad_value);
+        for (int y = top; y < top + h; y++)
+        {
+            float* row = channel.row(y);
+            std::fill(row, row + left, pad_value);
+            std::fill(row + left + w, row + out_w, pad_value);
+        }
+    }
+
+    for (int y = 0; y < h; y++)
+    {
+        float fy = (y + 0.5f) * scale_y - 0.5f;
+        int sy = (int)floorf(fy);
+        fy -= sy;
+        if (sy < 0)
+        {
+            sy = 0;
+            fy = 0.f;
+        }
+        if (sy >= img_h - 1)
+        {
+            sy = img_h - 1;
+            fy = 0.f;
+        }
+        const int sy1 = std::min(sy + 1, img_h - 1);
+
+        int keep = arena.cached_y[0] == sy1 ? 0 : (arena.cached_y[1] == sy1 ? 1 : -1);
+        const int slot0 = acquireRow(sy, keep);
+        const int slot1 = acquireRow(sy1, slot0);
+
+        for (int c = 0; c < 3; c++)
+        {
+            float* out = in_pad.channel(c).row(top + y) + left;
+            blendRows(&arena.rows[(slot0 * 3 + c) * w], &arena.rows[(slot1 * 3 + c) * w], fy,
+                      norm_vals[c], -mean_vals[c] * norm_vals[c], out, w);
+        }
+    }
+}
+
+void YoloDetector::letterbox(const cv::Mat& bgr, cv::Mat& letterboxed) const
+{
     ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
+    preprocess(bgr, target_size, in_pad);
+
+    // Undo the normalization, so the pixels are the ones the network is fed
+    for (int c = 0; c < 3; c++)
+    {
+        float* values = in_pad.channel(c);
+        const int count = in_pad.w * in_pad.h;
+        for (int i = 0; i < count; i++)
+            values[i] = values[i] / norm_vals[c] + mean_vals[c];
+    }
+
+    letterboxed.create(in_pad.h, in_pad.w, CV_8UC3);
+    in_pad.to_pixels(letterboxed.data, ncnn::Mat::PIXEL_RGB2BGR);
+}
+
+/**
+ * @brief Per-thread scratch buffers of the postprocessing stage
+ *
+ * Like LetterboxArena, these only grow, so decoding and NMS stop allocating
+ * once the largest detection count has been seen.
+ */
+struct PostprocessArena
+{
+    std::vector<Object> candidates;  ///< Boxes above their class threshold, sorted by confidence
+    std::vector<float> areas;        ///< Box areas of the kept detections, parallel to picked
+    std::vector<int> picked;         ///< Indices into candidates surviving NMS
+};
+
+static thread_local PostprocessArena postprocess_arena;
+
+/**
+ * @brief Convert the network output into objects in image coordinates
+ * @param out Output blob, one detection per row
+ * @param img_w Width of the original image
+ * @param img_h Height of the original image
+ * @param prob_threshold Minimum confidence for classes without their own threshold
+ * @param nms_threshold IoU above which the less confident of two boxes is dropped (>= 1 disables NMS)
+ * @param objects Output vector to store detected objects
+ *
+ * The confidence filter is a single pass over the rows writing into a reused
+ * buffer; std::sort then orders the survivors by confidence for the NMS, which
+ * stops as soon as max_detections_ boxes are kept, so the cap also bounds its cost.
+ */
+void YoloDetector::postprocess(const ncnn::Mat& out, int img_w, int img_h, float prob_threshold, float nms_threshold,
+                               std::vector<Object>& objects) const
+{
+    ScopedStageTimer timer(PipelineStage::Postprocess);
+    objects.clear();
+    if (out.h <= 0)
+        return;
+
+    PostprocessArena& arena = postprocess_arena;
+    std::vector<Object>& candidates = arena.candidates;
+    candidates.clear();
+    candidates.reserve(out.h);
+
+    const int class_count = (int)class_thresholds_.size();
+    const float max_x = (float)(img_w - 1);
+    const float max_y = (float)(img_h - 1);
+    for (int i = 0; i < out.h; i++)
+    {
+        const float* detection = out.row(i);
+
+        const int class_id = (int)detection[0];
+        const float confidence = detection[1];
+        const float class_threshold = (class_id >= 0 && class_id < class_count && class_thresholds_[class_id] > 0.f)
+                                          ? class_thresholds_[class_id] : prob_threshold;
+        if (confidence < class_threshold)
+            continue;
+
+        // Normalized coordinates (0-1) to pixels, clamped to the image
+        const float x1 = std::max(std::min(detection[2] * img_w, max_x), 0.f);
+        const float y1 = std::max(std::min(detection[3] * img_h, max_y), 0.f);
+        const float x2 = std::max(std::min(detection[4] * img_w, max_x), 0.f);
+        const float y2 = std::max(std::min(detection[5] * img_h, max_y), 0.f);
+
+        // Skip invalid and tiny boxes; the first test also holds for min_box_size 0
+        if (x2 <= x1 || y2 <= y1 || (x2 - x1) < min_box_size_ || (y2 - y1) < min_box_size_)
+            continue;
+
+        candidates.emplace_back();
+        Object& obj = candidates.back();
+        obj.label = class_id;
+        obj.prob = confidence;
+        obj.rect = cv::Rect_<float>(x1, y1, x2 - x1, y2 - y1);
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Object& a, const Object& b) { return a.prob > b.prob; });
+
+    nms_sorted_bboxes(candidates, arena.picked, nms_threshold, arena.areas);
+
+    objects.reserve(arena.picked.size());
+    for (int index : arena.picked)
+    {
+        objects.push_back(candidates[index]);
+    }
+}
+
+/**
+ * @brief Merge the boxes found in the crops of one image
+ * @param objects Boxes in frame coordinates, replaced by the survivors in confidence order
+ * @param nms_threshold Non-maximum suppression threshold
+ *
+ * Overlapping crops see the same object more than once; the same class-aware
+ * NMS as within a crop keeps the most confident box, and the detection cap
+ * then applies to the image as a whole.
+ */
+void YoloDetector::mergeDetections(std::vector<Object>& objects, float nms_threshold) const
+{
+    PostprocessArena& arena = postprocess_arena;
+
+    std::sort(objects.begin(), objects.end(),
+              [](const Object& a, const Object& b) { return a.prob > b.prob; });
+
+    nms_sorted_bboxes(objects, arena.picked, nms_threshold, arena.areas);
+
+    arena.candidates.clear();
+    for (int index : arena.picked)
+    {
+        arena.candidates.push_back(objects[index]);
+    }
+    objects.swap(arena.candidates);
+}
+
+/**
+ * @brief Run one image through its own extractor
+ * @param bgr Input image in BGR format
+ * @param objects Output vector to store detected objects
+ * @param prob_threshold Minimum confidence threshold for detections
+ * @param nms_threshold Non-maximum suppression threshold
+ * @param size Network input size of the longer side
+ * @param num_threads NCNN threads used by this extractor
+ * @return 0 on success, non-zero on failure
+ */
+int YoloDetector::detectWithThreads(const cv::Mat& bgr, std::vector<Object>& objects, float prob_threshold, float nms_threshold,
+                                    int size, int num_threads) const
+{
+    // Reused across calls on this thread; preprocess() only reallocates when the shape changes
+    static thread_local ncnn::Mat in_pad;
+    preprocess(bgr, size, in_pad);
 
-    in_pad.substract_mean_normalize(mean_vals, norm_vals);
+    ncnn::Extractor ex = net_->create_extractor();
+    ex.set_num_threads(std::max(1, num_threads));
+
+    // Per-thread pools keep blob and workspace memory across frames instead of going back to malloc
+    if (use_pool_allocator_)
+    {
+        static thread_local ncnn::UnlockedPoolAllocator blob_pool_allocator;
+        static thread_local ncnn::PoolAllocator workspace_pool_allocator;
+        ex.set_blob_allocator(&blob_pool_allocator);
+        ex.set_workspace_allocator(&workspace_pool_allocator);
+    }
 
-    ncnn::Extractor ex = yolov4.create_extractor();
     ex.input("data", in_pad);
 
     ncnn::Mat out;
-    ex.extract("output", out);
+    int ret;
+    {
+        ScopedStageTimer timer(PipelineStage::Forward);
+        ret = ex.extract("output", out);
+    }
+    if (ret != 0)
+    {
+        objects.clear();
+        return ret;
+    }
 
-    objects.clear();
-    
-    if (out.h > 0) {
-        for (int i = 0; i < out.h; i++) {
-            const float* detection = out.row(i);
-            
-            int class_id = (int)detection[0];
-            float confidence = detection[1];
-            
-            if (confidence < prob_threshold) continue;
-            
-            // Convert normalized coordinates (0-1) to pixel coordinates
-            float x1 = detection[2] * img_w;
-            float y1 = detection[3] * img_h;
-            float x2 = detection[4] * img_w;
-            float y2 = detection[5] * img_h;
-            
-            // Clamp to image bounds
-            x1 = std::max(std::min(x1, (float)(img_w - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(img_h - 1)), 0.f);
-            x2 = std::max(std::min(x2, (float)(img_w - 1)), 0.f);
-            y2 = std::max(std::min(y2, (float)(img_h - 1)), 0.f);
-            
-            // Skip invalid boxes
-            if (x2 <= x1 || y2 <= y1) continue;
-            if ((x2 - x1) < 10 || (y2 - y1) < 10) continue;
-            
-            Object obj;
-            obj.label = class_id;
-            obj.prob = confidence;
-            obj.rect = cv::Rect_<float>(x1, y1, x2 - x1, y2 - y1);
-            
-            objects.push_back(obj);
+    postprocess(out, bgr.cols, bgr.rows, prob_threshold, nms_threshold, objects);
+    return 0;
+}
+
+#if NCNN_VULKAN
+/**
+ * @brief Batched detection on the Vulkan device
+ * @param crops Crops to analyse
+ * @param objects Output vectors, already sized to match crops
+ * @param prob_threshold Minimum confidence threshold for detections
+ * @return 0 on success, non-zero on failure
+ *
+ * Preprocessing runs in parallel on the CPU, then every input blob is recorded
+ * into one VkCompute and uploaded with a single submission. The forward passes
+ * reuse the uploaded blobs and one pair of GPU allocators for the whole batch.
+ */
+int YoloDetector::detectBatchVulkan(const std::vector<Crop>& crops, std::vector<std::vector<Object>>& objects,
+                                    float prob_threshold, float nms_threshold)
+{
+    const int count = (int)crops.size();
+    const ncnn::VulkanDevice* vkdev = net_->vulkan_device();
+
+    // Reused across batches on this thread; taken by reference so the helper threads fill this vector
+    static thread_local std::vector<ncnn::Mat> batch_inputs;
+    if ((int)batch_inputs.size() < count)
+        batch_inputs.resize(count);
+    std::vector<ncnn::Mat>& inputs = batch_inputs;
+    parallelFor(count, std::min(count, std::max(1, getNumThreads())), [&](int i) {
+        preprocess(crops[i].image, crops[i].target_size, inputs[i]);
+    });
+
+    ncnn::VkAllocator* blob_vkallocator = vkdev->acquire_blob_allocator();
+    ncnn::VkAllocator* staging_vkallocator = vkdev->acquire_staging_allocator();
+
+    ncnn::Option opt = net_->opt;
+    opt.blob_vkallocator = blob_vkallocator;
+    opt.workspace_vkallocator = blob_vkallocator;
+    opt.staging_vkallocator = staging_vkallocator;
+
+    int ret = 0;
+    {
+        std::vector<ncnn::VkMat> inputs_gpu(count);
+        {
+            ncnn::VkCompute cmd(vkdev);
+            for (int i = 0; i < count; i++)
+            {
+                cmd.record_upload(inputs[i], inputs_gpu[i], opt);
+            }
+            ret = cmd.submit_and_wait();
+        }
+
+        for (int i = 0; i < count && ret == 0; i++)
+        {
+            ncnn::Extractor ex = net_->create_extractor();
+            ex.set_blob_vkallocator(blob_vkallocator);
+            ex.set_workspace_vkallocator(blob_vkallocator);
+            ex.set_staging_vkallocator(staging_vkallocator);
+            ex.input("data", inputs_gpu[i]);
+
+            ncnn::Mat out;
+            {
+                ScopedStageTimer timer(PipelineStage::Forward);
+                ret = ex.extract("output", out);
+            }
+            if (ret == 0)
+                postprocess(out, crops[i].image.cols, crops[i].image.rows, prob_threshold, nms_threshold, objects[i]);
         }
     }
 
-    return 0;
+    vkdev->reclaim_blob_allocator(blob_vkallocator);
+    vkdev->reclaim_staging_allocator(staging_vkallocator);
+
+    return ret;
 }
+#endif
 
 void YoloDetector::draw_objects(const cv::Mat& bgr, const std::vector<Object>& objects)
 {
@@ -192,7 +742,13 @@ void YoloDetector::draw_objects(const cv::Mat& bgr, const std::vector<Object>& o
         cv::rectangle(bgr, obj.rect, color, 2);
 
         char text[256];
-        sprintf(text, "%s %.1f%%", getClassName(obj.label), obj.prob * 100);
+        int length;
+        if (obj.track_id >= 0)
+            length = sprintf(text, "#%d %s %.1f%%", obj.track_id, getClassName(obj.label), obj.prob * 100);
+        else
+            length = sprintf(text, "%s %.1f%%", getClassName(obj.label), obj.prob * 100);
+        if (obj.attribute)
+            snprintf(text + length, sizeof(text) - length, " %s", obj.attribute);
 
         int baseLine = 0;
         cv::Size label_size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
@@ -213,76 +769,112 @@ void YoloDetector::draw_objects(const cv::Mat& bgr, const std::vector<Object>& o
 }
 
 const char* YoloDetector::getClassName(int label) {
-    if (label >= 0 && label < 80) {
+    if (label >= 0 && label < getClassCount()) {
         return class_names_[label];
     }
     return "unknown";
 }
 
-void YoloDetector::qsort_descent_inplace(std::vector<Object>& faceobjects, int left, int right)
+/**
+ * @brief Get the size of the label table
+ * @return Number of labels, including "background" at 0
+ */
+int YoloDetector::getClassCount()
+{
+    return (int)(sizeof(class_names_) / sizeof(class_names_[0]));
+}
+
+/**
+ * @brief Look up a label by class name
+ * @param name Class name, e.g. "person"
+ * @return Label, -1 if the model has no such class
+ */
+int YoloDetector::findClass(const std::string& name)
 {
-    int i = left;
-    int j = right;
-    float p = faceobjects[(left + right) / 2].prob;
+    for (int i = 0; i < getClassCount(); i++)
+    {
+        if (name == class_names_[i])
+            return i;
+    }
+    return -1;
+}
+
+bool YoloDetector::setClassThresholds(const std::string& thresholds)
+{
+    class_thresholds_.assign(getClassCount(), 0.f);
 
-    while (i <= j)
+    bool valid = true;
+    std::stringstream list(thresholds);
+    std::string entry;
+    while (std::getline(list, entry, ','))
     {
-        while (faceobjects[i].prob > p)
-            i++;
+        const size_t colon = entry.rfind(':');
+        if (entry.find_first_not_of(" \t") == std::string::npos)
+            continue;
 
-        while (faceobjects[j].prob < p)
-            j--;
+        std::string name = colon == std::string::npos ? entry : entry.substr(0, colon);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        const float value = colon == std::string::npos ? 0.f : (float)std::atof(entry.c_str() + colon + 1);
 
-        if (i <= j)
+        const int label = findClass(name);
+        if (label < 0 || value <= 0.f || value > 1.f)
         {
-            std::swap(faceobjects[i], faceobjects[j]);
-            i++;
-            j--;
+            std::cerr << "Ignoring class threshold '" << entry << "'" << std::endl;
+            valid = false;
+            continue;
         }
+        class_thresholds_[label] = value;
     }
-
-    if (left < j)
-        qsort_descent_inplace(faceobjects, left, j);
-    if (i < right)
-        qsort_descent_inplace(faceobjects, i, right);
-}
-
-void YoloDetector::qsort_descent_inplace(std::vector<Object>& objects)
-{
-    if (objects.empty())
-        return;
-    qsort_descent_inplace(objects, 0, objects.size() - 1);
+    return valid;
 }
 
-void YoloDetector::nms_sorted_bboxes(const std::vector<Object>& faceobjects, std::vector<int>& picked, float nms_threshold)
+/**
+ * @brief Greedy NMS over boxes sorted by descending confidence
+ * @param objects Candidates, most confident first
+ * @param picked Receives the indices of the kept boxes, in confidence order
+ * @param nms_threshold IoU above which a box is suppressed (>= 1 keeps everything)
+ * @param areas Scratch buffer for the areas of the kept boxes
+ *
+ * Boxes only suppress boxes of their own class unless class-agnostic NMS is
+ * enabled. Each candidate is compared with the kept boxes only, and the pass
+ * ends once max_detections_ boxes are kept.
+ */
+void YoloDetector::nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold,
+                                     std::vector<float>& areas) const
 {
     picked.clear();
+    areas.clear();
 
-    const int n = faceobjects.size();
+    const int n = (int)objects.size();
+    const size_t limit = max_detections_ > 0 ? (size_t)max_detections_ : (size_t)n;
+    const bool suppress = nms_threshold < 1.f;
 
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
+    for (int i = 0; i < n && picked.size() < limit; i++)
     {
-        areas[i] = faceobjects[i].rect.area();
-    }
+        const Object& a = objects[i];
+        const float area_a = a.rect.area();
 
-    for (int i = 0; i < n; i++)
-    {
-        const Object& a = faceobjects[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
+        bool keep = true;
+        for (size_t j = 0; suppress && j < picked.size(); j++)
         {
-            const Object& b = faceobjects[picked[j]];
-
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
+            const Object& b = objects[picked[j]];
+            if (!class_agnostic_nms_ && b.label != a.label)
+                continue;
+
+            // inter / union > t, without the division
+            const float inter_area = intersection_area(a, b);
+            if (inter_area > nms_threshold * (area_a + areas[j] - inter_area))
+            {
+                keep = false;
+                break;
+            }
         }
 
         if (keep)
+        {
             picked.push_back(i);
+            areas.push_back(area_a);
+        }
     }
-}
\ No newline at end of file
+}
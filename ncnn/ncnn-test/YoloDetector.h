@@ -11,8 +11,14 @@
 #include <opencv2/opencv.hpp>
 #include <ncnn/net.h>
 #include <ncnn/mat.h>
+#include <string>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "DetectionLayout.h"
+#include "ModelRegistry.h"
 
 /**
  * @struct Object
@@ -23,6 +29,9 @@ struct Object
     cv::Rect_<float> rect;  ///< Bounding box rectangle
     int label;              ///< Class label ID
     float prob;             ///< Detection confidence probability
+    int track_id = -1;      ///< Tracker id (-1 = not tracked)
+    const char* attribute = nullptr;  ///< Label from the second-stage classifier (nullptr = not classified)
+    float attribute_prob = 0.f;       ///< Confidence of the attribute
 };
 
 /**
@@ -30,7 +39,9 @@ struct Object
  * @brief YOLOv4-tiny object detection engine using NCNN framework
  * 
  * This class implements object detection using YOLOv4-tiny model with NCNN
- * framework for efficient inference on CPU/GPU.
+ * framework for efficient inference on CPU/GPU. The network comes from a
+ * ModelRegistry, so several detectors (or other users) of the same model
+ * share one copy of it.
  */
 class YoloDetector
 {
@@ -38,28 +49,97 @@ public:
     YoloDetector();
     ~YoloDetector();
     
-    int load(const std::string& modelpath, bool use_gpu = false);
-    int detect(const cv::Mat& rgb, std::vector<Object>& objects, float prob_threshold = 0.25f, float nms_threshold = 0.45f);
+    int load(const std::string& modelpath, bool use_gpu = false, ModelPrecision precision = ModelPrecision::FP32,
+             ModelRegistry* registry = nullptr);
+    ModelPrecision getPrecision() const { return precision_; }
+    int getInputSize() const { return target_size; }  ///< Network input size used when a layout sets none
+    void setNumThreads(int num_threads) { num_threads_ = std::max(0, num_threads); }  ///< NCNN threads per detect() call (0 = NCNN default)
+    void setUsePoolAllocator(bool enable) { use_pool_allocator_ = enable; }
+    
+    /**
+     * @brief Set per-class confidence thresholds
+     * @param thresholds "name:threshold" pairs, comma-separated, e.g. "person:0.4,car:0.5";
+     *                   other classes use the prob_threshold passed to detect()
+     * @return false if a class name or value was not understood (it is skipped)
+     */
+    bool setClassThresholds(const std::string& thresholds);
+    void setMaxDetections(int max_detections) { max_detections_ = max_detections; }  ///< Cap per image (0 = unlimited)
+    void setClassAgnosticNms(bool enable) { class_agnostic_nms_ = enable; }       ///< Let any class suppress any other
+    void setMinBoxSize(int pixels) { min_box_size_ = std::max(0, pixels); }       ///< Smallest box side kept, in image pixels
+    
+    int detect(const cv::Mat& rgb, std::vector<Object>& objects, float prob_threshold = 0.25f, float nms_threshold = 0.45f,
+               const DetectionLayout* layout = nullptr);
+    int detectBatch(const std::vector<cv::Mat>& images, std::vector<std::vector<Object>>& objects,
+                    float prob_threshold = 0.25f, float nms_threshold = 0.45f,
+                    const std::vector<const DetectionLayout*>& layouts = std::vector<const DetectionLayout*>());
+    
+    /**
+     * @brief Get the network input of detect() as a BGR image
+     * @param bgr Input image in BGR format
+     * @param letterboxed Receives the image resized and padded exactly like the network input
+     *
+     * For INT8 calibration, which must see the same letterboxed input as inference.
+     */
+    void letterbox(const cv::Mat& bgr, cv::Mat& letterboxed) const;
     
     // Utility methods for drawing
     static void draw_objects(const cv::Mat& bgr, const std::vector<Object>& objects);
     static const char* getClassName(int label);
+    static int getClassCount();
+    static int findClass(const std::string& name);
     
 private:
-    ncnn::Net yolov4;
+    std::shared_ptr<const ncnn::Net> net_;  ///< Shared network, nullptr until load() succeeds
+    std::unique_ptr<ModelRegistry> own_models_;  ///< Used when load() is given no registry
+    int num_threads_ = 0;
+    ModelPrecision precision_ = ModelPrecision::FP32;
+    bool use_pool_allocator_ = true;
+    std::vector<float> class_thresholds_;   ///< Per-label confidence threshold (0 = use prob_threshold)
+    int max_detections_ = 100;
+    bool class_agnostic_nms_ = false;
+    int min_box_size_ = 10;
     int target_size = 416;
     float mean_vals[3] = {0.f, 0.f, 0.f};
     float norm_vals[3] = {1/255.f, 1/255.f, 1/255.f};
     
+    /// One network pass: a whole image or one region of it
+    struct Crop
+    {
+        cv::Mat image;          ///< View into the frame, not a copy
+        int owner;              ///< Index of the frame in the batch
+        cv::Point offset;       ///< Position of the crop in the frame
+        int target_size;        ///< Network input size
+        int inner_edges;        ///< DetectionRegion::Edge flags
+    };
+    
+    int getTargetSize(const DetectionLayout* layout) const
+    {
+        return layout && layout->target_size > 0 ? layout->target_size : target_size;
+    }
+    
+    int getNumThreads() const { return num_threads_ > 0 ? num_threads_ : net_->opt.num_threads; }
+    
+    void preprocess(const cv::Mat& bgr, int size, ncnn::Mat& in_pad) const;
+    void postprocess(const ncnn::Mat& out, int img_w, int img_h, float prob_threshold, float nms_threshold,
+                     std::vector<Object>& objects) const;
+    int detectWithThreads(const cv::Mat& bgr, std::vector<Object>& objects, float prob_threshold, float nms_threshold,
+                          int size, int num_threads) const;
+    int detectCrops(const std::vector<Crop>& crops, std::vector<std::vector<Object>>& objects,
+                    float prob_threshold, float nms_threshold);
+#if NCNN_VULKAN
+    int detectBatchVulkan(const std::vector<Crop>& crops, std::vector<std::vector<Object>>& objects,
+                          float prob_threshold, float nms_threshold);
+#endif
+    void mergeDetections(std::vector<Object>& objects, float nms_threshold) const;
+    
     static inline float intersection_area(const Object& a, const Object& b)
     {
         cv::Rect_<float> inter = a.rect & b.rect;
         return inter.area();
     }
     
-    static void qsort_descent_inplace(std::vector<Object>& faceobjects, int left, int right);
-    static void qsort_descent_inplace(std::vector<Object>& objects);
-    static void nms_sorted_bboxes(const std::vector<Object>& faceobjects, std::vector<int>& picked, float nms_threshold);
+    void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold,
+                           std::vector<float>& areas) const;
     
     // Class names
     static const char* class_names_[];
@@ -0,0 +1,75 @@
+#!/bin/sh
+# INT8 calibration for the YOLOv4-tiny model
+#
+#   ./calibrate_int8.sh record <camera_id> <frames_dir> [count] [width] [height] [fps]
+#       Save <count> frames (one per second) from /dev/video<camera_id> as JPEG files
+#
+#   ./calibrate_int8.sh calibrate <frames_dir> [model_prefix]
+#       Letterbox the recorded frames like the detector (needs precision_report),
+#       build <model_prefix>.table from them with ncnn2table and write the
+#       quantized <model_prefix>-int8.param/.bin with ncnn2int8
+#
+# Record frames on the site the model will run on, so the activation ranges
+# match the real scenes. Then compare the modes with ./precision_report.
+
+set -e
+
+usage() {
+    sed -n '2,13p' "$0" | sed 's/^# \{0,1\}//'
+    exit 1
+}
+
+record() {
+    camera_id=$1
+    frames_dir=$2
+    count=${3:-200}
+    width=${4:-640}
+    height=${5:-480}
+    fps=${6:-30}
+
+    [ -n "$camera_id" ] && [ -n "$frames_dir" ] || usage
+    mkdir -p "$frames_dir"
+
+    echo "Recording $count frames from /dev/video$camera_id to $frames_dir..."
+    gst-launch-1.0 -e v4l2src device=/dev/video"$camera_id" num-buffers=$((count * fps)) ! \
+        image/jpeg,width="$width",height="$height",framerate="$fps"/1 ! jpegdec ! \
+        videorate ! video/x-raw,framerate=1/1 ! jpegenc ! \
+        multifilesink location="$frames_dir/frame_%05d.jpg"
+}
+
+calibrate() {
+    frames_dir=$1
+    model=${2:-ncnn-model/yolov4-tiny}
+
+    [ -n "$frames_dir" ] || usage
+    for tool in ncnn2table ncnn2int8; do
+        command -v $tool >/dev/null 2>&1 || { echo "$tool not found (build ncnn with NCNN_BUILD_TOOLS=ON)"; exit 1; }
+    done
+
+    report=${PRECISION_REPORT:-./precision_report}
+    [ -x "$report" ] || { echo "$report not found (make precision_report)"; exit 1; }
+
+    imagelist="$frames_dir/imagelist.txt"
+    find "$frames_dir" -maxdepth 1 -name '*.jpg' | sort > "$imagelist"
+
+    # The frames go through YoloDetector::preprocess() itself: letterboxed to a multiple
+    # of 32 with 114 padding, exactly like at inference. ncnn2table then only converts
+    # them to RGB scaled to 0..1, since they already have the network input shape.
+    letterboxed="$frames_dir/letterboxed"
+    mkdir -p "$letterboxed"
+    shape=$("$report" --letterbox "$imagelist" "$letterboxed")
+    echo "Calibrating with $(wc -l < "$letterboxed/imagelist.txt") frames, input $shape..."
+
+    ncnn2table "$model.param" "$model.bin" "$letterboxed/imagelist.txt" "$model.table" \
+        mean=[0,0,0] norm=[0.003922,0.003922,0.003922] "$shape" \
+        pixel=RGB thread="$(nproc)" method=kl
+
+    ncnn2int8 "$model.param" "$model.bin" "$model-int8.param" "$model-int8.bin" "$model.table"
+    echo "INT8 model written: $model-int8.param / $model-int8.bin"
+}
+
+case "$1" in
+    record) shift; record "$@" ;;
+    calibrate) shift; calibrate "$@" ;;
+    *) usage ;;
+esac
@@ -29,6 +29,16 @@ void signalHandler(int signal) {
     }
 }
 
+/**
+ * @brief SIGHUP handler: reload the configuration file without restarting
+ * @param signal Signal number received (SIGHUP)
+ */
+void reloadHandler(int signal) {
+    if (g_app) {
+        g_app->requestReload();
+    }
+}
+
 /**
  * @brief Main entry point for the AI Detection System
  * @param argc Number of command line arguments
@@ -42,6 +52,7 @@ int main(int argc, char* argv[]) {
     // Set up signal handlers for graceful shutdown
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGHUP, reloadHandler);
     
     std::cout << "=== AI Detection System with RTSP Streaming ===" << std::endl;
     std::cout << "Features:" << std::endl;